@@ -0,0 +1,83 @@
+#include "test.hpp"
+#include "db.hpp"
+
+/*
+-------------------------------------------------------------------------------
+ plan_tests.cpp - No statement the app prepares scans a whole table
+-------------------------------------------------------------------------------
+Runs db_check_query_plans (the same check as `sms --check-plans`) on a new
+database, on one with enough rows and ANALYZE statistics for the planner to
+weigh its options, and on one with a report index dropped. The last case
+must fail, which shows the check can catch a regression.
+-------------------------------------------------------------------------------
+*/
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+namespace {
+
+void remove_db(const std::string& path) {
+    for (const char* suffix : { "", "-wal", "-shm", "-journal" }) std::remove((path + suffix).c_str());
+}
+
+bool plans_ok(sqlite3* db, bool print) {
+    std::vector<std::string> problems;
+    const bool ok = db_check_query_plans(db, problems);
+    if (print)
+        for (const std::string& p : problems) std::printf("  %s\n", p.c_str());
+    return ok;
+}
+
+// 2000 students, 40 courses, 5 enrollments each, then ANALYZE.
+bool fill(sqlite3* db) {
+    const char* sql =
+        "BEGIN;"
+        "WITH RECURSIVE n(i) AS (SELECT 0 UNION ALL SELECT i + 1 FROM n WHERE i < 1999)"
+        " INSERT INTO students SELECT 'S' || (10000 + i), 'Plan Student', 'a', 'c' FROM n;"
+        "WITH RECURSIVE n(i) AS (SELECT 0 UNION ALL SELECT i + 1 FROM n WHERE i < 39)"
+        " INSERT INTO courses SELECT 'PLN' || (100 + i), 't', 'd', 'x' FROM n;"
+        "WITH RECURSIVE k(j) AS (SELECT 0 UNION ALL SELECT j + 1 FROM k WHERE j < 4)"
+        " INSERT INTO grades(roll_no, course_code, internal_mark, final_mark)"
+        " SELECT s.roll_no, 'PLN' || (100 + (s.rowid * 7 + k.j * 3) % 40), s.rowid % 101, (s.rowid * 3) % 101"
+        " FROM students s, k WHERE s.roll_no LIKE 'S1____';"
+        "COMMIT; ANALYZE;";
+    return sqlite3_exec(db, sql, nullptr, nullptr, nullptr) == SQLITE_OK;
+}
+
+} // namespace
+
+TEST(query_plans_on_new_database) {
+    const std::string path = "sms_test_plans_new.db";
+    remove_db(path);
+    sqlite3* db = nullptr;
+    REQUIRE(db_open(db, path, db_profile_balanced()) && db_init_and_seed(db));
+    CHECK(plans_ok(db, true));
+    db_close(db);
+    remove_db(path);
+}
+
+TEST(query_plans_with_statistics) {
+    const std::string path = "sms_test_plans_stats.db";
+    remove_db(path);
+    sqlite3* db = nullptr;
+    REQUIRE(db_open(db, path, db_profile_balanced()) && db_init_and_seed(db));
+    REQUIRE(fill(db));
+    DbCounts counts;
+    REQUIRE(db_get_counts(db, counts) && counts.enrolments >= 10000);
+    CHECK(plans_ok(db, true));
+    db_close(db);
+    remove_db(path);
+}
+
+TEST(query_plans_catch_a_dropped_index) {
+    const std::string path = "sms_test_plans_drop.db";
+    remove_db(path);
+    sqlite3* db = nullptr;
+    REQUIRE(db_open(db, path, db_profile_balanced()) && db_init_and_seed(db));
+    REQUIRE(sqlite3_exec(db, "DROP INDEX grades_course_rank;", nullptr, nullptr, nullptr) == SQLITE_OK);
+    CHECK(!plans_ok(db, false));
+    db_close(db);
+    remove_db(path);
+}
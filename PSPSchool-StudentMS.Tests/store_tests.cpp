@@ -0,0 +1,208 @@
+#include "test.hpp"
+#include "helpers.hpp"
+
+/*
+-------------------------------------------------------------------------------
+ store_tests.cpp - DataStore indexes, adjacency lists and aggregates
+-------------------------------------------------------------------------------
+Random adds, updates and removals, each applied to the DataStore and to a
+plain std::map model. After every step the key indexes must agree with the
+model. The per-student / per-course grade lists and their GradeLinks must
+match a full scan of the grades. The running aggregates must match a
+rescan of those lists. The invalid ids (RollId{} / CourseId{}), which share
+their value with the index's empty-cell marker, must never match anything.
+-------------------------------------------------------------------------------
+*/
+
+#include <cmath>
+#include <map>
+#include <random>
+#include <set>
+#include <string>
+#include <utility>
+
+namespace {
+
+// Every list entry points back at its position (GradeLink), and each
+// student / course lists exactly the grades a full scan finds for it.
+bool adjacency_ok(const DataStore& d) {
+    const GradeColumns& g = d.all_grades;
+    if (d.grades_of_student.size() != d.all_students.size()) return false;
+    if (d.grades_of_course.size() != d.all_courses.size()) return false;
+    if (d.grade_links.size() != g.size()) return false;
+    for (std::uint32_t s = 0; s < d.all_students.size(); ++s) {
+        const auto& list = d.grades_of_student[s];
+        size_t n = 0;
+        for (size_t i = 0; i < g.size(); ++i) n += g.roll_no[i] == d.all_students[s].roll_no;
+        if (n != list.size()) return false;
+        for (std::uint32_t p = 0; p < list.size(); ++p) {
+            const GradeLink& link = d.grade_links[list[p]];
+            if (g.roll_no[list[p]] != d.all_students[s].roll_no || link.student != s || link.student_pos != p) return false;
+        }
+    }
+    for (std::uint32_t c = 0; c < d.all_courses.size(); ++c) {
+        const auto& list = d.grades_of_course[c];
+        size_t n = 0;
+        for (size_t i = 0; i < g.size(); ++i) n += g.course_code[i] == d.all_courses[c].code;
+        if (n != list.size()) return false;
+        for (std::uint32_t p = 0; p < list.size(); ++p) {
+            const GradeLink& link = d.grade_links[list[p]];
+            if (g.course_code[list[p]] != d.all_courses[c].code || link.course != c || link.course_pos != p) return false;
+        }
+    }
+    return true;
+}
+
+bool same_agg(const DataStore& d, const GradeAgg& a, const std::vector<std::uint32_t>& slots) {
+    GradeAgg r;
+    agg_rescan(d, r, slots);
+    return a.count == r.count && a.passed == r.passed && a.min_weighted == r.min_weighted
+        && a.max_weighted == r.max_weighted && std::fabs(a.sum_weighted - r.sum_weighted) < 1e-6;
+}
+
+bool aggregates_ok(const DataStore& d) {
+    for (size_t s = 0; s < d.all_students.size(); ++s)
+        if (!same_agg(d, d.student_agg[s], d.grades_of_student[s])) return false;
+    for (size_t c = 0; c < d.all_courses.size(); ++c)
+        if (!same_agg(d, d.course_agg[c], d.grades_of_course[c])) return false;
+    return true;
+}
+
+RollId roll(int i) {
+    RollId r;
+    parse_roll("S" + std::to_string(100 + i), r);
+    return r;
+}
+
+CourseId course(int i) {
+    CourseId c;
+    parse_course("TST" + std::to_string(100 + i), c);
+    return c;
+}
+
+} // namespace
+
+TEST(store_random_ops_match_model) {
+    DataStore d;
+    std::mt19937 rng(1);
+    std::map<RollId, std::string> students;                       // roll -> name
+    std::map<CourseId, std::string> courses;                      // code -> title
+    std::map<std::pair<RollId, CourseId>, double> grades;         // -> final mark
+    for (int step = 0; step < 20000; ++step) {
+        const RollId r = roll(static_cast<int>(rng() % 40));
+        const CourseId c = course(static_cast<int>(rng() % 10));
+        const std::string text = "v" + std::to_string(rng() % 9);
+        switch (rng() % 9) {
+        case 0:
+            REQUIRE(add_student(d, Student{ r, text, "a", "c" }) == students.emplace(r, text).second);
+            break;
+        case 1:
+            REQUIRE(add_course(d, Course{ c, text, "d", "t" }) == courses.emplace(c, text).second);
+            break;
+        case 2: {
+            const bool expect = students.count(r) && courses.count(c) && !grades.count({ r, c });
+            if (expect) grades[{ r, c }] = 0;
+            REQUIRE(enroll_student(d, r, c) == expect);
+            break;
+        }
+        case 3: {
+            const double fm = static_cast<double>(rng() % 101);
+            const bool expect = grades.count({ r, c }) != 0;
+            if (expect) grades[{ r, c }] = fm;
+            REQUIRE(enter_marks(d, r, c, static_cast<double>(rng() % 101), fm) == expect);
+            break;
+        }
+        case 4: {
+            const bool expect = students.count(r) != 0;
+            if (expect) students[r] = text;
+            REQUIRE(apply_student_update(d, Student{ r, text, "a2", "c2" }) == expect);
+            break;
+        }
+        case 5: {
+            const bool expect = courses.count(c) != 0;
+            if (expect) courses[c] = text;
+            REQUIRE(apply_course_update(d, Course{ c, text, "d2", "t2" }) == expect);
+            break;
+        }
+        case 6:
+            if (rng() % 4) break;   // keep the store from emptying out
+            REQUIRE(remove_student(d, r) == (students.erase(r) != 0));
+            for (auto it = grades.begin(); it != grades.end();) it = it->first.first == r ? grades.erase(it) : std::next(it);
+            break;
+        case 7:
+            if (rng() % 8) break;
+            REQUIRE(remove_course(d, c) == (courses.erase(c) != 0));
+            for (auto it = grades.begin(); it != grades.end();) it = it->first.second == c ? grades.erase(it) : std::next(it);
+            break;
+        default:
+            REQUIRE(remove_enrollment(d, r, c) == (grades.erase({ r, c }) != 0));
+            break;
+        }
+
+        REQUIRE(d.all_students.size() == students.size());
+        REQUIRE(d.all_courses.size() == courses.size());
+        REQUIRE(d.all_grades.size() == grades.size());
+        for (const auto& [k, name] : students) {
+            const Student* s = find_student(d, k);
+            REQUIRE(s && s->name == name && exists_student(d, k));
+        }
+        for (const auto& [k, title] : courses) {
+            const Course* x = find_course(d, k);
+            REQUIRE(x && x->title == title && exists_course(d, k));
+        }
+        for (const auto& [k, fm] : grades) {
+            const std::uint32_t slot = find_grade_slot(d, k.first, k.second);
+            REQUIRE(slot != NO_SLOT && d.all_grades.final_mark[slot] == fm && already_enrolled(d, k.first, k.second));
+        }
+        REQUIRE(!exists_student(d, roll(99)) && !exists_course(d, course(99)));
+        REQUIRE(aggregates_ok(d));
+        if (step % 50 == 0) REQUIRE(adjacency_ok(d));
+    }
+}
+
+TEST(store_rebuild_matches_incremental) {
+    DataStore d;
+    std::mt19937 rng(2);
+    for (int i = 0; i < 30; ++i) add_student(d, Student{ roll(i), "n", "a", "c" });
+    for (int i = 0; i < 8; ++i) add_course(d, Course{ course(i), "t", "d", "x" });
+    for (int step = 0; step < 2000; ++step) {
+        const RollId r = roll(static_cast<int>(rng() % 30));
+        const CourseId c = course(static_cast<int>(rng() % 8));
+        if (rng() % 3) {
+            enroll_student(d, r, c);
+            enter_marks(d, r, c, static_cast<double>(rng() % 101), static_cast<double>(rng() % 101));
+        }
+        else {
+            remove_enrollment(d, r, c);
+        }
+    }
+    REQUIRE(adjacency_ok(d) && aggregates_ok(d));
+    DataStore e = d;
+    store_rebuild_indexes(e);
+    CHECK(adjacency_ok(e));
+    CHECK(aggregates_ok(e));
+    for (size_t s = 0; s < d.all_students.size(); ++s) CHECK(e.student_agg[s].count == d.student_agg[s].count);
+    for (size_t i = 0; i < d.all_grades.size(); ++i)
+        CHECK(find_grade_slot(e, d.all_grades.roll_no[i], d.all_grades.course_code[i]) == i);
+}
+
+TEST(store_invalid_keys_match_nothing) {
+    DataStore d;
+    for (int i = 0; i < 5; ++i) add_student(d, Student{ roll(i), "n", "a", "c" });
+    for (int i = 0; i < 3; ++i) add_course(d, Course{ course(i), "t", "d", "x" });
+    for (int i = 0; i < 5; ++i) enroll_student(d, roll(i), course(i % 3));
+    // Leave an erased cell behind, whose stale value an unguarded lookup would read.
+    REQUIRE(remove_student(d, roll(4)) && remove_course(d, course(2)));
+
+    CHECK(!find_student(d, RollId{}) && !exists_student(d, RollId{}));
+    CHECK(!find_course(d, CourseId{}) && !exists_course(d, CourseId{}));
+    CHECK(find_grade_slot(d, RollId{}, CourseId{}) == NO_SLOT);
+    CHECK(find_grade_slot(d, RollId{}, course(0)) == NO_SLOT);
+    CHECK(student_grade_slots(d, RollId{}).empty());
+    CHECK(!enroll_student(d, RollId{}, course(0)) && !enter_marks(d, RollId{}, course(0), 50, 50));
+    CHECK(!remove_student(d, RollId{}) && !remove_course(d, CourseId{}));
+    CHECK(!remove_enrollment(d, roll(0), CourseId{}));
+    CHECK(!add_student(d, Student{ RollId{}, "n", "a", "c" }) && !add_course(d, Course{ CourseId{}, "t", "d", "x" }));
+    CHECK(d.all_students.size() == 4 && d.all_courses.size() == 2 && d.all_grades.size() == 3);
+    CHECK(adjacency_ok(d) && aggregates_ok(d));
+}
@@ -0,0 +1,220 @@
+#include "test.hpp"
+#include "db.hpp"
+#include "helpers.hpp"
+
+/*
+-------------------------------------------------------------------------------
+ sync_tests.cpp - A DataStore attached with db_sync_attach follows the file
+-------------------------------------------------------------------------------
+After each write the attached store must hold exactly what a fresh
+db_load_all reads. The writes come from the db_* functions, raw SQL
+(triggers, cascades, REPLACE, savepoints, rollbacks), a second connection
+and a snapshot reattach. A write the background writer fails must keep
+the store out of the snapshot until db_writer_reconcile has reloaded it.
+Each test works on its own file in the working directory.
+-------------------------------------------------------------------------------
+*/
+
+#include <cstdio>
+#include <future>
+#include <map>
+#include <random>
+#include <string>
+
+namespace {
+
+// Remove a test database and its WAL side files.
+void remove_db(const std::string& path) {
+    for (const char* suffix : { "", "-wal", "-shm", "-journal" }) std::remove((path + suffix).c_str());
+}
+
+// Every row of the store as "key -> fields", for comparison.
+std::map<std::string, std::string> rows_of(const DataStore& d) {
+    std::map<std::string, std::string> m;
+    for (const Student& s : d.all_students) m["S " + to_string(s.roll_no)] = s.name + "|" + s.address + "|" + s.contact;
+    for (const Course& c : d.all_courses) m["C " + to_string(c.code)] = c.title + "|" + c.description + "|" + c.teacher;
+    for (size_t i = 0; i < d.all_grades.size(); ++i) {
+        const Grade g = d.all_grades[i];
+        m["G " + to_string(g.roll_no) + " " + to_string(g.course_code)] =
+            std::to_string(g.internal_mark) + "|" + std::to_string(g.final_mark);
+    }
+    return m;
+}
+
+// The attached store holds what a full reload reads, and its aggregates
+// agree with its lists.
+bool matches_file(sqlite3* db, const DataStore& d) {
+    DataStore fresh;
+    if (!db_load_all(db, fresh) || rows_of(fresh) != rows_of(d)) return false;
+    for (size_t s = 0; s < d.all_students.size(); ++s) {
+        GradeAgg r;
+        agg_rescan(d, r, d.grades_of_student[s]);
+        if (r.count != d.student_agg[s].count || r.passed != d.student_agg[s].passed) return false;
+    }
+    return true;
+}
+
+// Run `sql` on `db` and let the attached store catch up.
+void run(sqlite3* db, const std::string& sql) {
+    sqlite3_exec(db, sql.c_str(), nullptr, nullptr, nullptr);
+    if (!sqlite3_get_autocommit(db)) sqlite3_exec(db, "ROLLBACK;", nullptr, nullptr, nullptr);
+    db_sync_flush(db);
+}
+
+} // namespace
+
+TEST(sync_follows_db_writes) {
+    const std::string path = "sms_test_sync_writes.db";
+    remove_db(path);
+    sqlite3* db = nullptr;
+    REQUIRE(db_open(db, path, db_profile_balanced()) && db_init_and_seed(db));
+    DataStore d;
+    REQUIRE(db_sync_attach(db, d));
+    CHECK(matches_file(db, d));
+
+    Student s{};
+    parse_roll("S910", s.roll_no);
+    s.name = "Test Student";
+    s.address = "1 Test St";
+    s.contact = "021-555-0101";
+    CourseId mth;
+    parse_course("MTH101", mth);
+    CHECK(db_add_student(db, s) && matches_file(db, d));
+    CHECK(db_enroll(db, s.roll_no, mth) && matches_file(db, d));
+    CHECK(db_enter_marks(db, s.roll_no, mth, 90, 95) && matches_file(db, d));
+    s.name = "Renamed Student";
+    CHECK(db_update_student(db, s) && matches_file(db, d));
+    CHECK(db_delete_course(db, mth) && matches_file(db, d));   // cascades to grades
+
+    // A trigger's own writes, a raw UPDATE, a rolled-back and a committed
+    // DELETE, and REPLACE (delete + insert) inside a savepoint.
+    run(db, "CREATE TRIGGER test_enroll_all AFTER INSERT ON students BEGIN"
+        " INSERT INTO grades(roll_no,course_code) SELECT NEW.roll_no, code FROM courses; END;");
+    parse_roll("S911", s.roll_no);
+    CHECK(db_add_student(db, s) && matches_file(db, d));
+    run(db, "UPDATE grades SET final_mark = final_mark + 1;");
+    CHECK(matches_file(db, d));
+    REQUIRE(db_begin(db));
+    sqlite3_exec(db, "DELETE FROM grades;", nullptr, nullptr, nullptr);
+    db_rollback(db);
+    CHECK(matches_file(db, d));
+    run(db, "BEGIN; REPLACE INTO students VALUES('S001','Replaced','b','021-555-0102');"
+        " SAVEPOINT x; DELETE FROM courses; ROLLBACK TO x; COMMIT;");
+    CHECK(matches_file(db, d));
+    run(db, "DELETE FROM grades;");
+    CHECK(matches_file(db, d));
+    db_close(db);
+    remove_db(path);
+}
+
+TEST(sync_random_sql_matches_reload) {
+    const std::string path = "sms_test_sync_random.db";
+    remove_db(path);
+    sqlite3* db = nullptr;
+    REQUIRE(db_open(db, path, db_profile_balanced()) && db_init_and_seed(db));
+    DataStore d;
+    REQUIRE(db_sync_attach(db, d));
+    std::mt19937 rng(3);
+    auto roll = [&] { return "'S" + std::to_string(100 + rng() % 30) + "'"; };
+    auto code = [&] { return "'TST" + std::to_string(100 + rng() % 5) + "'"; };
+    auto mark = [&] { return std::to_string(rng() % 101); };
+    for (int step = 0; step < 3000; ++step) {
+        std::string sql;
+        switch (rng() % 9) {
+        case 0: sql = "INSERT INTO students VALUES(" + roll() + ",'Name','a','c');"; break;
+        case 1: sql = "INSERT INTO courses VALUES(" + code() + ",'t','d','x');"; break;
+        case 2: sql = "INSERT INTO grades(roll_no,course_code) VALUES(" + roll() + "," + code() + ");"; break;
+        case 3: sql = "UPDATE grades SET internal_mark=" + mark() + ", final_mark=" + mark() + " WHERE roll_no=" + roll() + ";"; break;
+        case 4: sql = "DELETE FROM students WHERE roll_no=" + roll() + ";"; break;
+        case 5: sql = "DELETE FROM courses WHERE code=" + code() + ";"; break;
+        case 6: sql = "UPDATE students SET name='Other' WHERE roll_no LIKE 'S1" + std::to_string(rng() % 3) + "%';"; break;
+        case 7:
+            sql = "BEGIN; DELETE FROM grades WHERE course_code=" + code() + "; INSERT INTO courses VALUES(" + code()
+                + ",'t','d','x'); " + (rng() % 2 ? "COMMIT;" : "ROLLBACK;");
+            break;
+        default: sql = "UPDATE students SET roll_no='S" + std::to_string(200 + rng() % 30) + "' WHERE roll_no=" + roll() + ";"; break;
+        }
+        run(db, sql);
+        if (step % 10 == 0 && !matches_file(db, d)) {
+            std::printf("  store differs from the file after: %s\n", sql.c_str());
+            REQUIRE(false);
+        }
+    }
+    CHECK(matches_file(db, d));
+    db_close(db);
+    remove_db(path);
+}
+
+TEST(sync_external_writer_and_snapshot) {
+    const std::string path = "sms_test_sync_snap.db", snap = "sms_test_sync_snap.snap";
+    remove_db(path);
+    std::remove(snap.c_str());
+    sqlite3* db = nullptr;
+    REQUIRE(db_open(db, path, db_profile_balanced()) && db_init_and_seed(db));
+    DataStore d;
+    REQUIRE(db_sync_attach(db, d));
+    sqlite3* ext = nullptr;
+    REQUIRE(sqlite3_open(path.c_str(), &ext) == SQLITE_OK);
+
+    // Another connection's writes arrive through the change log at our next
+    // commit.
+    sqlite3_exec(ext, "PRAGMA foreign_keys=ON; INSERT INTO students VALUES('S900','Other Writer','a','c');"
+        " DELETE FROM courses WHERE code='MTH101';", nullptr, nullptr, nullptr);
+    run(db, "INSERT INTO students VALUES('S901','Own Writer','a','c');");
+    CHECK(matches_file(db, d));
+
+    // Snapshot, change the file behind it, reattach: snapshot + delta.
+    REQUIRE(db_sync_save_snapshot(db, snap));
+    sqlite3_exec(ext, "UPDATE grades SET final_mark = 1;", nullptr, nullptr, nullptr);
+    DataStore d2;
+    DbLoadReport rep;
+    REQUIRE(db_sync_attach(db, d2, snap, &rep));
+    CHECK(rep.source == "snapshot+delta");
+    CHECK(matches_file(db, d2));
+
+    // Log pruned under us: the store must notice and reload.
+    sqlite3_exec(ext, "DELETE FROM sms_changes; UPDATE students SET name = 'Pruned';", nullptr, nullptr, nullptr);
+    run(db, "UPDATE courses SET title = 'After prune';");
+    CHECK(matches_file(db, d2));
+    sqlite3_close(ext);
+    db_close(db);
+    remove_db(path);
+    std::remove(snap.c_str());
+}
+
+TEST(sync_failed_write_blocks_snapshot) {
+    const std::string path = "sms_test_sync_failed.db", snap = "sms_test_sync_failed.snap";
+    remove_db(path);
+    std::remove(snap.c_str());
+    DbProfile profile = db_profile_balanced();
+    profile.busy_timeout_ms = 50;   // the writer inherits it; fail fast on the lock below
+    sqlite3* db = nullptr;
+    REQUIRE(db_open(db, path, profile) && db_init_and_seed(db));
+    DataStore d;
+    REQUIRE(db_sync_attach(db, d) && db_writer_start(db));
+    sqlite3* ext = nullptr;
+    REQUIRE(sqlite3_open(path.c_str(), &ext) == SQLITE_OK);
+
+    // Cache first, then the queued write, which the held lock refuses.
+    RollId r;
+    CourseId c;
+    parse_roll("S001", r);
+    parse_course("MTH101", c);
+    REQUIRE(sqlite3_exec(ext, "BEGIN IMMEDIATE;", nullptr, nullptr, nullptr) == SQLITE_OK);
+    REQUIRE(enter_marks(d, r, c, 10, 10));
+    std::future<bool> done = db_write_async(db, [r, c](sqlite3* w) { return db_enter_marks(w, r, c, 10, 10); });
+    CHECK(!done.get());
+    sqlite3_exec(ext, "ROLLBACK;", nullptr, nullptr, nullptr);
+
+    CHECK(!db_sync_save_snapshot(db, snap));
+    std::FILE* f = std::fopen(snap.c_str(), "rb");
+    CHECK(!f);
+    if (f) std::fclose(f);
+    CHECK(db_writer_reconcile(db) == 1);
+    CHECK(matches_file(db, d));
+    CHECK(db_sync_save_snapshot(db, snap));
+    sqlite3_close(ext);
+    db_close(db);
+    remove_db(path);
+    std::remove(snap.c_str());
+}
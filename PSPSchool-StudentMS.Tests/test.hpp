@@ -0,0 +1,46 @@
+#pragma once
+#include <cstdio>
+#include <vector>
+
+/*
+-------------------------------------------------------------------------------
+ test.hpp - Test registry and CHECK macros for PSPSchool-StudentMS.Tests
+-------------------------------------------------------------------------------
+Each TEST(name) { ... } registers itself; test_main.cpp runs them in file
+order and exits non-zero if any check failed. The project's post-build step
+runs the executable, so a failing test fails the build.
+
+  CHECK(cond)     report the failure and carry on
+  REQUIRE(cond)   report the failure and leave the test (use in loops, and
+                  where later steps depend on this one)
+
+The randomized tests use fixed seeds, so a failure reproduces on every run.
+-------------------------------------------------------------------------------
+*/
+
+struct TestCase {
+    const char* name;
+    void (*run)();
+};
+
+std::vector<TestCase>& test_registry();
+int& test_failures();
+
+struct TestRegistrar {
+    TestRegistrar(const char* name, void (*run)()) { test_registry().push_back({ name, run }); }
+};
+
+#define TEST(name) \
+    static void name(); \
+    static const TestRegistrar name##_registrar(#name, name); \
+    static void name()
+
+#define CHECK(cond) \
+    do { \
+        if (!(cond)) { ++test_failures(); std::printf("  %s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #cond); } \
+    } while (0)
+
+#define REQUIRE(cond) \
+    do { \
+        if (!(cond)) { ++test_failures(); std::printf("  %s:%d: REQUIRE(%s) failed\n", __FILE__, __LINE__, #cond); return; } \
+    } while (0)
@@ -0,0 +1,38 @@
+#include "test.hpp"
+
+/*
+-------------------------------------------------------------------------------
+ test_main.cpp - Runs every registered TEST (see test.hpp)
+-------------------------------------------------------------------------------
+Usage: PSPSchool-StudentMS.Tests [name-substring]
+Tests that open a database create their own files in the working directory
+and remove them when done; they never touch school.db.
+-------------------------------------------------------------------------------
+*/
+
+#include <cstring>
+
+std::vector<TestCase>& test_registry() {
+    static std::vector<TestCase> tests;
+    return tests;
+}
+
+int& test_failures() {
+    static int failures = 0;
+    return failures;
+}
+
+int main(int argc, char* argv[]) {
+    const char* filter = argc > 1 ? argv[1] : "";
+    int ran = 0, failed = 0;
+    for (const TestCase& t : test_registry()) {
+        if (!std::strstr(t.name, filter)) continue;
+        const int before = test_failures();
+        std::printf("%s\n", t.name);
+        t.run();
+        ++ran;
+        if (test_failures() != before) ++failed;
+    }
+    std::printf("%d test(s), %d failed\n", ran, failed);
+    return failed == 0 ? 0 : 1;
+}
@@ -0,0 +1,62 @@
+#include "test.hpp"
+#include "db.hpp"
+#include "store_vtab.hpp"
+
+/*
+-------------------------------------------------------------------------------
+ vtab_tests.cpp - mem_* tables answer key lookups exactly like a scan
+-------------------------------------------------------------------------------
+Each query runs twice over the seeded store: once as written, where an
+equality on a key column may use the store's indexes, and once with the
+column wrapped in unary "+", which hides it from xBestIndex and forces a
+full scan. Both must count the same rows, under BINARY and under NOCASE.
+-------------------------------------------------------------------------------
+*/
+
+#include <string>
+
+namespace {
+
+// count(*) of `sql`, or -1 on error.
+long long count_of(sqlite3* db, const std::string& sql) {
+    sqlite3_stmt* st = nullptr;
+    if (sqlite3_prepare_v2(db, sql.c_str(), -1, &st, nullptr) != SQLITE_OK) return -1;
+    const long long n = sqlite3_step(st) == SQLITE_ROW ? sqlite3_column_int64(st, 0) : -1;
+    sqlite3_finalize(st);
+    return n;
+}
+
+// `where` uses the key column `col`; the scan twin reads "+col" instead.
+bool same_as_scan(sqlite3* db, const std::string& table, const std::string& col, const std::string& where,
+    long long expect) {
+    std::string scan = where;
+    for (size_t at = scan.find(col); at != std::string::npos; at = scan.find(col, at + col.size() + 1))
+        scan.insert(at, "+");
+    const long long indexed = count_of(db, "SELECT count(*) FROM " + table + " WHERE " + where);
+    const long long scanned = count_of(db, "SELECT count(*) FROM " + table + " WHERE " + scan);
+    if (indexed == scanned && indexed == expect) return true;
+    std::printf("  %s WHERE %s: %lld by key, %lld by scan, expected %lld\n",
+        table.c_str(), where.c_str(), indexed, scanned, expect);
+    return false;
+}
+
+} // namespace
+
+TEST(vtab_key_lookups_match_scan) {
+    sqlite3* db = nullptr;
+    REQUIRE(db_open(db, ":memory:", db_profile_balanced()) && db_init_and_seed(db));
+    DataStore d;
+    REQUIRE(db_load_all(db, d));
+    REQUIRE(store_vtab_register(db, d));
+
+    CHECK(same_as_scan(db, "mem_students", "roll_no", "roll_no = 'S001'", 1));
+    CHECK(same_as_scan(db, "mem_students", "roll_no", "roll_no = 's001'", 0));
+    CHECK(same_as_scan(db, "mem_students", "roll_no", "roll_no = 'nonsense'", 0));
+    CHECK(same_as_scan(db, "mem_students", "roll_no", "roll_no = 's001' COLLATE NOCASE", 1));
+    CHECK(same_as_scan(db, "mem_courses", "code", "code = 'mth101' COLLATE NOCASE", 1));
+    CHECK(same_as_scan(db, "mem_grades", "course_code", "course_code = 'MTH101'", 2));
+    CHECK(same_as_scan(db, "mem_grades", "course_code", "course_code = 'mth101' COLLATE NOCASE", 2));
+    CHECK(same_as_scan(db, "mem_grades", "roll_no",
+        "roll_no = 's001' COLLATE NOCASE AND course_code = 'MTH101'", 1));
+    db_close(db);
+}
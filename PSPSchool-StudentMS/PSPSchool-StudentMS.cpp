@@ -9,10 +9,13 @@
 
  Data flow (very important):
    - Persistent store: SQLite (via db.hpp functions)
-   - In-memory cache: DataStore (services.hpp)
-   - Pattern on writes: Attempt DB change first; if success, apply the same
-     change to the in-memory DataStore (keeps both in sync). If either side
-     fails, we print a message and abort that operation.
+   - In-memory cache: DataStore (services.hpp), attached to the connection
+     with db_sync_attach
+   - Pattern on writes (write-behind): apply the change to the DataStore with
+     the services.hpp / helpers.hpp function, then queue the matching db_*
+     call with db_write_async. A background writer commits queued writes in
+     batches, so the menu never waits on the disk. If the database refuses a
+     queued write, db_writer_reconcile reloads the cache from it.
 
  User input model:
    - All text fields are validated with helpers in validation.hpp
@@ -23,8 +26,9 @@
 
  Conventions & Notes for contributors:
    - Keep UI copy short and consistent; prefer full words over abbreviations.
-   - Keep the DB and DataStore changes paired and ordered: DB first, then
-     in-memory. This ensures DB remains source of truth.
+   - Every cache change in a handler must be paired with the db_* write
+     that makes it durable; the DB stays the source of truth (the cache is
+     reloaded from it whenever a queued write fails).
    - If you add new menu items, maintain the ASCII banner width (45-45-45 lines)
      and adjust the counters line if you display live counts.
    - Validation rules live in validation.hpp; please reuse them to maintain
@@ -42,8 +46,23 @@
 #include <iostream>
 #include <limits>
 #include <iomanip>
+#include <sstream>
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <thread>
 #include "services.hpp"     // DataStore, Student, Course, Grade, add/modify helpers
 #include "db.hpp"           // SQLite bridge: open/init/CRUD functions
+#include "store_vtab.hpp"   // mem_students/mem_courses/mem_grades SQL views of the cache
+#include "csv_import.hpp"   // bulk CSV import (sms import ...)
+#include "batch_exec.hpp"   // command scripts (sms exec ...)
+#include "data_export.hpp"  // CSV / JSON export of the cache (sms export ...)
+#include "http_server.hpp"  // HTTP/JSON API over the cache (sms serve ...)
+#include "load_test.hpp"    // load generator for the API (sms loadtest ...)
 #include "validation.hpp"   // Input validation helpers and InputCtl enum
 #include "helpers.hpp"      // Prompt utilities (prompt_until_valid_or_back, etc.)
 using namespace std;         // OK for this small console app; avoid in headers
@@ -62,22 +81,406 @@ static void showWelcome() {
 }
 
 //-----------------------------------------
-int main() {
-    showWelcome();
+// Report texts equal up to the last printed digit of each number. The cache
+// and SQLite add the same weighted marks in different orders, and averages
+// of 2-decimal marks often sit exactly on a rounding tie at the 6th
+// significant digit, where the last bit decides which way it prints.
+static bool same_report(const std::string& a, const std::string& b) {
+    const char* p = a.c_str();
+    const char* q = b.c_str();
+    while (*p && *q) {
+        if (std::isdigit(static_cast<unsigned char>(*p)) && std::isdigit(static_cast<unsigned char>(*q))) {
+            char* pe;
+            char* qe;
+            const double x = std::strtod(p, &pe), y = std::strtod(q, &qe);
+            if (std::fabs(x - y) > 1e-5 * std::max(1.0, std::fabs(x))) return false;
+            p = pe;
+            q = qe;
+        }
+        else if (*p++ != *q++) return false;
+    }
+    return !*p && !*q;
+}
+
+// Run student_report/course_report and their SQL twins (db_*_report) for
+// every student and course and compare the text (same_report). Prints the
+// first few mismatches; returns true if there were none.
+static bool check_reports(sqlite3* db, const DataStore& data) {
+    int checked = 0, mismatches = 0;
+    auto compare = [&](const std::string& what, const std::string& mem, const std::string& sql) {
+        ++checked;
+        if (same_report(mem, sql)) return;
+        if (++mismatches <= 5)
+            std::cout << "Mismatch for " << what << ":\n--- cache\n" << mem << "--- sql\n" << sql;
+    };
+    for (const Student& s : data.all_students) {
+        std::ostringstream mem, sql;
+        student_report(data, s.roll_no, mem);
+        if (!db_student_report(db, s.roll_no, sql)) sql << "(database error)\n";
+        compare(to_string(s.roll_no), mem.str(), sql.str());
+    }
+    for (const Course& c : data.all_courses) {
+        std::ostringstream mem, sql;
+        course_report(data, c.code, mem);
+        if (!db_course_report(db, c.code, sql)) sql << "(database error)\n";
+        compare(to_string(c.code), mem.str(), sql.str());
+    }
+    std::cout << "Reports checked: " << checked << ", mismatches: " << mismatches << "\n";
+    return mismatches == 0;
+}
+
+//-----------------------------------------
+// After a headless write command (exec, import): bring school.snap up to
+// the new log head, which also prunes sms_changes (db_sync_save_snapshot).
+// Without this only the menu or `serve` trim the log, and a nightly script
+// would grow it without bound. Costs one snapshot load + replay.
+static bool save_snapshot(sqlite3* db) {
+    DataStore data;
+    if (db_sync_attach(db, data, "school.snap") && db_sync_save_snapshot(db, "school.snap")) return true;
+    std::cout << "Could not save school.snap; the change log was not pruned.\n";
+    return false;
+}
+
+//-----------------------------------------
+// Run every statement in `sql` and print the rows like the sqlite3 shell's
+// default list mode (columns separated by '|', NULL as empty). Stops at the
+// first error.
+static bool run_sql(sqlite3* db, const std::string& sql) {
+    const char* tail = sql.c_str();
+    while (*tail) {
+        sqlite3_stmt* st = nullptr;
+        if (sqlite3_prepare_v2(db, tail, -1, &st, &tail) != SQLITE_OK) {
+            std::cout << "Error: " << sqlite3_errmsg(db) << "\n";
+            return false;
+        }
+        if (!st) continue;   // whitespace or comment
+        int rc;
+        while ((rc = sqlite3_step(st)) == SQLITE_ROW) {
+            for (int c = 0; c < sqlite3_column_count(st); ++c) {
+                const unsigned char* v = sqlite3_column_text(st, c);
+                std::cout << (c ? "|" : "") << (v ? reinterpret_cast<const char*>(v) : "");
+            }
+            std::cout << "\n";
+        }
+        if (rc != SQLITE_DONE) std::cout << "Error: " << sqlite3_errmsg(db) << "\n";
+        sqlite3_finalize(st);
+        if (rc != SQLITE_DONE) return false;
+    }
+    return true;
+}
+
+//-----------------------------------------
+// Up to `n` existing enrollments with their current marks, for the write
+// benchmarks to rewrite unchanged.
+static std::vector<Grade> bench_rows(sqlite3* db, int n) {
+    std::vector<Grade> rows;
+    if (!db_first_grades(db, n, rows) || rows.empty()) {
+        std::cout << "No enrollments to write.\n";
+        rows.clear();
+    }
+    return rows;
+}
+
+//-----------------------------------------
+// Concurrent marks entry, two ways: every thread commits each
+// db_enter_marks on its own connection (one transaction and sync per call),
+// then every thread calls db_enter_marks_grouped on one writer that holds
+// each batch open for 2 ms / 256 rows. Rewrites existing enrollments with
+// the marks they already have, so the data is unchanged. Prints throughput
+// and latency percentiles; returns false if any write failed. `synchronous`
+// (e.g. "FULL", so every commit syncs) overrides the profile's setting.
+static bool bench_marks(sqlite3* db, int threads, int per_thread, const std::string& synchronous) {
+    if (!synchronous.empty() && !run_sql(db, "PRAGMA synchronous = " + synchronous)) return false;
+    const std::vector<Grade> rows = bench_rows(db, threads * per_thread);
+    if (rows.empty()) return false;
+
+    using Clock = std::chrono::steady_clock;
+    bool all_ok = true;
+    // Run `write(thread, row)` from `threads` threads, `per_thread` times each.
+    auto run = [&](const char* label, auto&& write) {
+        std::vector<std::vector<double>> lat(threads);
+        std::atomic<int> failed{ 0 };
+        std::vector<std::thread> pool;
+        const auto t0 = Clock::now();
+        for (int t = 0; t < threads; ++t) {
+            pool.emplace_back([&, t] {
+                for (int i = 0; i < per_thread; ++i) {
+                    const Grade& g = rows[(static_cast<size_t>(t) * per_thread + i) % rows.size()];
+                    const auto a = Clock::now();
+                    if (!write(t, g)) ++failed;
+                    lat[t].push_back(std::chrono::duration<double, std::milli>(Clock::now() - a).count());
+                }
+                });
+        }
+        for (auto& th : pool) th.join();
+        const double secs = std::chrono::duration<double>(Clock::now() - t0).count();
+        std::vector<double> all;
+        for (const auto& v : lat) all.insert(all.end(), v.begin(), v.end());
+        std::sort(all.begin(), all.end());
+        auto pct = [&](double p) { return all[std::min(all.size() - 1, static_cast<size_t>(p * all.size()))]; };
+        std::cout << std::fixed << std::setprecision(2) << std::left << std::setw(14) << label
+            << std::right << std::setw(10) << all.size() / secs << " writes/s   p50 "
+            << pct(0.50) << " ms   p99 " << pct(0.99) << " ms   max " << all.back() << " ms";
+        if (failed) std::cout << "   (" << failed << " failed)";
+        std::cout << "\n";
+        all_ok = all_ok && failed == 0;
+    };
+
+    DbProfile profile;
+    db_read_profile(db, profile);
+    std::cout << threads << " threads x " << per_thread << " db_enter_marks calls (synchronous="
+        << profile.synchronous << ")\n";
+
+    // Per call: one connection per thread, each call its own transaction.
+    const std::string path = sqlite3_db_filename(db, "main");
+    std::vector<sqlite3*> conns(threads, nullptr);
+    for (auto& c : conns)
+        if (!db_open(c, path, profile)) { std::cout << "Could not open a connection.\n"; return false; }
+    run("per call", [&](int t, const Grade& g) {
+        return db_enter_marks(conns[t], g.roll_no, g.course_code, g.internal_mark, g.final_mark);
+        });
+    for (auto* c : conns) db_close(c);
+
+    // Group commit: every caller waits for its batch's single COMMIT.
+    DbWriterOptions group;
+    group.group_window_us = 2000;
+    group.max_batch = 256;
+    if (!db_writer_start(db, group)) { std::cout << "Could not start the writer.\n"; return false; }
+    run("group commit", [&](int, const Grade& g) {
+        return db_enter_marks_grouped(db, g.roll_no, g.course_code, g.internal_mark, g.final_mark);
+        });
+    db_writer_stop(db);
+    return all_ok;
+}
+
+//-----------------------------------------
+// The statement cache (db.cpp), off and on: `n` calls each of
+// db_enter_marks (rewriting existing marks unchanged, inside one
+// transaction so the commit does not hide the per-call cost), db_get_counts
+// and db_course_top, first preparing and finalizing the SQL on every call as
+// before the cache, then with the cached statements. Prints calls/s for both
+// and the speed-up; returns false if any call failed.
+static bool bench_statements(sqlite3* db, int n) {
+    const std::vector<Grade> rows = bench_rows(db, n);
+    if (rows.empty()) return false;
+    using Clock = std::chrono::steady_clock;
+    bool all_ok = true;
+    // Calls/s of `n` calls to `call(row)`, with the cache off and then on.
+    auto run = [&](const char* label, auto&& call) {
+        double per_s[2] = {};
+        for (int cached = 0; cached < 2; ++cached) {
+            db_set_stmt_cache(db, cached != 0);
+            int failed = 0;
+            const auto t0 = Clock::now();
+            if (!db_begin(db)) { all_ok = false; return; }
+            for (int i = 0; i < n; ++i)
+                if (!call(rows[static_cast<size_t>(i) % rows.size()])) ++failed;
+            if (!db_commit(db)) ++failed;
+            per_s[cached] = n / std::chrono::duration<double>(Clock::now() - t0).count();
+            all_ok = all_ok && failed == 0;
+        }
+        std::cout << std::fixed << std::setprecision(0) << std::left << std::setw(16) << label
+            << std::right << std::setw(10) << per_s[0] << " calls/s uncached  "
+            << std::setw(10) << per_s[1] << " calls/s cached   x"
+            << std::setprecision(2) << per_s[1] / per_s[0] << "\n";
+    };
+    DbCounts counts;
+    std::vector<Grade> top;
+    std::cout << n << " calls each\n";
+    run("db_enter_marks", [&](const Grade& g) {
+        return db_enter_marks(db, g.roll_no, g.course_code, g.internal_mark, g.final_mark);
+        });
+    run("db_get_counts", [&](const Grade&) { return db_get_counts(db, counts); });
+    run("db_course_top", [&](const Grade& g) { return db_course_top(db, g.course_code, 10, top); });
+    db_set_stmt_cache(db, true);
+    if (!all_ok) std::cout << "Some calls failed.\n";
+    return all_ok;
+}
+
+//-----------------------------------------
+// The cache's per-student / per-course grade lists at scale, in memory only
+// (school.db is not touched): `students` students each taking `per_student`
+// of 200 courses (1M grades by default). Times student_report,
+// course_report, remove_student and remove_course against one pass over
+// every grade, which is what each of them cost before the adjacency lists.
+// Returns false if the store has the wrong number of grades afterwards.
+static bool bench_store(int students, int per_student) {
+    using Clock = std::chrono::steady_clock;
+    const int courses = 200;
+    per_student = std::min(per_student, courses);
+    auto ms_since = [](Clock::time_point t0) {
+        return std::chrono::duration<double, std::milli>(Clock::now() - t0).count();
+    };
+    auto roll_at = [](int i) { RollId r; parse_roll("S" + std::to_string(100000 + i), r); return r; };
+    auto code_at = [](int i) { CourseId c; parse_course("BEN" + std::to_string(100 + i), c); return c; };
+
+    DataStore d;
+    for (int i = 0; i < students; ++i) d.all_students.push_back({ roll_at(i), "Bench Student", "1 Bench St", "021-555-0101" });
+    for (int i = 0; i < courses; ++i) d.all_courses.push_back({ code_at(i), "Bench", "Bench course", "Bench Teacher" });
+    d.all_grades.reserve(static_cast<size_t>(students) * per_student);
+    for (int i = 0; i < students; ++i)
+        for (int k = 0; k < per_student; ++k)   // 7k mod 200 is distinct for k < 200
+            d.all_grades.push_back({ roll_at(i), code_at((i + 7 * k) % courses), double((i + k) % 101), double((i * 3 + k) % 101) });
+    auto t0 = Clock::now();
+    store_rebuild_indexes(d);
+    std::cout << students << " students, " << courses << " courses, " << d.all_grades.size()
+        << " grades; indexes built in " << std::fixed << std::setprecision(1) << ms_since(t0) << " ms\n";
+
+    // Print one line: `label`, `calls` calls in `ms`.
+    auto line = [](const char* label, int calls, double ms) {
+        std::cout << std::fixed << std::setprecision(4) << std::left << std::setw(30) << label
+            << std::right << std::setw(10) << ms / calls << " ms/call\n";
+    };
+    std::ostringstream sink;
+    const int n = std::min(students, 1000);
+    size_t found = 0;
+    t0 = Clock::now();
+    for (int i = 0; i < 100; ++i) {
+        const RollId r = roll_at(i * 37 % students);
+        for (RollId g : d.all_grades.roll_no) found += g == r;
+    }
+    line("scan of every grade", 100, ms_since(t0));
+    t0 = Clock::now();
+    for (int i = 0; i < n; ++i) { sink.str(""); student_report(d, roll_at(i * 37 % students), sink); }
+    line("student_report", n, ms_since(t0));
+    t0 = Clock::now();
+    for (int i = 0; i < courses; ++i) { sink.str(""); course_report(d, code_at(i), sink); }
+    line("course_report", courses, ms_since(t0));
+
+    // Cascading deletes: 100 students, then one course.
+    const int gone = std::min(students, 100);
+    t0 = Clock::now();
+    for (int i = 0; i < gone; ++i) remove_student(d, roll_at(i));
+    line("remove_student", gone, ms_since(t0));
+    const size_t before = d.all_grades.size();
+    const size_t in_course = course_grade_slots(d, code_at(5)).size();
+    t0 = Clock::now();
+    remove_course(d, code_at(5));
+    line("remove_course", 1, ms_since(t0));
+
+    const size_t expected = static_cast<size_t>(students) * per_student - static_cast<size_t>(gone) * per_student;
+    const bool ok = before == expected && d.all_grades.size() == expected - in_course && found > 0;
+    if (!ok) std::cout << "Unexpected grade count after the deletes.\n";
+    return ok;
+}
+
+//-----------------------------------------
+// Per-course ranking two ways: read from the grades_course_rank index
+// (db_course_top, db_grades_below: SQL, already in order) and sorted in C++
+// over the cache's grade slots for the course (std::partial_sort for the
+// top 10, filter + std::sort for the "below pass mark" list). Every course
+// is run `rounds` times; prints the mean time per course and returns false
+// if the two sides disagree on a row count.
+static bool bench_rank(sqlite3* db, const DataStore& data, int rounds) {
+    using Clock = std::chrono::steady_clock;
+    if (data.all_courses.empty()) { std::cout << "No courses to rank.\n"; return false; }
+    const double per_course = static_cast<double>(data.all_courses.size()) * rounds;
+    size_t sql_rows = 0, cpp_rows = 0;
+    // Time `run(code)` over every course; it returns the rows it produced.
+    auto time = [&](const char* label, size_t& rows, auto&& run) {
+        const auto t0 = Clock::now();
+        for (int r = 0; r < rounds; ++r)
+            for (const Course& c : data.all_courses) rows += run(c.code);
+        const double ms = std::chrono::duration<double, std::milli>(Clock::now() - t0).count();
+        std::cout << std::fixed << std::setprecision(4) << std::left << std::setw(28) << label
+            << std::right << std::setw(10) << ms / per_course << " ms/course\n";
+    };
+    auto by_rank = [&](std::uint32_t a, std::uint32_t b) {
+        const double wa = store_weighted_at(data, a), wb = store_weighted_at(data, b);
+        return wa != wb ? wa > wb : data.all_grades.roll_no[a] < data.all_grades.roll_no[b];
+    };
+    std::vector<Grade> out;
+    std::vector<std::uint32_t> slots;
+    bool ok = true;
+
+    std::cout << data.all_courses.size() << " courses, " << data.all_grades.size() << " grades, "
+        << rounds << " round(s)\n";
+    time("top 10, SQL (index)", sql_rows, [&](CourseId code) {
+        ok = db_course_top(db, code, 10, out) && ok;
+        return out.size();
+        });
+    time("top 10, C++ partial_sort", cpp_rows, [&](CourseId code) {
+        slots = course_grade_slots(data, code);
+        const size_t k = std::min<size_t>(10, slots.size());
+        std::partial_sort(slots.begin(), slots.begin() + k, slots.end(), by_rank);
+        return k;
+        });
+    ok = ok && sql_rows == cpp_rows;
+
+    sql_rows = cpp_rows = 0;
+    time("below pass, SQL (index)", sql_rows, [&](CourseId code) {
+        ok = db_grades_below(db, code, PASS_MARK, out) && ok;
+        return out.size();
+        });
+    time("below pass, C++ sort", cpp_rows, [&](CourseId code) {
+        slots.clear();
+        for (std::uint32_t s : course_grade_slots(data, code))
+            if (store_weighted_at(data, s) < PASS_MARK) slots.push_back(s);
+        std::sort(slots.begin(), slots.end(), [&](std::uint32_t a, std::uint32_t b) { return by_rank(b, a); });
+        return slots.size();
+        });
+    ok = ok && sql_rows == cpp_rows;
+    if (!ok) std::cout << "SQL and C++ disagree (or a query failed).\n";
+    return ok;
+}
+
+int main(int argc, char* argv[]) {
+    // Only the menu prints the banner and the database/load lines below;
+    // the commands keep stdout to their own output for scripts and pipes.
+
+    // The API server and its load generator are Linux only (SMS_HAVE_HTTP).
+    if (!SMS_HAVE_HTTP && argc > 1 && (std::string(argv[1]) == "serve" || std::string(argv[1]) == "loadtest")) {
+        std::cout << "sms " << argv[1] << " is not supported on this platform (it needs Linux).\n";
+        return 1;
+    }
 
-    // In-memory mirror of the database. "data" must be kept in sync with DB
-    // changes; we always write to DB first, then update this cache.
+    // `sms bench-store [students] [courses-per-student]`: cache reports and
+    // cascading deletes on a synthetic 1M-grade store (see bench_store).
+    // In memory only; it never opens school.db.
+    if (argc > 1 && std::string(argv[1]) == "bench-store") {
+        const int students = argc > 2 ? std::max(1, std::atoi(argv[2])) : 50000;
+        const int per_student = argc > 3 ? std::max(1, std::atoi(argv[3])) : 20;
+        return bench_store(students, per_student) ? 0 : 1;
+    }
+
+    // `sms loadtest [port] [connections] [seconds] [write%]`: drive a running
+    // `sms serve` (load_test.hpp). A client only; it never opens school.db.
+    if (argc > 1 && std::string(argv[1]) == "loadtest") {
+        LoadTestOptions opt;
+        if (argc > 2) opt.port = std::atoi(argv[2]);
+        if (argc > 3) opt.connections = std::max(1, std::atoi(argv[3]));
+        if (argc > 4) opt.seconds = std::max(1, std::atoi(argv[4]));
+        if (argc > 5) opt.write_percent = std::min(100, std::max(0, std::atoi(argv[5])));
+        LoadTestReport rep;
+        if (!http_load_test(opt, rep)) {
+            std::cout << "Could not load-test " << opt.host << ":" << opt.port
+                << " (is `sms serve` running, with enrollments?)\n";
+            return 1;
+        }
+        std::cout << rep.requests << " requests (" << rep.writes << " writes, " << rep.errors << " errors) over "
+            << opt.connections << " connections in " << std::fixed << std::setprecision(1) << rep.seconds << " s: "
+            << std::setprecision(0) << rep.requests / rep.seconds << " req/s, latency p50 "
+            << std::setprecision(2) << rep.p50_ms << " ms, p99 " << rep.p99_ms << " ms, max " << rep.max_ms << " ms\n";
+        return rep.errors == 0 ? 0 : 1;
+    }
+
+    // In-memory mirror of the database. Menu writes are write-behind: they
+    // change this cache first and queue the matching db_* call on the
+    // background writer; if the database refuses one, db_writer_reconcile
+    // reloads the cache from the file.
     DataStore data;
 
     // --- Database bootstrap -------------------------------------------------
     sqlite3* db = nullptr;
 
     // Open or create the SQLite file. If this fails, we cannot continue.
-    if (!db_open(db, "school.db")) {
+    // The balanced profile (WAL + synchronous=NORMAL) keeps commits cheap and
+    // lets a second reader (e.g. DB Browser) look at the file while we write.
+    DbProfile applied;
+    if (!db_open(db, "school.db", db_profile_balanced(), &applied)) {
         std::cout << "Could not open database.\n";
         return 1;
     }
-
     // Initialize schema and seed sample data on first run. If this fails,
     // bail out to avoid running with a partial/unknown schema.
     if (!db_init_and_seed(db)) {
@@ -86,11 +489,223 @@ int main() {
         return 1;
     }
 
+    const std::string command = argc > 1 ? argv[1] : "";
+
+    // `sms --check-plans` (for CI): exit non-zero if any SQL the app issues
+    // would scan a whole table instead of using an index.
+    if (command == "--check-plans") {
+        std::vector<std::string> problems;
+        const bool plans_ok = db_check_query_plans(db, problems);
+        for (const auto& p : problems) std::cout << p << "\n";
+        std::cout << (plans_ok ? "Query plans OK\n" : "Query plan check FAILED\n");
+        db_close(db);
+        return plans_ok ? 0 : 1;
+    }
+
+    // `sms report student <roll>` / `sms report course <code>`: answered by
+    // SQL from the covering indexes, without loading the cache at all.
+    if (command == "report") {
+        const std::string kind = argc > 2 ? argv[2] : "";
+        const std::string key = argc > 3 ? argv[3] : "";
+        bool ok = false;
+        if (kind == "student") {
+            RollId id;
+            if (!parse_roll(key, id)) std::cout << "Invalid roll number.\n";
+            else ok = db_student_report(db, id, std::cout);
+        }
+        else if (kind == "course") {
+            CourseId code;
+            if (!parse_course(key, code)) std::cout << "Invalid course code.\n";
+            else ok = db_course_report(db, code, std::cout);
+        }
+        else {
+            std::cout << "Usage: sms report student <roll_no> | sms report course <code>\n";
+        }
+        db_close(db);
+        return ok ? 0 : 1;
+    }
+
+    // `sms import <students|courses|enrollments|marks> <file.csv>`: bulk
+    // load; the cache picks the rows up from the database on the next start.
+    // Rejected rows are listed in <file.csv>.errors.txt.
+    if (command == "import") {
+        ImportKind kind;
+        if (argc < 4 || !parse_import_kind(argv[2], kind)) {
+            std::cout << "Usage: sms import <students|courses|enrollments|marks> <file.csv>\n";
+            db_close(db);
+            return 1;
+        }
+        const std::string path = argv[3];
+        ImportReport rep;
+        const bool import_ok = csv_import(db, kind, path, rep);
+        if (!import_ok && rep.rows == 0 && rep.errors.empty()) {
+            std::cout << "Could not read " << path << "\n";
+            db_close(db);
+            return 1;
+        }
+        std::cout << "Imported " << rep.imported << " of " << rep.rows << " rows in "
+            << static_cast<long long>(rep.ms + 0.5) << " ms (" << rep.threads
+            << (rep.threads == 1 ? " parser thread" : " parser threads") << ")";
+        if (rep.ms > 0) std::cout << ", " << static_cast<long long>(rep.rows / rep.ms * 1000) << " rows/s";
+        std::cout << "\n";
+        if (!rep.errors.empty()) {
+            const std::string report_path = path + ".errors.txt";
+            std::ofstream report(report_path);
+            for (const ImportError& e : rep.errors) report << "line " << e.line << ": " << e.message << "\n";
+            for (size_t i = 0; i < rep.errors.size() && i < 10; ++i)
+                std::cout << "  line " << rep.errors[i].line << ": " << rep.errors[i].message << "\n";
+            std::cout << rep.rejected << " row(s) rejected; full list in " << report_path << "\n";
+        }
+        if (rep.imported > 0) save_snapshot(db);
+        db_close(db);
+        return import_ok ? 0 : 1;
+    }
+
+    // `sms exec <script.txt>` / `... | sms exec`: run a command script
+    // (batch_exec.hpp) without the menu, e.g. from cron. Writes go through
+    // the background writer in batched transactions; reports are SQL, so
+    // the cache is not loaded.
+    if (command == "exec") {
+        ExecReport rep;
+        bool exec_ok = false;
+        const std::string path = argc > 2 ? argv[2] : "-";
+        if (path == "-") {
+            exec_ok = exec_script(db, std::cin, std::cout, rep);
+        }
+        else {
+            std::ifstream script(path);
+            if (!script) {
+                std::cout << "Could not read " << path << "\n";
+                db_close(db);
+                return 1;
+            }
+            exec_ok = exec_script(db, script, std::cout, rep);
+        }
+        for (const ExecError& e : rep.errors) std::cout << "line " << e.line << ": " << e.message << "\n";
+        std::cout << "Ran " << rep.commands << " commands (" << rep.writes << " writes, " << rep.failed
+            << " failed) in " << static_cast<long long>(rep.ms + 0.5) << " ms";
+        if (rep.ms > 0) std::cout << ", " << static_cast<long long>(rep.commands / rep.ms * 1000) << " commands/s";
+        std::cout << "\n";
+        if (rep.writes > 0) save_snapshot(db);
+        db_close(db);
+        return exec_ok ? 0 : 1;
+    }
+
+    // `sms bench-marks [threads] [writes-per-thread] [synchronous]`:
+    // concurrent marks entry with and without group commit (see bench_marks).
+    if (command == "bench-marks") {
+        const int threads = argc > 2 ? std::max(1, std::atoi(argv[2])) : 16;
+        const int per_thread = argc > 3 ? std::max(1, std::atoi(argv[3])) : 200;
+        const bool bench_ok = bench_marks(db, threads, per_thread, argc > 4 ? argv[4] : "");
+        db_close(db);
+        return bench_ok ? 0 : 1;
+    }
+
+    // `sms bench-statements [calls]`: the same db_* calls with the statement
+    // cache off (prepare per call) and on (see bench_statements).
+    if (command == "bench-statements") {
+        const bool bench_ok = bench_statements(db, argc > 2 ? std::max(1, std::atoi(argv[2])) : 20000);
+        db_close(db);
+        return bench_ok ? 0 : 1;
+    }
+
     // Load all rows into the in-memory cache (DataStore) so reads are fast
-    // and we can render reports without hitting the DB each time.
-    db_load_all(db, data);
+    // and we can render reports without hitting the DB each time. From here
+    // on, every committed write on `db` is mirrored into `data` automatically.
+    // school.snap (written at exit) makes this a file map + small delta
+    // instead of a full table scan; it is rebuilt if missing or stale.
+    DbLoadReport load;
+    if (!db_sync_attach(db, data, "school.snap", &load)) {
+        std::cout << "Could not load data.\n";
+        db_close(db);
+        return 1;
+    }
+    auto ms1 = [](double ms) { return static_cast<long long>(ms * 10 + 0.5) / 10.0; };
+
+    // Expose the cache to SQL on this connection (read-only, zero copy), so
+    // queries can join mem_* tables against memory instead of the file.
+    store_vtab_register(db, data);
+
+    // `sms sql "<statements>"`: ad-hoc SQL against the live cache, e.g.
+    //   sms sql "SELECT count(*) FROM mem_grades WHERE weighted >= 50"
+    if (command == "sql") {
+        const bool sql_ok = argc > 2 && run_sql(db, argv[2]);
+        if (argc <= 2) std::cout << "Usage: sms sql \"<statements>\"\n";
+        db_close(db);
+        return sql_ok ? 0 : 1;
+    }
+
+    // `sms export <students|courses|enrollments|all> <csv|json|arrow> <file>`:
+    // write the cache out ("all" is JSON only, Arrow is enrollments only).
+    if (command == "export") {
+        ExportKind kind;
+        ExportFormat format;
+        if (argc < 5 || !parse_export_kind(argv[2], kind) || !parse_export_format(argv[3], format)) {
+            std::cout << "Usage: sms export <students|courses|enrollments|all> <csv|json|arrow> <file>\n";
+            db_close(db);
+            return 1;
+        }
+        ExportReport rep;
+        const bool export_ok = export_store(data, kind, format, argv[4], rep);
+        if (export_ok)
+            std::cout << "Exported " << rep.rows << " rows (" << rep.bytes / 1024 << " KiB) to " << argv[4]
+                << " in " << ms1(rep.ms) << " ms\n";
+        else
+            std::cout << "Could not export to " << argv[4]
+                << (kind == ExportKind::All && format == ExportFormat::Csv ? " (\"all\" needs json)" : "")
+                << (format == ExportFormat::Arrow && kind != ExportKind::Enrollments ? " (arrow is enrollments only)" : "")
+                << "\n";
+        db_close(db);
+        return export_ok ? 0 : 1;
+    }
+
+    // `sms bench-rank [rounds]`: class ranking from the grades_course_rank
+    // index against sorting the cache in C++ (see bench_rank).
+    if (command == "bench-rank") {
+        const bool bench_ok = bench_rank(db, data, argc > 2 ? std::max(1, std::atoi(argv[2])) : 1);
+        db_close(db);
+        return bench_ok ? 0 : 1;
+    }
+
+    // `sms --check-reports`: the SQL reports must print what the
+    // cache-driven ones do, for every student and course.
+    if (command == "--check-reports") {
+        const bool reports_ok = check_reports(db, data);
+        db_close(db);
+        return reports_ok ? 0 : 1;
+    }
+
+    // Interactive writes go through a background writer from here on.
+    db_writer_start(db);
+
+    // `sms serve [port] [workers]`: the HTTP/JSON API (http_server.hpp) on
+    // 127.0.0.1 instead of the menu, until Ctrl+C.
+    if (command == "serve") {
+        HttpServerOptions opt;
+        if (argc > 2) opt.port = std::atoi(argv[2]);
+        if (argc > 3) opt.workers = static_cast<unsigned>(std::max(1, std::atoi(argv[3])));
+        const bool serve_ok = http_serve(db, data, opt);
+        db_writer_flush(db);
+        db_writer_reconcile(db);   // a refused write must not reach the snapshot
+        db_sync_save_snapshot(db, "school.snap");
+        db_close(db);
+        return serve_ok ? 0 : 1;
+    }
 
     // --- Menu loop ----------------------------------------------------------
+    showWelcome();
+    std::cout << "Database: " << applied.name
+        << " (journal=" << applied.journal_mode
+        << ", synchronous=" << applied.synchronous << ")\n";
+    std::cout << "Loaded from " << load.source;
+    if (load.replayed) std::cout << " (" << load.replayed << " changes replayed)";
+    std::cout << " in " << ms1(load.ms) << " ms\n";
+    if (load.readers)
+        std::cout << "  counts " << ms1(load.count_ms) << " ms, read " << ms1(load.read_ms) << " ms ("
+                  << load.readers << (load.readers == 1 ? " connection" : " connections") << "), merge "
+                  << ms1(load.merge_ms) << " ms, indexes " << ms1(load.index_ms) << " ms\n";
+    std::cout << "\n";
+
     int choice = -1;
 
     // Utility to reset the cin state and discard the rest of the current line.
@@ -102,18 +717,35 @@ int main() {
 
     // Main interaction loop. Each branch is documented below.
     while (choice != 0) {
-        // NOTE: The counters line is currently hardcoded in the original code.
-        // For dynamic counts, you could compute sizes from DataStore.
+        if (int lost = db_writer_reconcile(db))
+            std::cout << lost << " change(s) could not be saved; reloaded from the database.\n";
+
+        // Live counts from the DB's trigger-maintained counter row (one
+        // lookup per redraw). While writes are still queued the cache is
+        // ahead of the file, so count the cache instead.
+        DbCounts counts;
+        if (db_writer_pending(db) || !db_get_counts(db, counts)) {
+            counts.students = static_cast<int>(data.all_students.size());
+            counts.courses = static_cast<int>(data.all_courses.size());
+            counts.enrolments = static_cast<int>(data.all_grades.size());
+        }
         std::cout
             << "=====================================================\n"
             << "                      MAIN MENU                      \n"
             << "=====================================================\n"
-            << "    Students: 05   Courses: 07   Enrolments:  12     \n"  // TODO: make dynamic
+            << std::left
+            << "  Students: " << std::setw(6) << counts.students
+            << " Courses: " << std::setw(5) << counts.courses
+            << " Enrolments: " << std::setw(7) << counts.enrolments << "\n"
+            << std::right
             << "-----------------------------------------------------\n"
             << "  [1]  Add student       [2]  View students          \n"
             << "  [3]  Add course        [4]  View courses           \n"
             << "  [5]  Enroll student    [6]  Enter marks            \n"
             << "  [7]  Student report    [13] View enrollments/grades\n"
+            << "  [14] School summary    [15] Course report          \n"
+            << "  [16] Below pass mark   [17] Course top 10          \n"
+            << "  [18] Search students / courses                     \n"
             << "-----------------------------------------------------\n"
             << " EDIT:                                               \n"
             << "  [8]  Edit student    [9]  Edit course              \n"
@@ -138,8 +770,8 @@ int main() {
 
             // Roll number (primary key-like). We reject duplicates up front by
             // checking the in-memory mirror, then rely on DB to enforce too.
-            auto r1 = prompt_until_valid_or_back(
-                "Roll No (e.g. S001)", s.roll_no, is_valid_roll,
+            auto r1 = prompt_roll_or_back(
+                "Roll No (e.g. S001)", s.roll_no,
                 "Invalid roll no. Use S + 3–6 digits (e.g. S001)."
             );
             if (r1 == InputCtl::Back) continue;
@@ -169,11 +801,13 @@ int main() {
             if (r4 == InputCtl::Back) continue;
             if (r4 == InputCtl::Exit) { choice = 0; break; }
 
-            // Persist to DB first, then mirror in-memory.
-            if (db_add_student(db, s) && add_student(data, s))
-                std::cout << "Student added (saved to DB).\n";
+            // Cache first, then queue the INSERT for the background writer.
+            if (add_student(data, s)) {
+                db_write_async(db, [s](sqlite3* w) { return db_add_student(w, s); });
+                std::cout << "Student added.\n";
+            }
             else
-                std::cout << "Could not add student (duplicate or DB error).\n";
+                std::cout << "Could not add student (duplicate).\n";
         }
 
         // ---- 2) View students ---------------------------------------------
@@ -186,9 +820,9 @@ int main() {
         else if (choice == 3) {
             Course c;
 
-            auto a = prompt_until_valid_or_back(
-                "Code (e.g. ENG101)", c.code, is_valid_course_code,
-                "Invalid code. 3 letters + 3 digits."
+            auto a = prompt_course_or_back(
+                "Code (e.g. ENG101)", c.code,
+                "Invalid code. 2-4 letters + 3 digits."
             );
             if (a == InputCtl::Back) continue;
             if (a == InputCtl::Exit) { choice = 0; break; }
@@ -215,10 +849,12 @@ int main() {
             if (e == InputCtl::Back) continue;
             if (e == InputCtl::Exit) { choice = 0; break; }
 
-            if (db_add_course(db, c) && add_course(data, c))
-                std::cout << "Course added (saved to DB).\n";
+            if (add_course(data, c)) {
+                db_write_async(db, [c](sqlite3* w) { return db_add_course(w, c); });
+                std::cout << "Course added.\n";
+            }
             else
-                std::cout << "Could not add course (duplicate or DB error).\n";
+                std::cout << "Could not add course (duplicate).\n";
         }
 
         // ---- 4) View courses ----------------------------------------------
@@ -228,13 +864,14 @@ int main() {
 
         // ---- 5) Enroll student in course ----------------------------------
         else if (choice == 5) {
-            std::string r, code;
+            RollId r;
+            CourseId code;
 
-            auto p1 = prompt_until_valid_or_back("Roll No", r, is_valid_roll, "Invalid roll.");
+            auto p1 = prompt_roll_or_back("Roll No", r, "Invalid roll.");
             if (p1 == InputCtl::Back) continue;
             if (p1 == InputCtl::Exit) { choice = 0; break; }
 
-            auto p2 = prompt_until_valid_or_back("Course Code", code, is_valid_course_code, "Invalid code.");
+            auto p2 = prompt_course_or_back("Course Code", code, "Invalid code.");
             if (p2 == InputCtl::Back) continue;
             if (p2 == InputCtl::Exit) { choice = 0; break; }
 
@@ -242,22 +879,25 @@ int main() {
             if (!exists_course(data, code)) { std::cout << "Course does not exist.\n"; continue; }
             if (already_enrolled(data, r, code)) { std::cout << "Already enrolled.\n"; continue; }
 
-            if (db_enroll(db, r, code) && enroll_student(data, r, code))
-                std::cout << "Enrollment success (saved to DB).\n";
+            if (enroll_student(data, r, code)) {
+                db_write_async(db, [r, code](sqlite3* w) { return db_enroll(w, r, code); });
+                std::cout << "Enrollment success.\n";
+            }
             else
                 std::cout << "Failed to enroll.\n";
         }
 
         // ---- 6) Enter marks ------------------------------------------------
         else if (choice == 6) {
-            std::string r, code;
+            RollId r;
+            CourseId code;
             double im = 0, fm = 0; // internal & final marks (0..100)
 
-            auto p1 = prompt_until_valid_or_back("Roll No", r, is_valid_roll, "Invalid roll.");
+            auto p1 = prompt_roll_or_back("Roll No", r, "Invalid roll.");
             if (p1 == InputCtl::Back) continue;
             if (p1 == InputCtl::Exit) { choice = 0; break; }
 
-            auto p2 = prompt_until_valid_or_back("Course Code", code, is_valid_course_code, "Invalid code.");
+            auto p2 = prompt_course_or_back("Course Code", code, "Invalid code.");
             if (p2 == InputCtl::Back) continue;
             if (p2 == InputCtl::Exit) { choice = 0; break; }
 
@@ -272,8 +912,10 @@ int main() {
             if (n2 == InputCtl::Back) continue;
             if (n2 == InputCtl::Exit) { choice = 0; break; }
 
-            if (db_enter_marks(db, r, code, im, fm) && enter_marks(data, r, code, im, fm))
-                std::cout << "Marks saved (persisted to DB).\n";
+            if (enter_marks(data, r, code, im, fm)) {
+                db_write_async(db, [r, code, im, fm](sqlite3* w) { return db_enter_marks(w, r, code, im, fm); });
+                std::cout << "Marks saved.\n";
+            }
             else
                 std::cout << "Failed to save marks.\n";
         }
@@ -282,21 +924,22 @@ int main() {
         else if (choice == 7) {
             // Simple report driven entirely from the in-memory cache.
             std::string r; std::cout << "Roll No: "; std::getline(std::cin, r);
-            student_report(data, r);
+            RollId id;
+            if (!parse_roll(trim(r), id)) { std::cout << "Invalid roll number.\n"; continue; }
+            student_report(data, id);
         }
 
         // ---- 8) Edit student ----------------------------------------------
         else if (choice == 8) {
-            std::string roll;
-            auto s1 = prompt_until_valid_or_back("Roll No to edit", roll, is_valid_roll, "Invalid roll.");
+            RollId roll;
+            auto s1 = prompt_roll_or_back("Roll No to edit", roll, "Invalid roll.");
             if (s1 == InputCtl::Back) continue;
             if (s1 == InputCtl::Exit) { choice = 0; break; }
 
             // Find the current record in the in-memory cache.
-            Student cur; bool found = false;
-            for (const auto& st : data.all_students)
-                if (st.roll_no == roll) { cur = st; found = true; break; }
+            const Student* found = find_student(data, roll);
             if (!found) { std::cout << "Student not found.\n"; continue; }
+            Student cur = *found;
 
             // Begin with a copy and selectively update changed fields.
             Student upd = cur;
@@ -310,23 +953,24 @@ int main() {
             auto r4 = prompt_edit_string("Contact (NZ phone)", cur.contact, upd.contact, is_valid_phone, "Invalid NZ phone.");
             if (r4 == InputCtl::Back) continue; if (r4 == InputCtl::Exit) { choice = 0; break; }
 
-            if (db_update_student(db, upd) && apply_student_update(data, upd))
-                std::cout << "Student updated (saved to DB).\n";
+            if (apply_student_update(data, upd)) {
+                db_write_async(db, [upd](sqlite3* w) { return db_update_student(w, upd); });
+                std::cout << "Student updated.\n";
+            }
             else
-                std::cout << "Update failed (DB error or not found).\n";
+                std::cout << "Update failed (not found).\n";
         }
 
         // ---- 9) Edit course ------------------------------------------------
         else if (choice == 9) {
-            std::string code;
-            auto c1 = prompt_until_valid_or_back("Course Code to edit", code, is_valid_course_code, "Invalid code.");
+            CourseId code;
+            auto c1 = prompt_course_or_back("Course Code to edit", code, "Invalid code.");
             if (c1 == InputCtl::Back) continue;
             if (c1 == InputCtl::Exit) { choice = 0; break; }
 
-            Course cur; bool found = false;
-            for (const auto& cc : data.all_courses)
-                if (cc.code == code) { cur = cc; found = true; break; }
+            const Course* found = find_course(data, code);
             if (!found) { std::cout << "Course not found.\n"; continue; }
+            Course cur = *found;
 
             Course upd = cur;
 
@@ -339,16 +983,18 @@ int main() {
             auto e3 = prompt_edit_string("Teacher", cur.teacher, upd.teacher, is_valid_name, "Letters/spaces only.");
             if (e3 == InputCtl::Back) continue; if (e3 == InputCtl::Exit) { choice = 0; break; }
 
-            if (db_update_course(db, upd) && apply_course_update(data, upd))
-                std::cout << "Course updated (saved to DB).\n";
+            if (apply_course_update(data, upd)) {
+                db_write_async(db, [upd](sqlite3* w) { return db_update_course(w, upd); });
+                std::cout << "Course updated.\n";
+            }
             else
-                std::cout << "Update failed (DB error or not found).\n";
+                std::cout << "Update failed (not found).\n";
         }
 
         // ---- 10) Delete student -------------------------------------------
         else if (choice == 10) {
-            std::string roll;
-            auto p = prompt_until_valid_or_back("Roll No to delete", roll, is_valid_roll, "Invalid roll.");
+            RollId roll;
+            auto p = prompt_roll_or_back("Roll No to delete", roll, "Invalid roll.");
             if (p == InputCtl::Back) continue;
             if (p == InputCtl::Exit) { choice = 0; break; }
 
@@ -359,16 +1005,19 @@ int main() {
             if (c == InputCtl::Back) continue;
             if (c == InputCtl::Exit) { choice = 0; break; }
 
-            if (db_delete_student(db, roll) && remove_student(data, roll))
-                std::cout << "Student deleted (DB + local grades removed).\n";
+            // remove_student drops the cached grades too, like the FK cascade.
+            if (remove_student(data, roll)) {
+                db_write_async(db, [roll](sqlite3* w) { return db_delete_student(w, roll); });
+                std::cout << "Student deleted (grades removed).\n";
+            }
             else
-                std::cout << "Delete failed (DB error or not found).\n";
+                std::cout << "Delete failed (not found).\n";
         }
 
         // ---- 11) Delete course --------------------------------------------
         else if (choice == 11) {
-            std::string code;
-            auto p = prompt_until_valid_or_back("Course Code to delete", code, is_valid_course_code, "Invalid code.");
+            CourseId code;
+            auto p = prompt_course_or_back("Course Code to delete", code, "Invalid code.");
             if (p == InputCtl::Back) continue;
             if (p == InputCtl::Exit) { choice = 0; break; }
 
@@ -378,21 +1027,24 @@ int main() {
             if (c == InputCtl::Back) continue;
             if (c == InputCtl::Exit) { choice = 0; break; }
 
-            if (db_delete_course(db, code) && remove_course(data, code))
-                std::cout << "Course deleted (DB + local grades removed).\n";
+            if (remove_course(data, code)) {
+                db_write_async(db, [code](sqlite3* w) { return db_delete_course(w, code); });
+                std::cout << "Course deleted (grades removed).\n";
+            }
             else
-                std::cout << "Delete failed (DB error or not found).\n";
+                std::cout << "Delete failed (not found).\n";
         }
 
         // ---- 12) Delete enrollment (student from course) -------------------
         else if (choice == 12) {
-            std::string r, code;
+            RollId r;
+            CourseId code;
 
-            auto p1 = prompt_until_valid_or_back("Roll No", r, is_valid_roll, "Invalid roll.");
+            auto p1 = prompt_roll_or_back("Roll No", r, "Invalid roll.");
             if (p1 == InputCtl::Back) continue;
             if (p1 == InputCtl::Exit) { choice = 0; break; }
 
-            auto p2 = prompt_until_valid_or_back("Course Code", code, is_valid_course_code, "Invalid code.");
+            auto p2 = prompt_course_or_back("Course Code", code, "Invalid code.");
             if (p2 == InputCtl::Back) continue;
             if (p2 == InputCtl::Exit) { choice = 0; break; }
 
@@ -402,10 +1054,12 @@ int main() {
             if (c == InputCtl::Back) continue;
             if (c == InputCtl::Exit) { choice = 0; break; }
 
-            if (db_delete_enrollment(db, r, code) && remove_enrollment(data, r, code))
-                std::cout << "Enrollment deleted (DB).\n";
+            if (remove_enrollment(data, r, code)) {
+                db_write_async(db, [r, code](sqlite3* w) { return db_delete_enrollment(w, r, code); });
+                std::cout << "Enrollment deleted.\n";
+            }
             else
-                std::cout << "Delete failed (DB error or not found).\n";
+                std::cout << "Delete failed (not found).\n";
         }
 
         // ---- 13) View enrollments/grades ----------------------------------
@@ -413,6 +1067,92 @@ int main() {
                 show_enrollments(data);
 }
 
+        // ---- 14) School summary --------------------------------------------
+        else if (choice == 14) {
+            // Institution-wide average/pass rate over every grade (SIMD kernel).
+            school_summary(data);
+        }
+
+        // ---- 15) Course report --------------------------------------------
+        else if (choice == 15) {
+            // Enrolled/average/pass/min/max from the course's running aggregate.
+            CourseId code;
+            auto p = prompt_course_or_back("Course Code", code, "Invalid code.");
+            if (p == InputCtl::Back) continue;
+            if (p == InputCtl::Exit) { choice = 0; break; }
+            course_report(data, code);
+        }
+
+        // ---- 16) Below pass mark in a course --------------------------------
+        else if (choice == 16) {
+            // Answered by SQL: a range read on the course ranking index,
+            // lowest mark first.
+            CourseId code;
+            auto p = prompt_course_or_back("Course Code", code, "Invalid code.");
+            if (p == InputCtl::Back) continue;
+            if (p == InputCtl::Exit) { choice = 0; break; }
+            db_writer_flush(db);   // the query must see queued writes
+            std::vector<Grade> below;
+            if (!db_grades_below(db, code, PASS_MARK, below)) {
+                std::cout << "Query failed.\n";
+                continue;
+            }
+            if (below.empty()) std::cout << "Nobody below " << PASS_MARK << " in " << code << ".\n";
+            for (const Grade& g : below) {
+                const Student* s = find_student(data, g.roll_no);
+                std::cout << g.roll_no << " " << (s ? s->name : std::string("?"))
+                    << " | internal=" << g.internal_mark
+                    << " final=" << g.final_mark
+                    << " weighted=" << g.weighted() << "\n";
+            }
+        }
+
+        // ---- 17) Course ranking ---------------------------------------------
+        else if (choice == 17) {
+            // First 10 entries of the course ranking index; no sort.
+            CourseId code;
+            auto p = prompt_course_or_back("Course Code", code, "Invalid code.");
+            if (p == InputCtl::Back) continue;
+            if (p == InputCtl::Exit) { choice = 0; break; }
+            db_writer_flush(db);
+            std::vector<Grade> top;
+            if (!db_course_top(db, code, 10, top)) {
+                std::cout << "Query failed.\n";
+                continue;
+            }
+            if (top.empty()) std::cout << "No enrolments in " << code << ".\n";
+            for (size_t i = 0; i < top.size(); ++i) {
+                const Grade& g = top[i];
+                const Student* s = find_student(data, g.roll_no);
+                std::cout << std::setw(2) << (i + 1) << ". " << g.roll_no << " "
+                    << (s ? s->name : std::string("?"))
+                    << " | weighted=" << g.weighted() << "\n";
+            }
+        }
+
+        // ---- 18) Search ---------------------------------------------------
+        else if (choice == 18) {
+            // Full-text (FTS5) over names/addresses and course title,
+            // description, teacher; words match as prefixes, best match first.
+            std::string text;
+            auto p = prompt_until_valid_or_back("Search for", text, is_non_empty_short,
+                "Enter 1-60 characters.");
+            if (p == InputCtl::Back) continue;
+            if (p == InputCtl::Exit) { choice = 0; break; }
+            db_writer_flush(db);
+            std::vector<Student> students;
+            std::vector<Course> courses;
+            if (!db_search_students(db, text, 10, students) || !db_search_courses(db, text, 10, courses)) {
+                std::cout << "Search failed.\n";
+                continue;
+            }
+            if (students.empty() && courses.empty()) std::cout << "No matches.\n";
+            for (const Student& s : students)
+                std::cout << "Student " << s.roll_no << " | " << s.name << " | " << s.address << "\n";
+            for (const Course& c : courses)
+                std::cout << "Course  " << c.code << " | " << c.title << " | " << c.teacher << "\n";
+        }
+
         // ---- Unknown option guard -----------------------------------------
         else if (choice != 0) {
             std::cout << "Unknown option.\n";
@@ -420,6 +1160,12 @@ int main() {
     }
 
     // --- Shutdown -----------------------------------------------------------
+    // Settle the queued writes first: the snapshot must not keep a change the
+    // database refused.
+    db_writer_flush(db);
+    if (int lost = db_writer_reconcile(db))
+        std::cout << lost << " change(s) could not be saved before exit and were lost.\n";
+    db_sync_save_snapshot(db, "school.snap");   // best effort; next start falls back to a full load
     db_close(db);   // Always close the DB before exiting the program.
     return 0;
 }
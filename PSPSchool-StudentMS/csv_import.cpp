@@ -0,0 +1,252 @@
+#include "csv_import.hpp"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <future>
+#include <thread>
+#include "db.hpp"
+#include "mapped_file.hpp"
+#include "validation.hpp"
+
+/*
+-------------------------------------------------------------------------------
+ csv_import.cpp - Chunked parallel parser and batched writer for csv_import.hpp
+-------------------------------------------------------------------------------
+Chunks are cut at the first line break after every CHUNK_BYTES, so no record
+straddles two chunks. Workers claim chunks from a shared counter; each chunk
+gets its rows, the chunk-relative line of each row, and its errors. The
+caller's thread waits for chunk 0, writes it, waits for chunk 1, ... so
+parsing runs ahead of the database while lines and errors come out in file
+order. Absolute line numbers are known once every earlier chunk has been
+counted, i.e. when the chunk is written.
+-------------------------------------------------------------------------------
+*/
+
+namespace {
+
+// ~4 MB of CSV: about 60k student rows or 150k marks rows per transaction.
+constexpr std::size_t CHUNK_BYTES = std::size_t(4) << 20;
+
+template <class Row>
+struct Chunk {
+    const char* begin = nullptr;
+    const char* end = nullptr;
+    std::size_t lines = 0;              // line breaks + 1 if the last line is unterminated
+    std::vector<Row> rows;
+    std::vector<std::size_t> row_line;  // chunk-relative, 0-based
+    std::vector<ImportError> errors;    // chunk-relative lines, 0-based
+};
+
+using Enrollment = std::pair<RollId, CourseId>;
+
+// Split the record [p, end) into `f`, reusing the strings' storage. Returns
+// the field count, or -1 for a misplaced or unterminated quote.
+int split_record(const char* p, const char* end, std::vector<std::string>& f) {
+    auto blank = [](char c) { return c == ' ' || c == '\t'; };
+    int n = 0;
+    for (;;) {
+        if (static_cast<std::size_t>(n) == f.size()) f.emplace_back();
+        std::string& field = f[n++];
+        field.clear();
+        while (p < end && blank(*p)) ++p;
+        if (p < end && *p == '"') {
+            ++p;
+            for (;;) {
+                const char* q = static_cast<const char*>(std::memchr(p, '"', static_cast<std::size_t>(end - p)));
+                if (!q) return -1;
+                field.append(p, q);
+                p = q + 1;
+                if (p < end && *p == '"') { field.push_back('"'); ++p; continue; }
+                break;
+            }
+            while (p < end && blank(*p)) ++p;
+            if (p < end && *p != ',') return -1;
+        }
+        else {
+            const char* q = static_cast<const char*>(std::memchr(p, ',', static_cast<std::size_t>(end - p)));
+            const char* e = q ? q : end;
+            const char* t = e;
+            while (t > p && blank(t[-1])) --t;
+            if (std::memchr(p, '"', static_cast<std::size_t>(t - p))) return -1;
+            field.assign(p, t);
+            p = e;
+        }
+        if (p >= end) return n;
+        ++p;   // the comma
+    }
+}
+
+// One parse_row per kind: fill `out` from the fields or say what is wrong
+// (the field checks and messages are validation.hpp's).
+bool parse_row(const std::vector<std::string>& f, int n, Student& out, std::string& err) {
+    if (n != 4) { err = "expected 4 fields (roll_no,name,address,contact), got " + std::to_string(n); return false; }
+    return check_roll(f[0], out.roll_no, err) && check_student_fields(f[1], f[2], f[3], out, err);
+}
+
+bool parse_row(const std::vector<std::string>& f, int n, Course& out, std::string& err) {
+    if (n != 4) { err = "expected 4 fields (code,title,description,teacher), got " + std::to_string(n); return false; }
+    return check_course_code(f[0], out.code, err) && check_course_fields(f[1], f[2], f[3], out, err);
+}
+
+bool parse_row(const std::vector<std::string>& f, int n, Enrollment& out, std::string& err) {
+    if (n != 2) { err = "expected 2 fields (roll_no,course_code), got " + std::to_string(n); return false; }
+    return check_roll(f[0], out.first, err) && check_course_code(f[1], out.second, err);
+}
+
+bool parse_row(const std::vector<std::string>& f, int n, Grade& out, std::string& err) {
+    if (n != 4) { err = "expected 4 fields (roll_no,course_code,internal_mark,final_mark), got " + std::to_string(n); return false; }
+    return check_roll(f[0], out.roll_no, err) && check_course_code(f[1], out.course_code, err)
+        && check_mark(f[2], "internal_mark", out.internal_mark, err)
+        && check_mark(f[3], "final_mark", out.final_mark, err);
+}
+
+// Batch writer and rejection message per kind.
+bool write_rows(sqlite3* db, const std::vector<Student>& rows, BatchResult& r) { return db_add_students(db, rows, r); }
+bool write_rows(sqlite3* db, const std::vector<Course>& rows, BatchResult& r) { return db_add_courses(db, rows, r); }
+bool write_rows(sqlite3* db, const std::vector<Enrollment>& rows, BatchResult& r) { return db_enroll_many(db, rows, r); }
+bool write_rows(sqlite3* db, const std::vector<Grade>& rows, BatchResult& r) { return db_enter_marks_many(db, rows, r); }
+
+const char* rejected_message(const Student*) { return "roll_no already exists"; }
+const char* rejected_message(const Course*) { return "course code already exists"; }
+const char* rejected_message(const Enrollment*) { return "unknown student or course, or already enrolled"; }
+const char* rejected_message(const Grade*) { return "no such enrollment"; }
+
+// Column name that marks a header line.
+const char* header_name(ImportKind kind) { return kind == ImportKind::Courses ? "code" : "roll_no"; }
+
+template <class Row>
+void parse_chunk(Chunk<Row>& c, const char* header) {
+    std::vector<std::string> f;
+    std::string err;
+    std::size_t line = 0;
+    for (const char* p = c.begin; p < c.end; ++line) {
+        const char* nl = static_cast<const char*>(std::memchr(p, '\n', static_cast<std::size_t>(c.end - p)));
+        const char* e = nl ? nl : c.end;
+        const char* next = nl ? nl + 1 : c.end;
+        if (e > p && e[-1] == '\r') --e;
+        const char* q = p;
+        p = next;
+        if (q == e) continue;   // blank line
+
+        const int n = split_record(q, e, f);
+        if (header && line == 0 && n > 0 && f[0] == header) continue;
+        Row row{};
+        if (n < 0) err = "unbalanced quotes";
+        if (n >= 0 && parse_row(f, n, row, err)) {
+            c.rows.push_back(std::move(row));
+            c.row_line.push_back(line);
+        }
+        else {
+            c.errors.push_back(ImportError{ line, err });
+        }
+    }
+    c.lines = line;
+}
+
+template <class Row>
+bool import_rows(sqlite3* db, ImportKind kind, const MappedFile& file, unsigned threads, ImportReport& out) {
+    const char* data = reinterpret_cast<const char*>(file.data());
+    const char* end = data + file.size();
+    if (end - data >= 3 && std::memcmp(data, "\xEF\xBB\xBF", 3) == 0) data += 3;
+
+    // Cut at the first line break after each CHUNK_BYTES boundary.
+    std::vector<Chunk<Row>> chunks;
+    for (const char* p = data; p < end;) {
+        const char* cut = end;
+        if (static_cast<std::size_t>(end - p) > CHUNK_BYTES) {
+            const char* nl = static_cast<const char*>(std::memchr(p + CHUNK_BYTES, '\n', static_cast<std::size_t>(end - p - CHUNK_BYTES)));
+            cut = nl ? nl + 1 : end;
+        }
+        chunks.emplace_back();
+        chunks.back().begin = p;
+        chunks.back().end = cut;
+        p = cut;
+    }
+
+    if (threads == 0) threads = std::max(1u, std::thread::hardware_concurrency());
+    threads = static_cast<unsigned>(std::min<std::size_t>(threads, chunks.size()));
+    out.threads = threads;
+
+    std::vector<std::promise<void>> parsed(chunks.size());
+    std::vector<std::future<void>> ready;
+    for (auto& p : parsed) ready.push_back(p.get_future());
+    std::atomic<std::size_t> next{ 0 };
+    std::atomic<bool> stop{ false };
+    std::vector<std::thread> pool;
+    for (unsigned t = 0; t < threads; ++t) {
+        pool.emplace_back([&] {
+            for (std::size_t i; !stop.load() && (i = next.fetch_add(1)) < chunks.size();) {
+                parse_chunk(chunks[i], i == 0 ? header_name(kind) : nullptr);
+                parsed[i].set_value();
+            }
+            });
+    }
+
+    bool ok = true;
+    std::size_t first_line = 1;   // absolute line of the current chunk's first line
+    for (std::size_t i = 0; i < chunks.size() && ok; ++i) {
+        ready[i].wait();
+        Chunk<Row>& c = chunks[i];
+        BatchResult batch;
+        ok = c.rows.empty() || write_rows(db, c.rows, batch);
+        if (!ok) {
+            out.errors.push_back(ImportError{ first_line, std::string("transaction failed: ") + sqlite3_errmsg(db) });
+            break;
+        }
+
+        // Merge parse errors and database rejections back into line order.
+        std::vector<ImportError> errs;
+        errs.reserve(c.errors.size() + static_cast<std::size_t>(batch.failed));
+        std::size_t e = 0;
+        for (std::size_t r = 0; r < c.rows.size(); ++r) {
+            if (batch.row_ok[r]) continue;
+            while (e < c.errors.size() && c.errors[e].line < c.row_line[r]) errs.push_back(std::move(c.errors[e++]));
+            errs.push_back(ImportError{ c.row_line[r], rejected_message(static_cast<const Row*>(nullptr)) });
+        }
+        while (e < c.errors.size()) errs.push_back(std::move(c.errors[e++]));
+        for (ImportError& err : errs) {
+            err.line += first_line;
+            out.errors.push_back(std::move(err));
+        }
+
+        out.rows += c.rows.size() + c.errors.size();
+        out.imported += static_cast<std::size_t>(batch.succeeded);
+        first_line += c.lines;
+        std::vector<Row>().swap(c.rows);   // done with this chunk's memory
+        std::vector<std::size_t>().swap(c.row_line);
+    }
+
+    stop.store(true);
+    for (auto& th : pool) th.join();
+    out.rejected = out.errors.size();
+    return ok;
+}
+
+} // namespace
+
+bool parse_import_kind(const std::string& name, ImportKind& out) {
+    if (name == "students") out = ImportKind::Students;
+    else if (name == "courses") out = ImportKind::Courses;
+    else if (name == "enrollments") out = ImportKind::Enrollments;
+    else if (name == "marks") out = ImportKind::Marks;
+    else return false;
+    return true;
+}
+
+bool csv_import(sqlite3* db, ImportKind kind, const std::string& path, ImportReport& out, unsigned threads) {
+    out = ImportReport();
+    const auto t0 = std::chrono::steady_clock::now();
+    MappedFile file;
+    if (!file.open(path)) return false;
+
+    bool ok = false;
+    switch (kind) {
+    case ImportKind::Students: ok = import_rows<Student>(db, kind, file, threads, out); break;
+    case ImportKind::Courses: ok = import_rows<Course>(db, kind, file, threads, out); break;
+    case ImportKind::Enrollments: ok = import_rows<Enrollment>(db, kind, file, threads, out); break;
+    case ImportKind::Marks: ok = import_rows<Grade>(db, kind, file, threads, out); break;
+    }
+    out.ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+    return ok;
+}
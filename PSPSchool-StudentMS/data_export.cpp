@@ -0,0 +1,685 @@
+#include "data_export.hpp"
+#include <algorithm>
+#include <charconv>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "grade_kernel.hpp"
+
+/*
+-------------------------------------------------------------------------------
+ data_export.cpp - Formatter and double-buffered file writer for data_export.hpp
+-------------------------------------------------------------------------------
+Out owns two buffers. The caller's thread formats into one; when it is
+full, Out waits for the writer thread to finish the other, swaps them and
+carries on, so formatting and fwrite overlap. Each table is a loop over the
+store's vectors calling the put_* helpers; grades are processed in blocks so
+grade_kernel can compute weighted/passed for a block at a time.
+-------------------------------------------------------------------------------
+*/
+
+namespace {
+
+constexpr std::size_t BUFFER_BYTES = std::size_t(1) << 20;
+constexpr std::size_t GRADE_BLOCK = 4096;
+
+class Out {
+public:
+    explicit Out(std::FILE* f)
+        : file_(f), fill_(new char[BUFFER_BYTES]), spare_(new char[BUFFER_BYTES]),
+          writer_([this] { write_loop(); }) {}
+
+    ~Out() { finish(); }
+
+    // Hand the last buffer over, wait for every write; false on a write error.
+    bool finish() {
+        if (writer_.joinable()) {
+            hand_over();
+            {
+                std::lock_guard<std::mutex> lk(m_);
+                done_ = true;
+            }
+            cv_.notify_all();
+            writer_.join();
+        }
+        return ok_;
+    }
+
+    std::size_t bytes() const { return bytes_; }
+
+    // Room for `n` more bytes at the end of the fill buffer (n <= BUFFER_BYTES).
+    char* room(std::size_t n) {
+        if (fill_n_ + n > BUFFER_BYTES) hand_over();
+        char* p = fill_.get() + fill_n_;
+        fill_n_ += n;
+        return p;
+    }
+    // Give back what room() reserved but was not used.
+    void unuse(std::size_t n) { fill_n_ -= n; }
+
+    void put(char c) { *room(1) = c; }
+    void put(const char* s, std::size_t n) {
+        while (n) {
+            const std::size_t k = n < BUFFER_BYTES ? n : BUFFER_BYTES;
+            std::memcpy(room(k), s, k);
+            s += k;
+            n -= k;
+        }
+    }
+    void put(const char* s) { put(s, std::strlen(s)); }
+
+private:
+    // Swap the full buffer with the spare once the writer is done with it.
+    void hand_over() {
+        std::unique_lock<std::mutex> lk(m_);
+        cv_.wait(lk, [this] { return !busy_; });
+        bytes_ += fill_n_;
+        fill_.swap(spare_);
+        spare_n_ = fill_n_;
+        fill_n_ = 0;
+        busy_ = spare_n_ != 0;
+        lk.unlock();
+        cv_.notify_all();
+    }
+
+    void write_loop() {
+        std::unique_lock<std::mutex> lk(m_);
+        for (;;) {
+            cv_.wait(lk, [this] { return busy_ || done_; });
+            if (!busy_) return;
+            lk.unlock();
+            const bool wrote = std::fwrite(spare_.get(), 1, spare_n_, file_) == spare_n_;
+            lk.lock();
+            ok_ = ok_ && wrote;
+            busy_ = false;
+            cv_.notify_all();
+        }
+    }
+
+    std::FILE* file_;
+    std::unique_ptr<char[]> fill_;    // being formatted (caller's thread)
+    std::unique_ptr<char[]> spare_;   // being written while busy_ (writer thread)
+    std::size_t fill_n_ = 0;
+    std::size_t spare_n_ = 0;
+    std::size_t bytes_ = 0;
+    bool busy_ = false;
+    bool done_ = false;
+    bool ok_ = true;
+    std::mutex m_;
+    std::condition_variable cv_;
+    std::thread writer_;        // declared last: started after the rest is ready
+};
+
+// Marks are nearly always short decimals (78, 62.5). Those are printed from
+// an integer count of hundredths, about 10x faster than the general
+// std::to_chars paths, which handle everything else.
+
+// `cents` / 100 as digits; `trim` drops trailing fractional zeros.
+std::size_t format_cents(long long cents, char* p, bool trim) {
+    char* const start = p;
+    p = std::to_chars(p, p + 24, cents / 100).ptr;
+    const int frac = static_cast<int>(cents % 100);
+    if (!trim || frac) {
+        *p++ = '.';
+        *p++ = static_cast<char>('0' + frac / 10);
+        if (!trim || frac % 10) *p++ = static_cast<char>('0' + frac % 10);
+    }
+    return static_cast<std::size_t>(p - start);
+}
+
+// Shortest text that reads back as exactly `v` (std::to_chars output).
+// Below 10000 a value equal to its nearest hundredth is its own shortest
+// form, and fixed notation is never longer than scientific there.
+void put_double(Out& o, double v) {
+    char* p = o.room(32);
+    std::size_t n;
+    const long long cents = std::llround(v * 100);
+    if (v >= 0 && v < 10000 && !std::signbit(v) && static_cast<double>(cents) / 100 == v)
+        n = format_cents(cents, p, true);
+    else
+        n = static_cast<std::size_t>(std::to_chars(p, p + 32, v).ptr - p);
+    o.unuse(32 - n);
+}
+
+// `v` rounded to 2 decimals (std::to_chars fixed, 2). v * 100 is within half
+// an ulp of exact, so rounding it gives the same digits unless it landed
+// exactly on a tie; those go the slow way.
+void put_fixed2(Out& o, double v) {
+    char* p = o.room(32);
+    std::size_t n;
+    const double x = v * 100;
+    if (v >= 0 && x < 1e15 && x - std::floor(x) != 0.5)
+        n = format_cents(std::llround(x), p, false);
+    else
+        n = static_cast<std::size_t>(std::to_chars(p, p + 32, v, std::chars_format::fixed, 2).ptr - p);
+    o.unuse(32 - n);
+}
+
+void put_roll(Out& o, RollId id, bool quoted) {
+    char* p = o.room(ROLL_TEXT_MAX + 2);
+    std::size_t n = 0;
+    if (quoted) p[n++] = '"';
+    n += format_roll(id, p + n);
+    if (quoted) p[n++] = '"';
+    o.unuse(ROLL_TEXT_MAX + 2 - n);
+}
+
+void put_course(Out& o, CourseId id, bool quoted) {
+    char* p = o.room(COURSE_TEXT_MAX + 2);
+    std::size_t n = 0;
+    if (quoted) p[n++] = '"';
+    n += format_course(id, p + n);
+    if (quoted) p[n++] = '"';
+    o.unuse(COURSE_TEXT_MAX + 2 - n);
+}
+
+void put_csv_text(Out& o, const std::string& s) {
+    if (s.find_first_of(",\"\r\n") == std::string::npos) { o.put(s.data(), s.size()); return; }
+    o.put('"');
+    for (char c : s) {
+        if (c == '"') o.put('"');
+        o.put(c);
+    }
+    o.put('"');
+}
+
+void put_json_text(Out& o, const std::string& s) {
+    static const char HEX[] = "0123456789abcdef";
+    o.put('"');
+    std::size_t run = 0;   // bytes copied as they are, written in one go
+    for (std::size_t i = 0; i < s.size(); ++i) {
+        const unsigned char c = static_cast<unsigned char>(s[i]);
+        if (c >= 0x20 && c != '"' && c != '\\') continue;
+        o.put(s.data() + run, i - run);
+        run = i + 1;
+        if (c == '"' || c == '\\') { char e[2] = { '\\', static_cast<char>(c) }; o.put(e, 2); }
+        else if (c == '\n') o.put("\\n", 2);
+        else if (c == '\t') o.put("\\t", 2);
+        else if (c == '\r') o.put("\\r", 2);
+        else { char e[6] = { '\\', 'u', '0', '0', HEX[c >> 4], HEX[c & 15] }; o.put(e, 6); }
+    }
+    o.put(s.data() + run, s.size() - run);
+    o.put('"');
+}
+
+// Text field in the current format; `key` is the JSON member name.
+void put_field(Out& o, ExportFormat f, const char* key, const std::string& v, bool first = false) {
+    if (f == ExportFormat::Csv) {
+        if (!first) o.put(',');
+        put_csv_text(o, v);
+        return;
+    }
+    o.put(first ? "{\"" : ",\"");
+    o.put(key);
+    o.put("\":", 2);
+    put_json_text(o, v);
+}
+
+// Member name (and separator) before a non-text JSON value, or the CSV comma.
+void put_key(Out& o, ExportFormat f, const char* key, bool first = false) {
+    if (f == ExportFormat::Csv) {
+        if (!first) o.put(',');
+        return;
+    }
+    o.put(first ? "{\"" : ",\"");
+    o.put(key);
+    o.put("\":", 2);
+}
+
+void end_row(Out& o, ExportFormat f, bool last) {
+    if (f == ExportFormat::Csv) o.put('\n');
+    else o.put(last ? "}\n" : "},\n");
+}
+
+std::size_t write_students(Out& o, ExportFormat f, const DataStore& d) {
+    const bool json = f == ExportFormat::Json;
+    if (!json) o.put("roll_no,name,address,contact\n");
+    const std::size_t n = d.all_students.size();
+    for (std::size_t i = 0; i < n; ++i) {
+        const Student& s = d.all_students[i];
+        put_key(o, f, "roll_no", true);
+        put_roll(o, s.roll_no, json);
+        put_field(o, f, "name", s.name);
+        put_field(o, f, "address", s.address);
+        put_field(o, f, "contact", s.contact);
+        end_row(o, f, i + 1 == n);
+    }
+    return n;
+}
+
+std::size_t write_courses(Out& o, ExportFormat f, const DataStore& d) {
+    const bool json = f == ExportFormat::Json;
+    if (!json) o.put("code,title,description,teacher\n");
+    const std::size_t n = d.all_courses.size();
+    for (std::size_t i = 0; i < n; ++i) {
+        const Course& c = d.all_courses[i];
+        put_key(o, f, "code", true);
+        put_course(o, c.code, json);
+        put_field(o, f, "title", c.title);
+        put_field(o, f, "description", c.description);
+        put_field(o, f, "teacher", c.teacher);
+        end_row(o, f, i + 1 == n);
+    }
+    return n;
+}
+
+std::size_t write_enrollments(Out& o, ExportFormat f, const DataStore& d) {
+    const bool json = f == ExportFormat::Json;
+    if (!json) o.put("roll_no,course_code,internal_mark,final_mark,weighted,passed\n");
+    const GradeColumns& G = d.all_grades;
+    const std::size_t n = G.size();
+    std::vector<double> weighted(GRADE_BLOCK);
+    std::vector<std::uint8_t> passed(GRADE_BLOCK);
+    for (std::size_t base = 0; base < n; base += GRADE_BLOCK) {
+        const std::size_t m = n - base < GRADE_BLOCK ? n - base : GRADE_BLOCK;
+        grade_kernel(G.internal_mark.data() + base, G.final_mark.data() + base, m, PASS_MARK,
+            weighted.data(), passed.data());
+        for (std::size_t k = 0; k < m; ++k) {
+            const std::size_t i = base + k;
+            put_key(o, f, "roll_no", true);
+            put_roll(o, G.roll_no[i], json);
+            put_key(o, f, "course_code");
+            put_course(o, G.course_code[i], json);
+            put_key(o, f, "internal_mark");
+            put_double(o, G.internal_mark[i]);
+            put_key(o, f, "final_mark");
+            put_double(o, G.final_mark[i]);
+            put_key(o, f, "weighted");
+            put_fixed2(o, weighted[k]);
+            put_key(o, f, "passed");
+            if (json) o.put(passed[k] ? "true" : "false");
+            else o.put(passed[k] ? '1' : '0');
+            end_row(o, f, i + 1 == n);
+        }
+    }
+    return n;
+}
+
+using TableWriter = std::size_t (*)(Out&, ExportFormat, const DataStore&);
+
+std::size_t write_json_array(Out& o, const DataStore& d, TableWriter table) {
+    o.put("[\n");
+    const std::size_t n = table(o, ExportFormat::Json, d);
+    o.put("]");
+    return n;
+}
+
+/* ===== Arrow IPC file ===== */
+
+// Minimal FlatBuffers builder for the Arrow metadata (Schema, Message,
+// Footer). Like the reference builder it writes back to front: objects are
+// prepended, and an object's "offset" is its distance from the end, so a
+// reference from a field created later always points forward. Child
+// objects (strings, vectors, tables) must be finished before the table that
+// refers to them is started. The metadata is a few hundred bytes, so
+// prepending into a vector is fine. Assumes a little-endian host, as the
+// rest of the export does.
+class FlatBuilder {
+public:
+    std::uint32_t size() const { return static_cast<std::uint32_t>(buf_.size()); }
+
+    // Pad so that after `extra` more bytes the size is a multiple of `align`.
+    void prep(std::size_t align, std::size_t extra) {
+        if (align > max_align_) max_align_ = align;
+        const std::size_t pad = (~(buf_.size() + extra) + 1) & (align - 1);
+        buf_.insert(buf_.begin(), pad, 0);
+    }
+
+    template <class T>
+    void push(T v) {
+        unsigned char b[sizeof(T)];
+        std::memcpy(b, &v, sizeof(T));
+        buf_.insert(buf_.begin(), b, b + sizeof(T));
+    }
+
+    std::uint32_t string(const char* s) {
+        const std::size_t n = std::strlen(s);
+        prep(4, n + 1);
+        push<std::uint8_t>(0);
+        buf_.insert(buf_.begin(), s, s + n);
+        push(static_cast<std::uint32_t>(n));
+        return size();
+    }
+
+    // Vector of structs of `elem` bytes each, aligned to 8.
+    std::uint32_t struct_vector(const void* data, std::size_t count, std::size_t elem) {
+        prep(4, count * elem);
+        prep(8, count * elem);
+        const unsigned char* p = static_cast<const unsigned char*>(data);
+        buf_.insert(buf_.begin(), p, p + count * elem);
+        push(static_cast<std::uint32_t>(count));
+        return size();
+    }
+
+    std::uint32_t offset_vector(const std::vector<std::uint32_t>& offs) {
+        prep(4, 4 * offs.size());
+        for (std::size_t i = offs.size(); i-- > 0;) push(size() + 4 - offs[i]);
+        push(static_cast<std::uint32_t>(offs.size()));
+        return size();
+    }
+
+    void start_table() {
+        fields_.clear();
+        table_start_ = size();
+    }
+    template <class T>
+    void add(int id, T v) {
+        prep(sizeof(T), 0);
+        push(v);
+        fields_.emplace_back(id, size());
+    }
+    void add_offset(int id, std::uint32_t off) {
+        prep(4, 0);
+        push(size() + 4 - off);
+        fields_.emplace_back(id, size());
+    }
+    std::uint32_t end_table() {
+        prep(4, 0);
+        push<std::int32_t>(0);   // soffset to the vtable, patched below
+        const std::uint32_t obj = size();
+        int slots = 0;
+        for (const auto& f : fields_) slots = std::max(slots, f.first + 1);
+        std::vector<std::uint16_t> vt(static_cast<std::size_t>(slots), 0);
+        for (const auto& f : fields_) vt[static_cast<std::size_t>(f.first)] = static_cast<std::uint16_t>(obj - f.second);
+        for (std::size_t i = vt.size(); i-- > 0;) push(vt[i]);
+        push(static_cast<std::uint16_t>(obj - table_start_));
+        push(static_cast<std::uint16_t>(2 * (slots + 2)));
+        const std::int32_t to_vtable = static_cast<std::int32_t>(size() - obj);
+        std::memcpy(&buf_[size() - obj], &to_vtable, 4);
+        return obj;
+    }
+
+    // Root offset in front; the buffer is then complete.
+    const std::vector<unsigned char>& finish(std::uint32_t root) {
+        prep(max_align_, 4);
+        push(size() + 4 - root);
+        return buf_;
+    }
+
+private:
+    std::vector<unsigned char> buf_;
+    std::vector<std::pair<int, std::uint32_t>> fields_;   // (field id, offset)
+    std::uint32_t table_start_ = 0;
+    std::size_t max_align_ = 4;
+};
+
+// Arrow format constants (Schema.fbs / Message.fbs / File.fbs).
+constexpr std::int16_t ARROW_METADATA_V5 = 4;
+constexpr std::uint8_t ARROW_TYPE_INT = 2, ARROW_TYPE_FLOAT = 3, ARROW_TYPE_UTF8 = 5;
+constexpr std::uint8_t ARROW_HEADER_SCHEMA = 1, ARROW_HEADER_DICTIONARY = 2, ARROW_HEADER_RECORDS = 3;
+constexpr std::int16_t ARROW_PRECISION_DOUBLE = 2;
+
+struct ArrowFieldNode { std::int64_t length, null_count; };
+struct ArrowBuffer { std::int64_t offset, length; };
+struct ArrowBlock { std::int64_t offset; std::int32_t meta_length; std::int32_t pad; std::int64_t body_length; };
+
+std::int64_t pad8(std::int64_t n) { return (n + 7) & ~std::int64_t(7); }
+
+// Schema table: roll_no and course_code as dictionary<int32, utf8> (ids 0
+// and 1), then the three float64 columns. Nothing is nullable.
+std::uint32_t arrow_schema(FlatBuilder& b) {
+    static const char* const NAMES[] = { "roll_no", "course_code", "internal_mark", "final_mark", "weighted" };
+    std::vector<std::uint32_t> fields;
+    for (int c = 0; c < 5; ++c) {
+        const bool dict = c < 2;
+        const std::uint32_t name = b.string(NAMES[c]);
+        const std::uint32_t children = b.offset_vector({});
+        b.start_table();
+        if (!dict) b.add<std::int16_t>(0, ARROW_PRECISION_DOUBLE);
+        const std::uint32_t type = b.end_table();   // Utf8 {} or FloatingPoint
+        std::uint32_t encoding = 0;
+        if (dict) {
+            b.start_table();   // Int
+            b.add<std::int32_t>(0, 32);
+            b.add<std::uint8_t>(1, 1);
+            const std::uint32_t index_type = b.end_table();
+            b.start_table();   // DictionaryEncoding
+            b.add<std::int64_t>(0, c);
+            b.add_offset(1, index_type);
+            encoding = b.end_table();
+        }
+        b.start_table();   // Field
+        b.add_offset(0, name);
+        b.add<std::uint8_t>(1, 0);
+        b.add<std::uint8_t>(2, dict ? ARROW_TYPE_UTF8 : ARROW_TYPE_FLOAT);
+        b.add_offset(3, type);
+        if (dict) b.add_offset(4, encoding);
+        b.add_offset(5, children);
+        fields.push_back(b.end_table());
+    }
+    const std::uint32_t vec = b.offset_vector(fields);
+    b.start_table();
+    b.add<std::int16_t>(0, 0);   // little-endian
+    b.add_offset(1, vec);
+    return b.end_table();
+}
+
+std::uint32_t arrow_record_batch(FlatBuilder& b, std::int64_t length,
+    const std::vector<ArrowFieldNode>& nodes, const std::vector<ArrowBuffer>& buffers) {
+    const std::uint32_t n = b.struct_vector(nodes.data(), nodes.size(), sizeof(ArrowFieldNode));
+    const std::uint32_t bufs = b.struct_vector(buffers.data(), buffers.size(), sizeof(ArrowBuffer));
+    b.start_table();
+    b.add<std::int64_t>(0, length);
+    b.add_offset(1, n);
+    b.add_offset(2, bufs);
+    return b.end_table();
+}
+
+std::uint32_t arrow_message(FlatBuilder& b, std::uint8_t header_type, std::uint32_t header, std::int64_t body) {
+    b.start_table();
+    b.add<std::int16_t>(0, ARROW_METADATA_V5);
+    b.add<std::uint8_t>(1, header_type);
+    b.add_offset(2, header);
+    b.add<std::int64_t>(3, body);
+    return b.end_table();
+}
+
+// Encapsulated message: continuation marker, metadata length, metadata
+// padded to 8. Returns the bytes written (Block.metaDataLength).
+std::int32_t put_message(Out& o, const std::vector<unsigned char>& meta) {
+    const std::int64_t padded = pad8(static_cast<std::int64_t>(meta.size()));
+    const std::uint32_t head[2] = { 0xFFFFFFFFu, static_cast<std::uint32_t>(padded) };
+    o.put(reinterpret_cast<const char*>(head), 8);
+    o.put(reinterpret_cast<const char*>(meta.data()), meta.size());
+    static const char zeros[8] = {};
+    o.put(zeros, static_cast<std::size_t>(padded) - meta.size());
+    return static_cast<std::int32_t>(8 + padded);
+}
+
+void put_padding(Out& o, std::int64_t written) {
+    static const char zeros[8] = {};
+    o.put(zeros, static_cast<std::size_t>(pad8(written) - written));
+}
+
+// One key column's dictionary: utf8 offsets + bytes, in slot order, so a
+// grade's dictionary index is its student's / course's slot in the store.
+struct ArrowDictionary {
+    std::vector<std::int32_t> offsets{ 0 };
+    std::string text;
+};
+
+// Grades as an Arrow IPC file (the "Feather v2" layout): schema, two
+// dictionary batches, one record batch holding every grade, footer. All
+// offsets and lengths are known up front, so the file is written front to
+// back in one pass with no seeks.
+std::size_t write_arrow(Out& o, const DataStore& d, bool& ok) {
+    const GradeColumns& G = d.all_grades;
+    const std::int64_t n = static_cast<std::int64_t>(G.size());
+
+    ArrowDictionary dicts[2];
+    for (const Student& s : d.all_students) {
+        char buf[ROLL_TEXT_MAX];
+        dicts[0].text.append(buf, format_roll(s.roll_no, buf));
+        dicts[0].offsets.push_back(static_cast<std::int32_t>(dicts[0].text.size()));
+    }
+    for (const Course& c : d.all_courses) {
+        char buf[COURSE_TEXT_MAX];
+        dicts[1].text.append(buf, format_course(c.code, buf));
+        dicts[1].offsets.push_back(static_cast<std::int32_t>(dicts[1].text.size()));
+    }
+
+    std::int64_t at = 0;
+    std::vector<ArrowBlock> dict_blocks, batch_blocks;
+    auto put = [&](const void* p, std::size_t len) { o.put(static_cast<const char*>(p), len); at += static_cast<std::int64_t>(len); };
+    auto pad = [&](std::int64_t len) { put_padding(o, len); at += pad8(len) - len; };
+
+    put("ARROW1\0\0", 8);
+    {
+        FlatBuilder b;
+        const std::uint32_t schema = arrow_schema(b);
+        at += put_message(o, b.finish(arrow_message(b, ARROW_HEADER_SCHEMA, schema, 0)));
+    }
+
+    for (std::int64_t id = 0; id < 2; ++id) {
+        const ArrowDictionary& dict = dicts[id];
+        const std::int64_t count = static_cast<std::int64_t>(dict.offsets.size()) - 1;
+        const std::int64_t off_bytes = 4 * (count + 1);
+        const std::int64_t text_bytes = static_cast<std::int64_t>(dict.text.size());
+        const std::int64_t body = pad8(off_bytes) + pad8(text_bytes);
+        FlatBuilder b;
+        const std::uint32_t rb = arrow_record_batch(b, count, { { count, 0 } },
+            { { 0, 0 }, { 0, off_bytes }, { pad8(off_bytes), text_bytes } });
+        b.start_table();   // DictionaryBatch
+        b.add<std::int64_t>(0, id);
+        b.add_offset(1, rb);
+        const std::uint32_t header = b.end_table();
+        const std::int64_t start = at;
+        const std::int32_t meta = put_message(o, b.finish(arrow_message(b, ARROW_HEADER_DICTIONARY, header, body)));
+        at += meta;
+        put(dict.offsets.data(), static_cast<std::size_t>(off_bytes));
+        pad(off_bytes);
+        put(dict.text.data(), dict.text.size());
+        pad(text_bytes);
+        dict_blocks.push_back(ArrowBlock{ start, meta, 0, body });
+    }
+
+    // Record batch: two int32 index columns, three float64 columns.
+    const std::int64_t idx_bytes = 4 * n, f64_bytes = 8 * n;
+    std::vector<ArrowBuffer> buffers;
+    std::int64_t off = 0;
+    for (int c = 0; c < 5; ++c) {
+        const std::int64_t len = c < 2 ? idx_bytes : f64_bytes;
+        buffers.push_back({ off, 0 });     // validity: absent, no nulls
+        buffers.push_back({ off, len });
+        off += pad8(len);
+    }
+    {
+        FlatBuilder b;
+        const std::uint32_t rb = arrow_record_batch(b, n, std::vector<ArrowFieldNode>(5, { n, 0 }), buffers);
+        const std::int64_t start = at;
+        const std::int32_t meta = put_message(o, b.finish(arrow_message(b, ARROW_HEADER_RECORDS, rb, off)));
+        at += meta;
+        batch_blocks.push_back(ArrowBlock{ start, meta, 0, off });
+    }
+
+    std::vector<std::int32_t> idx(GRADE_BLOCK);
+    for (int c = 0; c < 2; ++c) {
+        for (std::int64_t base = 0; base < n; base += GRADE_BLOCK) {
+            const std::size_t m = static_cast<std::size_t>(std::min<std::int64_t>(n - base, GRADE_BLOCK));
+            for (std::size_t k = 0; k < m; ++k) {
+                const std::size_t i = static_cast<std::size_t>(base) + k;
+                const std::uint32_t* slot = c == 0 ? d.student_slot.find(G.roll_no[i]) : d.course_slot.find(G.course_code[i]);
+                ok = ok && slot;   // a grade whose student/course is not in the store
+                idx[k] = slot ? static_cast<std::int32_t>(*slot) : 0;
+            }
+            put(idx.data(), 4 * m);
+        }
+        pad(idx_bytes);
+    }
+    put(G.internal_mark.data(), static_cast<std::size_t>(f64_bytes));
+    pad(f64_bytes);
+    put(G.final_mark.data(), static_cast<std::size_t>(f64_bytes));
+    pad(f64_bytes);
+    std::vector<double> weighted(GRADE_BLOCK);
+    for (std::int64_t base = 0; base < n; base += GRADE_BLOCK) {
+        const std::size_t m = static_cast<std::size_t>(std::min<std::int64_t>(n - base, GRADE_BLOCK));
+        grade_kernel(G.internal_mark.data() + base, G.final_mark.data() + base, m, PASS_MARK, weighted.data());
+        put(weighted.data(), 8 * m);
+    }
+    pad(f64_bytes);
+
+    static const std::uint32_t EOS[2] = { 0xFFFFFFFFu, 0 };
+    put(EOS, 8);
+
+    FlatBuilder b;
+    const std::uint32_t schema = arrow_schema(b);
+    const std::uint32_t dv = b.struct_vector(dict_blocks.data(), dict_blocks.size(), sizeof(ArrowBlock));
+    const std::uint32_t bv = b.struct_vector(batch_blocks.data(), batch_blocks.size(), sizeof(ArrowBlock));
+    b.start_table();   // Footer
+    b.add<std::int16_t>(0, ARROW_METADATA_V5);
+    b.add_offset(1, schema);
+    b.add_offset(2, dv);
+    b.add_offset(3, bv);
+    const std::vector<unsigned char>& footer = b.finish(b.end_table());
+    put(footer.data(), footer.size());
+    const std::int32_t footer_len = static_cast<std::int32_t>(footer.size());
+    put(&footer_len, 4);
+    put("ARROW1", 6);
+    return static_cast<std::size_t>(n);
+}
+
+} // namespace
+
+bool parse_export_kind(const std::string& name, ExportKind& out) {
+    if (name == "students") out = ExportKind::Students;
+    else if (name == "courses") out = ExportKind::Courses;
+    else if (name == "enrollments") out = ExportKind::Enrollments;
+    else if (name == "all") out = ExportKind::All;
+    else return false;
+    return true;
+}
+
+bool parse_export_format(const std::string& name, ExportFormat& out) {
+    if (name == "csv") out = ExportFormat::Csv;
+    else if (name == "json") out = ExportFormat::Json;
+    else if (name == "arrow") out = ExportFormat::Arrow;
+    else return false;
+    return true;
+}
+
+bool export_store(const DataStore& data, ExportKind kind, ExportFormat format,
+    const std::string& path, ExportReport& out) {
+    out = ExportReport();
+    if (kind == ExportKind::All && format == ExportFormat::Csv) return false;
+    if (format == ExportFormat::Arrow && kind != ExportKind::Enrollments) return false;
+    const auto t0 = std::chrono::steady_clock::now();
+    std::FILE* file = std::fopen(path.c_str(), "wb");
+    if (!file) return false;
+    std::setvbuf(file, nullptr, _IONBF, 0);   // Out already writes 1 MB blocks
+
+    bool ok = true;
+    {
+        Out o(file);
+        static const TableWriter TABLES[] = { write_students, write_courses, write_enrollments };
+        if (kind == ExportKind::All) {
+            static const char* const NAMES[] = { "{\"students\":", ",\n\"courses\":", ",\n\"enrollments\":" };
+            for (int t = 0; t < 3; ++t) {
+                o.put(NAMES[t]);
+                out.rows += write_json_array(o, data, TABLES[t]);
+            }
+            o.put("}\n");
+        }
+        else if (format == ExportFormat::Arrow) {
+            out.rows = write_arrow(o, data, ok);
+        }
+        else if (format == ExportFormat::Json) {
+            out.rows = write_json_array(o, data, TABLES[static_cast<int>(kind)]);
+            o.put('\n');
+        }
+        else {
+            out.rows = TABLES[static_cast<int>(kind)](o, format, data);
+        }
+        ok = o.finish() && ok;
+        out.bytes = o.bytes();
+    }
+    ok = std::fclose(file) == 0 && ok;
+    out.ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+    return ok;
+}
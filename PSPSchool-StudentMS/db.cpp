@@ -10,23 +10,57 @@ Design notes
   - Each function returns a bool for success/failure. Callers can print messages
     and keep the in-memory DataStore in sync only when DB writes succeed.
   - Foreign key cascades are enabled per-connection (PRAGMA foreign_keys=ON).
+    Journal mode, synchronous, cache, mmap and temp_store come from the
+    DbProfile passed to db_open (durable / balanced / bulk-load presets).
   - Write ops use prepared statements with bound parameters to avoid SQL injection
     and handle quoting safely.
+  - The per-row statements are prepared once per connection and kept in a small
+    cache attached to the sqlite3* handle (see StmtCache). Each call resets and
+    rebinds the cached statement instead of re-parsing the SQL; db_close
+    finalizes them.
   - Reads that stream many rows use sqlite3_prepare_v2 / sqlite3_step loops.
+    db_load_all sizes the store from row counts first and, on big file
+    databases, reads rowid ranges on parallel read-only connections.
+  - db_sync_attach ties one DataStore to the connection. Update/commit/
+    rollback hooks record which rows changed; after each committed write the
+    changed rows are re-read and applied to the store (see "Cache sync").
+  - Triggers append every row change to sms_changes. That log lets a startup
+    snapshot (snapshot.hpp) catch up with the few rows changed since it was
+    written instead of reloading everything.
 
 Caveats / TODOs for contributors
   - NULL handling: sqlite3_column_text may return nullptr. This code assumes the
     columns are NOT NULL (or the seed data has values). If schema changes or
     NULLs are possible, guard conversions (e.g., fallback to empty string).
-  - Transactions: Seed and multi-step operations currently run autocommit. If
-    you add larger multi-statement updates, consider wrapping in BEGIN/COMMIT.
+  - Transactions: single-row functions run autocommit (one journal sync per
+    call). Bulk loads should go through the db_*_many batch functions, which
+    share one BEGIN/COMMIT. Seeding still runs autocommit.
   - Error surfacing: exec_sql prints error text. Prepared statement paths return
     only false/true; extend to bubble up sqlite3_errmsg(db) when debugging.
 -------------------------------------------------------------------------------
 */
 
 #include "db.hpp"
+#include "snapshot.hpp"
+#include "mpsc_queue.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <chrono>
+#include <condition_variable>
+#include <cstdlib>
+#include <cstring>
 #include <iostream>
+#include <iterator>
+#include <mutex>
+#include <optional>
+#include <thread>
+
+// Defined in "Cache sync" below; every finished statement gives it a chance
+// to apply committed row changes to the attached DataStore.
+static void sync_flush(sqlite3* db);
+static void writer_drain(sqlite3* db);
+static int writer_failures(sqlite3* db);
 
 // Small helper to run a raw SQL string with sqlite3_exec and report errors.
 static bool exec_sql(sqlite3* db, const char* sql) {
@@ -34,74 +68,696 @@ static bool exec_sql(sqlite3* db, const char* sql) {
     int rc = sqlite3_exec(db, sql, nullptr, nullptr, &err);
     if (rc != SQLITE_OK) {
         if (err) { std::cerr << "SQL error: " << err << "\n"; sqlite3_free(err); }
+        sync_flush(db);
         return false;
     }
+    sync_flush(db);
     return true;
 }
 
-// Open (or create) the SQLite database file at `path` and enable FK constraints
-// for this connection. Returns false if the DB cannot be opened.
-bool db_open(sqlite3*& db, const std::string& path) {
+/* =========================
+   Statement cache
+   ========================= */
+
+// Grade::weighted() spelled in SQL: the definition of the generated column
+// grades.weighted, and what index-only queries over the marks compute.
+#define SQL_WEIGHTED "(0.3*internal_mark + 0.7*final_mark)"
+
+// The key formats keys.hpp can pack (parse_roll / parse_course), spelled as
+// GLOBs over the column `x`: "S" + 3..6 digits, 2..4 letters + 3 digits.
+#define SQL_ROLL_OK(x) "(" x " GLOB 'S[0-9][0-9][0-9]' OR " x " GLOB 'S[0-9][0-9][0-9][0-9]'" \
+    " OR " x " GLOB 'S[0-9][0-9][0-9][0-9][0-9]' OR " x " GLOB 'S[0-9][0-9][0-9][0-9][0-9][0-9]')"
+#define SQL_COURSE_OK(x) "(" x " GLOB '[A-Z][A-Z][0-9][0-9][0-9]' OR " x " GLOB '[A-Z][A-Z][A-Z][0-9][0-9][0-9]'" \
+    " OR " x " GLOB '[A-Z][A-Z][A-Z][A-Z][0-9][0-9][0-9]')"
+
+// One slot per hot SQL string. Keep STMT_SQL in the same order as StmtId.
+enum StmtId {
+    ST_ADD_STUDENT,
+    ST_ADD_COURSE,
+    ST_ENROLL,
+    ST_ENTER_MARKS,
+    ST_UPDATE_STUDENT,
+    ST_UPDATE_COURSE,
+    ST_DELETE_STUDENT,
+    ST_DELETE_COURSE,
+    ST_DELETE_ENROLLMENT,
+    ST_GET_COUNTS,
+    ST_BEGIN,
+    ST_COMMIT,
+    ST_ROLLBACK,
+    ST_SYNC_STUDENT,
+    ST_SYNC_COURSE,
+    ST_SYNC_GRADE,
+    ST_STAMP,
+    ST_LOG_HEAD,
+    ST_LOG_SINCE,
+    ST_LOG_PRUNE,
+    ST_REPORT_STUDENT,
+    ST_REPORT_STUDENT_ROWS,
+    ST_REPORT_COURSE,
+    ST_REPORT_COURSE_AGG,
+    ST_GRADES_BELOW,
+    ST_COURSE_TOP,
+    ST_SEARCH_STUDENTS,
+    ST_SEARCH_COURSES,
+    ST_FIRST_GRADES,
+    ST_COUNT_
+};
+
+static const char* const STMT_SQL[ST_COUNT_] = {
+    "INSERT INTO students(roll_no,name,address,contact) VALUES(?,?,?,?);",
+    "INSERT INTO courses(code,title,description,teacher) VALUES(?,?,?,?);",
+    "INSERT INTO grades(roll_no,course_code,internal_mark,final_mark) VALUES(?,?,0,0);",
+    "UPDATE grades SET internal_mark=?, final_mark=? WHERE roll_no=? AND course_code=?;",
+    "UPDATE students SET name=?, address=?, contact=? WHERE roll_no=?;",
+    "UPDATE courses SET title=?, description=?, teacher=? WHERE code=?;",
+    "DELETE FROM students WHERE roll_no=?;",
+    "DELETE FROM courses WHERE code=?;",
+    "DELETE FROM grades WHERE roll_no=? AND course_code=?;",
+    "SELECT students, courses, grades FROM sms_counts WHERE id=0;",
+    "BEGIN IMMEDIATE;",
+    "COMMIT;",
+    "ROLLBACK;",
+    "SELECT roll_no,name,address,contact FROM students WHERE rowid=?;",
+    "SELECT code,title,description,teacher FROM courses WHERE rowid=?;",
+    "SELECT roll_no,course_code,internal_mark,final_mark FROM grades WHERE rowid=?;",
+    "SELECT (SELECT value FROM sms_meta WHERE key='db_id'), (SELECT user_version FROM pragma_user_version);",
+    "SELECT coalesce((SELECT seq FROM sqlite_sequence WHERE name='sms_changes'), 0);",
+    "SELECT seq,tbl,row FROM sms_changes WHERE seq>? ORDER BY seq;",
+    "DELETE FROM sms_changes WHERE seq<=?;",
+    // Reports (SQL pushdown). Grade rows come from the covering indexes in
+    // INDEX_DDL, so no grades row is read; ?2 is the pass mark.
+    "SELECT name FROM students WHERE roll_no=?;",
+    "SELECT g.course_code, c.title, g.internal_mark, g.final_mark"
+    " FROM grades g LEFT JOIN courses c ON c.code = g.course_code"
+    " WHERE g.roll_no=? ORDER BY g.course_code;",
+    "SELECT title, teacher FROM courses WHERE code=?;",
+    "SELECT count(*), total(weighted), total(weighted >= ?2), min(weighted), max(weighted)"
+    " FROM grades WHERE course_code=?1;",
+    // Ranking: index-ordered reads of grades_course_rank.
+    "SELECT roll_no, course_code, internal_mark, final_mark FROM grades"
+    " WHERE course_code=?1 AND weighted < ?2 ORDER BY weighted;",
+    "SELECT roll_no, course_code, internal_mark, final_mark FROM grades"
+    " WHERE course_code=?1 ORDER BY weighted DESC, roll_no LIMIT ?2;",
+    // Search: FTS5 MATCH, best bm25 first. Column weights favour the name /
+    // title over the longer free-text fields.
+    "SELECT s.roll_no, s.name, s.address, s.contact FROM students_fts f"
+    " JOIN students s ON s.rowid = f.rowid"
+    " WHERE students_fts MATCH ?1 ORDER BY bm25(students_fts, 4.0, 1.0) LIMIT ?2;",
+    "SELECT c.code, c.title, c.description, c.teacher FROM courses_fts f"
+    " JOIN courses c ON c.rowid = f.rowid"
+    " WHERE courses_fts MATCH ?1 ORDER BY bm25(courses_fts, 4.0, 1.0, 2.0) LIMIT ?2;",
+    // Benchmarks: rows to rewrite.
+    "SELECT roll_no,course_code,internal_mark,final_mark FROM grades LIMIT ?1;",
+};
+
+// Prepared statements owned by one connection. Created in db_open and stored
+// on the handle with sqlite3_set_clientdata, so any function that receives the
+// sqlite3* can reach it. Statements are prepared lazily on first use.
+// `enabled` is only cleared by db_set_stmt_cache (benchmarks).
+struct StmtCache {
+    sqlite3_stmt* st[ST_COUNT_] = {};
+    bool enabled = true;
+};
+
+static const char* STMT_CACHE_KEY = "pspschool.stmt_cache";
+
+static StmtCache* stmt_cache(sqlite3* db) {
+    return static_cast<StmtCache*>(sqlite3_get_clientdata(db, STMT_CACHE_KEY));
+}
+
+// Borrow the cached statement `id` for a single call. The destructor resets the
+// statement (releasing any lock it holds) and clears bindings, so text bound
+// with SQLITE_STATIC never outlives the caller's strings. It then runs
+// sync_flush, so a write that just committed is mirrored before we return.
+class StmtLease {
+public:
+    StmtLease(sqlite3* db, StmtId id) : db_(db) {
+        StmtCache* cache = db ? stmt_cache(db) : nullptr;
+        if (!cache) return;
+        if (!cache->enabled) {
+            // Uncached: prepare for this call only, finalize in the destructor.
+            if (sqlite3_prepare_v2(db, STMT_SQL[id], -1, &st_, nullptr) != SQLITE_OK) {
+                std::cerr << "SQL prepare error: " << sqlite3_errmsg(db) << "\n";
+                sqlite3_finalize(st_);
+                st_ = nullptr;
+            }
+            owned_ = st_ != nullptr;
+            return;
+        }
+        if (!cache->st[id] &&
+            sqlite3_prepare_v3(db, STMT_SQL[id], -1, SQLITE_PREPARE_PERSISTENT,
+                &cache->st[id], nullptr) != SQLITE_OK) {
+            std::cerr << "SQL prepare error: " << sqlite3_errmsg(db) << "\n";
+            cache->st[id] = nullptr;
+            return;
+        }
+        st_ = cache->st[id];
+    }
+    ~StmtLease() {
+        if (owned_) sqlite3_finalize(st_);
+        else if (st_) { sqlite3_reset(st_); sqlite3_clear_bindings(st_); }
+        if (db_) sync_flush(db_);
+    }
+    StmtLease(const StmtLease&) = delete;
+    StmtLease& operator=(const StmtLease&) = delete;
+
+    explicit operator bool() const { return st_ != nullptr; }
+    sqlite3_stmt* get() const { return st_; }
+
+private:
+    sqlite3* db_ = nullptr;
+    sqlite3_stmt* st_ = nullptr;
+    bool owned_ = false;       // prepared for this lease only (cache disabled)
+};
+
+// Bind a std::string without copying. Safe because the lease clears bindings
+// before the caller's string goes out of scope.
+static void bind_str(sqlite3_stmt* st, int idx, const std::string& s) {
+    sqlite3_bind_text(st, idx, s.data(), static_cast<int>(s.size()), SQLITE_STATIC);
+}
+
+// Keys are stored as text in the DB; format them into a stack buffer and let
+// SQLite copy the few bytes.
+static void bind_roll(sqlite3_stmt* st, int idx, RollId id) {
+    char buf[ROLL_TEXT_MAX];
+    int n = static_cast<int>(format_roll(id, buf));
+    sqlite3_bind_text(st, idx, buf, n, SQLITE_TRANSIENT);
+}
+
+static void bind_course(sqlite3_stmt* st, int idx, CourseId id) {
+    char buf[COURSE_TEXT_MAX];
+    int n = static_cast<int>(format_course(id, buf));
+    sqlite3_bind_text(st, idx, buf, n, SQLITE_TRANSIENT);
+}
+
+/* =========================
+   Connection profiles
+   ========================= */
+
+DbProfile db_profile_durable() {
+    DbProfile p;
+    p.name = "durable";
+    p.journal_mode = "DELETE";
+    p.synchronous = "FULL";
+    p.busy_timeout_ms = 2000;
+    return p;
+}
+
+DbProfile db_profile_balanced() {
+    DbProfile p;
+    p.name = "balanced";
+    p.journal_mode = "WAL";
+    p.synchronous = "NORMAL";
+    p.cache_size_kib = 64 * 1024;        // 64 MiB page cache
+    p.mmap_size = 256LL * 1024 * 1024;   // map up to 256 MiB of the file
+    p.temp_store = "MEMORY";
+    p.busy_timeout_ms = 5000;
+    return p;
+}
+
+DbProfile db_profile_bulk_load() {
+    DbProfile p;
+    p.name = "bulk-load";
+    p.journal_mode = "MEMORY";
+    p.synchronous = "OFF";
+    p.cache_size_kib = 256 * 1024;
+    p.mmap_size = 1024LL * 1024 * 1024;
+    p.temp_store = "MEMORY";
+    p.busy_timeout_ms = 5000;
+    return p;
+}
+
+// Run a single-value PRAGMA query and return its first column as text.
+static std::string pragma_text(sqlite3* db, const char* pragma) {
+    std::string out;
+    sqlite3_stmt* st = nullptr;
+    std::string q = std::string("PRAGMA ") + pragma + ";";
+    if (sqlite3_prepare_v2(db, q.c_str(), -1, &st, nullptr) == SQLITE_OK &&
+        sqlite3_step(st) == SQLITE_ROW) {
+        const unsigned char* t = sqlite3_column_text(st, 0);
+        if (t) out = reinterpret_cast<const char*>(t);
+    }
+    sqlite3_finalize(st);
+    return out;
+}
+
+// Apply every field of `p` that is set. PRAGMA values cannot be bound as
+// parameters; the presets only use fixed keywords and integers.
+static void apply_profile(sqlite3* db, const DbProfile& p) {
+    if (!p.journal_mode.empty())
+        exec_sql(db, ("PRAGMA journal_mode = " + p.journal_mode + ";").c_str());
+    if (!p.synchronous.empty())
+        exec_sql(db, ("PRAGMA synchronous = " + p.synchronous + ";").c_str());
+    if (p.cache_size_kib >= 0)
+        exec_sql(db, ("PRAGMA cache_size = -" + std::to_string(p.cache_size_kib) + ";").c_str());
+    if (p.mmap_size >= 0)
+        exec_sql(db, ("PRAGMA mmap_size = " + std::to_string(p.mmap_size) + ";").c_str());
+    if (!p.temp_store.empty())
+        exec_sql(db, ("PRAGMA temp_store = " + p.temp_store + ";").c_str());
+    if (p.busy_timeout_ms >= 0)
+        sqlite3_busy_timeout(db, p.busy_timeout_ms);
+}
+
+bool db_read_profile(sqlite3* db, DbProfile& out) {
+    if (!db) return false;
+    static const char* const SYNC_NAMES[] = { "OFF", "NORMAL", "FULL", "EXTRA" };
+    static const char* const TEMP_NAMES[] = { "DEFAULT", "FILE", "MEMORY" };
+
+    out.journal_mode = pragma_text(db, "journal_mode");
+    int sync = std::atoi(pragma_text(db, "synchronous").c_str());
+    out.synchronous = (sync >= 0 && sync <= 3) ? SYNC_NAMES[sync] : std::to_string(sync);
+
+    // cache_size is reported in pages when positive and in KiB when negative.
+    long long cache = std::atoll(pragma_text(db, "cache_size").c_str());
+    long long page = std::atoll(pragma_text(db, "page_size").c_str());
+    out.cache_size_kib = cache < 0 ? -cache : cache * page / 1024;
+
+    out.mmap_size = std::atoll(pragma_text(db, "mmap_size").c_str());
+    int temp = std::atoi(pragma_text(db, "temp_store").c_str());
+    out.temp_store = (temp >= 0 && temp <= 2) ? TEMP_NAMES[temp] : std::to_string(temp);
+    out.busy_timeout_ms = std::atoi(pragma_text(db, "busy_timeout").c_str());
+    return true;
+}
+
+/* =========================
+   SQL functions
+   ========================= */
+
+// weighted(internal, final): Grade::weighted() as SQL, so the 0.3/0.7 rule
+// has a single definition. NULL in -> NULL out.
+static void sql_weighted(sqlite3_context* ctx, int /*argc*/, sqlite3_value** argv) {
+    if (sqlite3_value_type(argv[0]) == SQLITE_NULL || sqlite3_value_type(argv[1]) == SQLITE_NULL) {
+        sqlite3_result_null(ctx);
+        return;
+    }
+    Grade g;
+    g.internal_mark = sqlite3_value_double(argv[0]);
+    g.final_mark = sqlite3_value_double(argv[1]);
+    sqlite3_result_double(ctx, g.weighted());
+}
+
+// passed(internal, final [, threshold]): 1 if weighted >= threshold
+// (default PASS_MARK), else 0. NULL marks -> NULL.
+static void sql_passed(sqlite3_context* ctx, int argc, sqlite3_value** argv) {
+    if (sqlite3_value_type(argv[0]) == SQLITE_NULL || sqlite3_value_type(argv[1]) == SQLITE_NULL) {
+        sqlite3_result_null(ctx);
+        return;
+    }
+    Grade g;
+    g.internal_mark = sqlite3_value_double(argv[0]);
+    g.final_mark = sqlite3_value_double(argv[1]);
+    const double threshold = argc > 2 ? sqlite3_value_double(argv[2]) : PASS_MARK;
+    sqlite3_result_int(ctx, g.weighted() >= threshold ? 1 : 0);
+}
+
+bool db_register_functions(sqlite3* db) {
+    // DETERMINISTIC lets them appear in index expressions; INNOCUOUS lets the
+    // schema use them even with trusted_schema=OFF.
+    const int flags = SQLITE_UTF8 | SQLITE_DETERMINISTIC | SQLITE_INNOCUOUS;
+    return sqlite3_create_function_v2(db, "weighted", 2, flags, nullptr, sql_weighted, nullptr, nullptr, nullptr) == SQLITE_OK &&
+        sqlite3_create_function_v2(db, "passed", 2, flags, nullptr, sql_passed, nullptr, nullptr, nullptr) == SQLITE_OK &&
+        sqlite3_create_function_v2(db, "passed", 3, flags, nullptr, sql_passed, nullptr, nullptr, nullptr) == SQLITE_OK;
+}
+
+// Open (or create) the SQLite database file at `path`, enable FK constraints
+// and apply the connection profile. Returns false if the DB cannot be opened.
+bool db_open(sqlite3*& db, const std::string& path,
+    const DbProfile& profile, DbProfile* applied) {
     db = nullptr;
     if (sqlite3_open(path.c_str(), &db) != SQLITE_OK) {
         std::cerr << "Failed to open DB: " << sqlite3_errmsg(db) << "\n";
+        sqlite3_close(db);
+        db = nullptr;
         return false;
     }
+    db_register_functions(db);   // weighted()/passed() for ad-hoc SQL
     // Enforce FK constraints for this connection
     exec_sql(db, "PRAGMA foreign_keys = ON;");
+    // REPLACE conflicts must fire the delete triggers (change log, counts).
+    exec_sql(db, "PRAGMA recursive_triggers = ON;");
+    apply_profile(db, profile);
+
+    // Attach an empty statement cache; slots fill in as statements are used.
+    sqlite3_set_clientdata(db, STMT_CACHE_KEY, new StmtCache(),
+        [](void* p) { delete static_cast<StmtCache*>(p); });
+
+    if (applied) {
+        applied->name = profile.name;
+        db_read_profile(db, *applied);
+    }
     return true;
 }
 
-// Close the database handle if non-null. Safe to call multiple times.
+// Finalize cached statements and close the database handle if non-null.
 void db_close(sqlite3* db) {
-    if (db) sqlite3_close(db);
+    if (!db) return;
+    db_writer_stop(db);   // commits whatever is still queued
+    db_sync_detach(db);   // no hooks may fire into a half-closed handle
+    if (StmtCache* cache = stmt_cache(db)) {
+        for (auto*& st : cache->st) { sqlite3_finalize(st); st = nullptr; }
+    }
+    sqlite3_close(db);   // also frees the StmtCache via its clientdata destructor
 }
 
-// Create tables if they don't exist yet and seed some initial data the first
-// time the app runs. Safe to call on every startup.
-bool db_init_and_seed(sqlite3* db) {
-    // 1) Create tables (idempotent). FK cascades delete dependent grade rows.
-    const char* ddl =
-        "PRAGMA foreign_keys = ON;"
-
-        "CREATE TABLE IF NOT EXISTS students ("
-        "  roll_no   TEXT PRIMARY KEY,"
-        "  name      TEXT NOT NULL,"
-        "  address   TEXT,"
-        "  contact   TEXT"
-        ");"
-
-        "CREATE TABLE IF NOT EXISTS courses ("
-        "  code        TEXT PRIMARY KEY,"
-        "  title       TEXT NOT NULL,"
-        "  description TEXT,"
-        "  teacher     TEXT"
-        ");"
-
-        "CREATE TABLE IF NOT EXISTS grades ("
+void db_set_stmt_cache(sqlite3* db, bool enabled) {
+    StmtCache* cache = db ? stmt_cache(db) : nullptr;
+    if (!cache) return;
+    cache->enabled = enabled;
+}
+
+// Schema version stored in PRAGMA user_version. The DDL below only runs when
+// the file is older than this; bump it whenever the DDL changes.
+//   1  tables + change log
+//   2  secondary indexes (INDEX_DDL)
+//   3  trigger-maintained row counts (COUNTS_DDL)
+//   4  covering report indexes replace grades_by_course (INDEX_DDL)
+//   5  grades_course_weighted on the weighted mark (INDEX_DDL)
+//   6  stored generated column grades.weighted (table rebuild, see
+//      migrate_grades_weighted); grades_course_rank replaces
+//      grades_course_marks and grades_course_weighted
+//   7  FTS5 search indexes students_fts / courses_fts (SEARCH_DDL)
+//   8  key format triggers (KEY_DDL); files holding keys the cache cannot
+//      pack are refused (check_key_formats)
+//   9  one INSERT trigger per table, built from INSERT_ACTIONS
+static const int SCHEMA_VERSION = 9;
+
+// grades as of the current schema, under `name` (the migration builds a
+// copy before swapping it in). `weighted` is computed by SQLite on every
+// write and stored, so it can be indexed and ranked on like a real column.
+static std::string grades_table_ddl(const char* name) {
+    return std::string("CREATE TABLE IF NOT EXISTS ") + name + " ("
         "  roll_no       TEXT NOT NULL,"
         "  course_code   TEXT NOT NULL,"
         "  internal_mark REAL NOT NULL DEFAULT 0,"
         "  final_mark    REAL NOT NULL DEFAULT 0,"
+        "  weighted      REAL GENERATED ALWAYS AS " SQL_WEIGHTED " STORED,"
         "  PRIMARY KEY (roll_no, course_code),"
         "  FOREIGN KEY (roll_no) REFERENCES students(roll_no) ON DELETE CASCADE,"
         "  FOREIGN KEY (course_code) REFERENCES courses(code) ON DELETE CASCADE"
         ");";
-    if (!exec_sql(db, ddl)) return false;
+}
+
+// Secondary indexes for lookups the primary keys do not cover. grades' key
+// is (roll_no, course_code), so anything by course alone - including the
+// ON DELETE CASCADE from courses - would otherwise scan every grade row.
+//   grades_student_marks  carries the marks, so the student report
+//                         (db_student_report) is read from the index alone.
+//   grades_course_rank    each course's grades best-first: ranking, top-N
+//                         and "below X" lists are index-ordered range reads,
+//                         and the course report aggregate is index-only.
+// The DROPs retire indexes of earlier schema versions.
+// db_check_query_plans fails if a statement loses its index.
+static const char* INDEX_DDL =
+    "DROP INDEX IF EXISTS grades_by_course;"
+    "DROP INDEX IF EXISTS grades_course_marks;"
+    "DROP INDEX IF EXISTS grades_course_weighted;"
+    "CREATE INDEX IF NOT EXISTS grades_student_marks ON grades(roll_no, course_code, internal_mark, final_mark);"
+    "CREATE INDEX IF NOT EXISTS grades_course_rank ON grades(course_code, weighted DESC, roll_no);";
+
+// Row counts kept by triggers in a single row, so db_get_counts is one
+// primary-key lookup instead of three COUNT(*) B-tree walks. The INSERT
+// counts whatever is already there when the table is first created (OR
+// IGNORE keeps a live row if the DDL re-runs). REPLACE conflicts only fire
+// the delete triggers with recursive_triggers on, which db_open sets. The
+// insert side is in INSERT_ACTIONS.
+static const char* COUNTS_DDL =
+    "CREATE TABLE IF NOT EXISTS sms_counts ("
+    "  id       INTEGER PRIMARY KEY CHECK (id = 0),"
+    "  students INTEGER NOT NULL,"
+    "  courses  INTEGER NOT NULL,"
+    "  grades   INTEGER NOT NULL"
+    ");"
+    "INSERT OR IGNORE INTO sms_counts(id,students,courses,grades) SELECT 0,"
+    " (SELECT COUNT(*) FROM students), (SELECT COUNT(*) FROM courses), (SELECT COUNT(*) FROM grades);"
+
+    "CREATE TRIGGER IF NOT EXISTS students_count_del AFTER DELETE ON students"
+    " BEGIN UPDATE sms_counts SET students = students - 1 WHERE id = 0; END;"
+    "CREATE TRIGGER IF NOT EXISTS courses_count_del AFTER DELETE ON courses"
+    " BEGIN UPDATE sms_counts SET courses = courses - 1 WHERE id = 0; END;"
+    "CREATE TRIGGER IF NOT EXISTS grades_count_del AFTER DELETE ON grades"
+    " BEGIN UPDATE sms_counts SET grades = grades - 1 WHERE id = 0; END;";
+
+// Full-text indexes for db_search_students / db_search_courses. They are
+// external-content tables: the text lives only in students/courses, the FTS
+// tables hold just the inverted index, which the triggers keep in step (an
+// update is a 'delete' of the old values plus an insert of the new ones;
+// inserts are in INSERT_ACTIONS).
+// prefix='2 3' makes the "word*" prefix queries the search builds cheap.
+// 'rebuild' re-indexes existing rows; it runs with every schema upgrade, so a
+// file from before version 7 gets its index filled.
+static const char* SEARCH_DDL =
+    "CREATE VIRTUAL TABLE IF NOT EXISTS students_fts USING fts5("
+    "  name, address, content='students', content_rowid='rowid',"
+    "  tokenize='unicode61 remove_diacritics 2', prefix='2 3');"
+    "CREATE VIRTUAL TABLE IF NOT EXISTS courses_fts USING fts5("
+    "  title, description, teacher, content='courses', content_rowid='rowid',"
+    "  tokenize='unicode61 remove_diacritics 2', prefix='2 3');"
+
+    "CREATE TRIGGER IF NOT EXISTS students_fts_del AFTER DELETE ON students BEGIN"
+    "  INSERT INTO students_fts(students_fts, rowid, name, address)"
+    "  VALUES('delete', OLD.rowid, OLD.name, OLD.address);"
+    " END;"
+    "CREATE TRIGGER IF NOT EXISTS students_fts_upd AFTER UPDATE OF name, address ON students BEGIN"
+    "  INSERT INTO students_fts(students_fts, rowid, name, address)"
+    "  VALUES('delete', OLD.rowid, OLD.name, OLD.address);"
+    "  INSERT INTO students_fts(rowid, name, address) VALUES(NEW.rowid, NEW.name, NEW.address);"
+    " END;"
+
+    "CREATE TRIGGER IF NOT EXISTS courses_fts_del AFTER DELETE ON courses BEGIN"
+    "  INSERT INTO courses_fts(courses_fts, rowid, title, description, teacher)"
+    "  VALUES('delete', OLD.rowid, OLD.title, OLD.description, OLD.teacher);"
+    " END;"
+    "CREATE TRIGGER IF NOT EXISTS courses_fts_upd AFTER UPDATE OF title, description, teacher ON courses BEGIN"
+    "  INSERT INTO courses_fts(courses_fts, rowid, title, description, teacher)"
+    "  VALUES('delete', OLD.rowid, OLD.title, OLD.description, OLD.teacher);"
+    "  INSERT INTO courses_fts(rowid, title, description, teacher)"
+    "  VALUES(NEW.rowid, NEW.title, NEW.description, NEW.teacher);"
+    " END;"
+
+    "INSERT INTO students_fts(students_fts) VALUES('rebuild');"
+    "INSERT INTO courses_fts(courses_fts) VALUES('rebuild');";
+
+// The cache packs every key into 32 bits (keys.hpp), so a row whose key does
+// not fit could not be loaded. These triggers turn such keys away at write
+// time, whoever writes - this app, `sqlite3`, a DB browser - with the same
+// message the menu would give. The insert checks are in INSERT_ACTIONS.
+static const char* KEY_DDL =
+    "CREATE TRIGGER IF NOT EXISTS students_key_upd BEFORE UPDATE OF roll_no ON students"
+    " WHEN NOT " SQL_ROLL_OK("NEW.roll_no")
+    " BEGIN SELECT RAISE(ABORT, 'invalid roll_no (S + 3-6 digits)'); END;"
+    "CREATE TRIGGER IF NOT EXISTS courses_key_upd BEFORE UPDATE OF code ON courses"
+    " WHEN NOT " SQL_COURSE_OK("NEW.code")
+    " BEGIN SELECT RAISE(ABORT, 'invalid course code (2-4 letters + 3 digits)'); END;"
+    "CREATE TRIGGER IF NOT EXISTS grades_key_upd BEFORE UPDATE OF roll_no, course_code ON grades"
+    " WHEN NOT (" SQL_ROLL_OK("NEW.roll_no") " AND " SQL_COURSE_OK("NEW.course_code") ")"
+    " BEGIN SELECT RAISE(ABORT, 'invalid roll_no or course code'); END;";
+
+// What happens when a row is inserted, written once and turned into both the
+// table's INSERT trigger and the set-based statements that catch up after a
+// bulk batch ran with triggers switched off (see run_batch). Each table has
+// a single trigger, <table>_ins, running its actions in order, so an insert
+// costs one trigger call.
+//
+// In the trigger an action is `head` + `tail` over the new row NEW (a bare
+// "SELECT COUNT(*)" there is 1). Its catch-up is
+//   head + " FROM <table> AS NEW WHERE NEW.rowid > ?1 ORDER BY NEW.rowid" + tail
+// the same statement over every row added since ?1, the table's largest
+// rowid before the batch. The key checks (RAISE undoes the insert) have no
+// catch-up: a batch only writes packed ids (keys.hpp), which always format
+// to valid keys.
+struct InsertAction {
+    const char* table;
+    const char* head;
+    const char* tail;
+    bool catch_up;
+};
+
+static const InsertAction INSERT_ACTIONS[] = {
+    { "students", "SELECT RAISE(ABORT, 'invalid roll_no (S + 3-6 digits)') WHERE NOT " SQL_ROLL_OK("NEW.roll_no"),
+      "", false },
+    { "students", "INSERT INTO students_fts(rowid, name, address) SELECT NEW.rowid, NEW.name, NEW.address",
+      "", true },
+    { "students", "UPDATE sms_counts SET students = students + (SELECT COUNT(*)", ") WHERE id = 0", true },
+    { "students", "INSERT INTO sms_changes(tbl,row) SELECT 0, NEW.rowid", "", true },
+
+    { "courses", "SELECT RAISE(ABORT, 'invalid course code (2-4 letters + 3 digits)') WHERE NOT " SQL_COURSE_OK("NEW.code"),
+      "", false },
+    { "courses", "INSERT INTO courses_fts(rowid, title, description, teacher)"
+                 " SELECT NEW.rowid, NEW.title, NEW.description, NEW.teacher", "", true },
+    { "courses", "UPDATE sms_counts SET courses = courses + (SELECT COUNT(*)", ") WHERE id = 0", true },
+    { "courses", "INSERT INTO sms_changes(tbl,row) SELECT 1, NEW.rowid", "", true },
+
+    { "grades", "SELECT RAISE(ABORT, 'invalid roll_no or course code') WHERE NOT ("
+                SQL_ROLL_OK("NEW.roll_no") " AND " SQL_COURSE_OK("NEW.course_code") ")", "", false },
+    { "grades", "UPDATE sms_counts SET grades = grades + (SELECT COUNT(*)", ") WHERE id = 0", true },
+    { "grades", "INSERT INTO sms_changes(tbl,row) SELECT 2, NEW.rowid", "", true },
+};
 
-    // 2) Seed only when tables are empty. A fast existence check per table.
-    auto table_empty = [&](const char* table)->bool {
+// The <table>_ins triggers. Schema 9 replaced one trigger per action
+// (<table>_key_ins, _fts_ins, _count_ins, _log_ins); the DROPs retire them.
+static std::string insert_trigger_ddl() {
+    std::string sql;
+    for (const char* table : { "students", "courses", "grades" }) {
+        const std::string t = table;
+        sql += "DROP TRIGGER IF EXISTS " + t + "_key_ins; DROP TRIGGER IF EXISTS " + t + "_fts_ins;"
+            "DROP TRIGGER IF EXISTS " + t + "_count_ins; DROP TRIGGER IF EXISTS " + t + "_log_ins;"
+            "DROP TRIGGER IF EXISTS " + t + "_ins;"
+            "CREATE TRIGGER " + t + "_ins AFTER INSERT ON " + t + " BEGIN";
+        for (const InsertAction& a : INSERT_ACTIONS)
+            if (t == a.table) sql += std::string(" ") + a.head + a.tail + ";";
+        sql += " END;";
+    }
+    return sql;
+}
+
+static std::string insert_catch_up_sql(const InsertAction& a) {
+    return std::string(a.head) + " FROM " + a.table +
+        " AS NEW WHERE NEW.rowid > ?1 ORDER BY NEW.rowid" + a.tail + ";";
+}
+
+// Rows already in the file that KEY_DDL would have refused (at most 20).
+static const char* BAD_KEYS_SQL =
+    "SELECT 'student roll_no', roll_no FROM students WHERE NOT " SQL_ROLL_OK("roll_no")
+    " UNION ALL SELECT 'course code', code FROM courses WHERE NOT " SQL_COURSE_OK("code")
+    " UNION ALL SELECT 'grade roll_no', roll_no FROM grades WHERE NOT " SQL_ROLL_OK("roll_no")
+    " UNION ALL SELECT 'grade course_code', course_code FROM grades WHERE NOT " SQL_COURSE_OK("course_code")
+    " LIMIT 20;";
+
+// Seeding probe: which of the three tables already has rows.
+static const char* SEED_PROBE_SQL =
+    "SELECT EXISTS(SELECT 1 FROM students), EXISTS(SELECT 1 FROM courses), "
+    "EXISTS(SELECT 1 FROM grades);";
+
+// Change log: one row per inserted/updated/deleted row of the three tables
+// (tbl = SyncTable value, row = rowid). Read by sync_catch_up, pruned when a
+// snapshot is written. Inserts are logged by INSERT_ACTIONS.
+static const char* CHANGE_LOG_DDL =
+    "CREATE TABLE IF NOT EXISTS sms_meta ("
+    "  key   TEXT PRIMARY KEY,"
+    "  value"
+    ");"
+    "INSERT OR IGNORE INTO sms_meta(key,value) VALUES('db_id', random());"
+
+    "CREATE TABLE IF NOT EXISTS sms_changes ("
+    "  seq INTEGER PRIMARY KEY AUTOINCREMENT,"
+    "  tbl INTEGER NOT NULL,"
+    "  row INTEGER NOT NULL"
+    ");"
+
+    "CREATE TRIGGER IF NOT EXISTS students_log_upd AFTER UPDATE ON students"
+    " BEGIN INSERT INTO sms_changes(tbl,row) VALUES(0, NEW.rowid); END;"
+    "CREATE TRIGGER IF NOT EXISTS students_log_del AFTER DELETE ON students"
+    " BEGIN INSERT INTO sms_changes(tbl,row) VALUES(0, OLD.rowid); END;"
+
+    "CREATE TRIGGER IF NOT EXISTS courses_log_upd AFTER UPDATE ON courses"
+    " BEGIN INSERT INTO sms_changes(tbl,row) VALUES(1, NEW.rowid); END;"
+    "CREATE TRIGGER IF NOT EXISTS courses_log_del AFTER DELETE ON courses"
+    " BEGIN INSERT INTO sms_changes(tbl,row) VALUES(1, OLD.rowid); END;"
+
+    "CREATE TRIGGER IF NOT EXISTS grades_log_upd AFTER UPDATE ON grades"
+    " BEGIN INSERT INTO sms_changes(tbl,row) VALUES(2, NEW.rowid); END;"
+    "CREATE TRIGGER IF NOT EXISTS grades_log_del AFTER DELETE ON grades"
+    " BEGIN INSERT INTO sms_changes(tbl,row) VALUES(2, OLD.rowid); END;";
+
+// Schema 6 added the stored column grades.weighted. ALTER TABLE cannot add a
+// STORED generated column, so files from before are rebuilt: copy the rows
+// (rowids kept, so the change log and snapshots still line up) into a new
+// table and swap it in. FK enforcement is off during the swap, otherwise
+// dropping the old table would cascade into nothing. Its triggers and
+// indexes go with it; db_init_and_seed recreates them right after.
+static const char* WEIGHTED_PROBE_SQL = "SELECT 1 FROM pragma_table_xinfo('grades') WHERE name='weighted';";
+
+static bool migrate_grades_weighted(sqlite3* db) {
+    bool has_column = false;
+    {
         sqlite3_stmt* st = nullptr;
-        std::string q = std::string("SELECT 1 FROM ") + table + " LIMIT 1;";
-        bool empty = true;
-        if (sqlite3_prepare_v2(db, q.c_str(), -1, &st, nullptr) == SQLITE_OK) {
-            if (sqlite3_step(st) == SQLITE_ROW) empty = false;
+        if (sqlite3_prepare_v2(db, WEIGHTED_PROBE_SQL, -1, &st, nullptr) != SQLITE_OK) return false;
+        has_column = sqlite3_step(st) == SQLITE_ROW;
+        sqlite3_finalize(st);
+    }
+    if (has_column) return true;
+
+    exec_sql(db, "PRAGMA foreign_keys = OFF;");
+    const bool ok = exec_sql(db, "BEGIN IMMEDIATE;") &&
+        exec_sql(db, grades_table_ddl("grades_migrating").c_str()) &&
+        exec_sql(db,
+            "INSERT INTO grades_migrating(rowid, roll_no, course_code, internal_mark, final_mark)"
+            " SELECT rowid, roll_no, course_code, internal_mark, final_mark FROM grades;"
+            "DROP TABLE grades;"
+            "ALTER TABLE grades_migrating RENAME TO grades;") &&
+        exec_sql(db, "COMMIT;");
+    if (!ok) exec_sql(db, "ROLLBACK;");
+    exec_sql(db, "PRAGMA foreign_keys = ON;");
+    return ok;
+}
+
+// Schema 8 migration: refuse a file holding keys the cache cannot pack,
+// naming each one, rather than open it and leave those rows out of every
+// screen, report and export. Fix or delete them in a DB browser and restart.
+static bool check_key_formats(sqlite3* db) {
+    sqlite3_stmt* st = nullptr;
+    if (sqlite3_prepare_v2(db, BAD_KEYS_SQL, -1, &st, nullptr) != SQLITE_OK) return false;
+    int bad = 0;
+    while (sqlite3_step(st) == SQLITE_ROW) {
+        const unsigned char* key = sqlite3_column_text(st, 1);
+        std::cerr << "Unsupported " << sqlite3_column_text(st, 0) << " '"
+            << (key ? reinterpret_cast<const char*>(key) : "NULL") << "'\n";
+        ++bad;
+    }
+    sqlite3_finalize(st);
+    if (bad == 0) return true;
+    std::cerr << "school.db has " << (bad == 20 ? "20 or more" : std::to_string(bad))
+        << " key(s) outside the supported formats (roll_no: S + 3-6 digits, "
+           "course code: 2-4 letters + 3 digits).\n";
+    return false;
+}
+
+// Create tables if they don't exist yet and seed some initial data the first
+// time the app runs. Safe to call on every startup; once the schema is
+// current it costs one PRAGMA and one probe query.
+bool db_init_and_seed(sqlite3* db) {
+    // 1) Create tables (idempotent), skipped once user_version is current.
+    //    FK cascades delete dependent grade rows.
+    if (std::atoi(pragma_text(db, "user_version").c_str()) < SCHEMA_VERSION) {
+        const char* ddl =
+            "PRAGMA foreign_keys = ON;"
+
+            "CREATE TABLE IF NOT EXISTS students ("
+            "  roll_no   TEXT PRIMARY KEY,"
+            "  name      TEXT NOT NULL,"
+            "  address   TEXT,"
+            "  contact   TEXT"
+            ");"
+
+            "CREATE TABLE IF NOT EXISTS courses ("
+            "  code        TEXT PRIMARY KEY,"
+            "  title       TEXT NOT NULL,"
+            "  description TEXT,"
+            "  teacher     TEXT"
+            ");";
+        // Order matters: the grades rebuild drops its indexes and triggers,
+        // which the DDL after it (re)creates.
+        if (!exec_sql(db, ddl) || !exec_sql(db, grades_table_ddl("grades").c_str()) ||
+            !migrate_grades_weighted(db) || !check_key_formats(db) || !exec_sql(db, KEY_DDL) ||
+            !exec_sql(db, CHANGE_LOG_DDL) || !exec_sql(db, INDEX_DDL) ||
+            !exec_sql(db, COUNTS_DDL) || !exec_sql(db, SEARCH_DDL) ||
+            !exec_sql(db, insert_trigger_ddl().c_str())) return false;
+        exec_sql(db, ("PRAGMA user_version = " + std::to_string(SCHEMA_VERSION) + ";").c_str());
+    }
+
+    // 2) Seed only when tables are empty. One probe covers all three tables.
+    bool has[3] = { true, true, true };
+    {
+        sqlite3_stmt* st = nullptr;
+        if (sqlite3_prepare_v2(db, SEED_PROBE_SQL, -1, &st, nullptr) == SQLITE_OK &&
+            sqlite3_step(st) == SQLITE_ROW) {
+            for (int i = 0; i < 3; ++i) has[i] = sqlite3_column_int(st, i) != 0;
         }
         sqlite3_finalize(st);
-        return empty;
-        };
+    }
 
-    if (table_empty("students")) {
+    if (!has[0]) {
         const char* seed_students =
             "INSERT INTO students(roll_no,name,address,contact) VALUES"
             "('S001','Ava','12 Oak St','021-111'),"
@@ -110,7 +766,7 @@ bool db_init_and_seed(sqlite3* db) {
         if (!exec_sql(db, seed_students)) return false;
     }
 
-    if (table_empty("courses")) {
+    if (!has[1]) {
         const char* seed_courses =
             "INSERT INTO courses(code,title,description,teacher) VALUES"
             "('MTH101','Maths','Numbers and algebra','Mr. King'),"
@@ -119,7 +775,7 @@ bool db_init_and_seed(sqlite3* db) {
         if (!exec_sql(db, seed_courses)) return false;
     }
 
-    if (table_empty("grades")) {
+    if (!has[2]) {
         const char* seed_grades =
             "INSERT INTO grades(roll_no,course_code,internal_mark,final_mark) VALUES"
             "('S001','MTH101',75,88),"
@@ -132,62 +788,678 @@ bool db_init_and_seed(sqlite3* db) {
     return true;
 }
 
-// Load full tables into the in-memory DataStore (used by the UI/reporting).
-// Clears the vectors first to avoid duplicates.
-bool db_load_all(sqlite3* db, DataStore& store) {
-    store.all_students.clear();
-    store.all_courses.clear();
-    store.all_grades.clear();
+// Read a key column into its packed id. db_init_and_seed refuses files with
+// keys outside the roll/course format and KEY_DDL rejects new ones, so this
+// only fires if those triggers were dropped by hand; such rows are reported
+// and skipped rather than loaded with an invalid id.
+static bool column_roll(sqlite3_stmt* st, int col, RollId& out) {
+    const char* t = reinterpret_cast<const char*>(sqlite3_column_text(st, col));
+    if (t && parse_roll(t, static_cast<size_t>(sqlite3_column_bytes(st, col)), out)) return true;
+    std::cerr << "Skipping row with malformed roll_no '" << (t ? t : "NULL") << "'\n";
+    return false;
+}
 
-    // --- load students ------------------------------------------------------
-    {
-        sqlite3_stmt* st = nullptr;
-        if (sqlite3_prepare_v2(db, "SELECT roll_no,name,address,contact FROM students;", -1, &st, nullptr) != SQLITE_OK)
-            return false;
-        while (sqlite3_step(st) == SQLITE_ROW) {
-            Student s;
-            // NOTE: if schema ever allows NULLs here, guard against nullptrs.
-            s.roll_no = reinterpret_cast<const char*>(sqlite3_column_text(st, 0));
-            s.name = reinterpret_cast<const char*>(sqlite3_column_text(st, 1));
-            s.address = reinterpret_cast<const char*>(sqlite3_column_text(st, 2));
-            s.contact = reinterpret_cast<const char*>(sqlite3_column_text(st, 3));
-            store.all_students.push_back(s);
+static bool column_course(sqlite3_stmt* st, int col, CourseId& out) {
+    const char* t = reinterpret_cast<const char*>(sqlite3_column_text(st, col));
+    if (t && parse_course(t, static_cast<size_t>(sqlite3_column_bytes(st, col)), out)) return true;
+    std::cerr << "Skipping row with malformed course code '" << (t ? t : "NULL") << "'\n";
+    return false;
+}
+
+// NULL-safe text column (the sync path reads rows written by anyone).
+static std::string column_str(sqlite3_stmt* st, int col) {
+    const unsigned char* t = sqlite3_column_text(st, col);
+    return t ? std::string(reinterpret_cast<const char*>(t), static_cast<size_t>(sqlite3_column_bytes(st, col)))
+             : std::string();
+}
+
+/* =========================
+   Cache sync (update hooks)
+   ========================= */
+
+// Keeps one DataStore in step with every row this connection changes,
+// including FK cascades and trigger side effects. SQLite only reports
+// (operation, table, rowid) and the hooks must not use the connection, so:
+//   - the update hook records dirty rowids per table,
+//   - the commit hook marks them ready, the rollback hook drops them,
+//   - once the connection is back in autocommit, sync_flush re-reads each
+//     dirty rowid and applies what it finds (row present -> upsert, gone ->
+//     erase the key that rowid used to hold).
+// Because the flush looks at the committed row rather than replaying the
+// operation, statement aborts and ROLLBACK TO (which fire no hook) and
+// repeated changes to one row all come out right.
+//
+// Writes by other connections never reach our hooks. They do land in the
+// sms_changes log, so sync_flush notices when the log grew by more than our
+// own rows and catches up from it. That includes rows removed by INSERT OR
+// REPLACE conflict resolution, which the update hook does not report: with
+// recursive_triggers on (db_open) they fire the delete triggers, so the log
+// grows by more than the hook saw.
+enum SyncTable { SY_STUDENTS, SY_COURSES, SY_GRADES, SY_COUNT_ };
+
+struct SyncState {
+    DataStore* store = nullptr;
+    // rowid -> key it held at the last flush, so a deleted rowid can be mapped
+    // back to the row to erase
+    FlatMap<std::int64_t, RollId> student_key;
+    FlatMap<std::int64_t, CourseId> course_key;
+    FlatMap<std::int64_t, std::uint64_t> grade_key;
+    std::vector<sqlite3_int64> dirty[SY_COUNT_];
+    sqlite3_int64 log_seq = 0;    // sms_changes.seq the store is current up to
+    sqlite3_int64 hook_rows = 0;  // row changes reported since the last flush
+    bool ready = false;      // a commit happened since the last flush
+    bool applying = false;   // the flush's own reads must not re-enter it
+};
+
+static const char* SYNC_KEY = "pspschool.sync";
+
+static SyncState* sync_state(sqlite3* db) {
+    return static_cast<SyncState*>(sqlite3_get_clientdata(db, SYNC_KEY));
+}
+
+static int sync_table(const char* table) {
+    if (std::strcmp(table, "grades") == 0) return SY_GRADES;
+    if (std::strcmp(table, "students") == 0) return SY_STUDENTS;
+    if (std::strcmp(table, "courses") == 0) return SY_COURSES;
+    return SY_COUNT_;
+}
+
+static void sync_on_update(void* arg, int /*op*/, const char* dbname, const char* table, sqlite3_int64 rowid) {
+    if (std::strcmp(dbname, "main") != 0) return;
+    const int t = sync_table(table);
+    if (t == SY_COUNT_) return;
+    auto* s = static_cast<SyncState*>(arg);
+    s->dirty[t].push_back(rowid);
+    ++s->hook_rows;
+}
+
+static int sync_on_commit(void* arg) {
+    static_cast<SyncState*>(arg)->ready = true;
+    return 0;   // never veto the commit
+}
+
+static void sync_on_rollback(void* arg) {
+    auto* s = static_cast<SyncState*>(arg);
+    if (s->ready) return;   // committed changes not flushed yet; re-reading is harmless
+    for (auto& d : s->dirty) d.clear();
+    s->hook_rows = 0;
+}
+
+// Returning SQLITE_IGNORE for a DELETE keeps the delete but turns off the
+// truncate optimization, so "DELETE FROM t" with no WHERE still reports each
+// row to the update hook. Limited to our tables: an IGNORE on sqlite_master
+// would silently cancel DROP TABLE.
+static int sync_on_authorize(void*, int action, const char* table, const char*, const char*, const char*) {
+    if (action == SQLITE_DELETE && table && sync_table(table) != SY_COUNT_) return SQLITE_IGNORE;
+    return SQLITE_OK;
+}
+
+// One dirty rowid after re-reading it.
+template <class Row>
+struct SyncRow {
+    sqlite3_int64 rowid = 0;
+    bool present = false;
+    Row row;
+};
+
+// Re-read each dirty rowid of one table. Rows that fail to read (I/O error)
+// are left out, so the store keeps its previous copy; rows with a malformed
+// key count as gone.
+template <class Row, class ReadRow>
+static std::vector<SyncRow<Row>> sync_read(sqlite3* db, std::vector<sqlite3_int64>& dirty,
+    StmtId id, ReadRow read_row) {
+    std::sort(dirty.begin(), dirty.end());
+    dirty.erase(std::unique(dirty.begin(), dirty.end()), dirty.end());
+
+    std::vector<SyncRow<Row>> out;
+    out.reserve(dirty.size());
+    for (sqlite3_int64 rowid : dirty) {
+        StmtLease st(db, id);
+        if (!st) break;
+        sqlite3_bind_int64(st.get(), 1, rowid);
+        SyncRow<Row> r;
+        r.rowid = rowid;
+        const int rc = sqlite3_step(st.get());
+        if (rc == SQLITE_ROW) r.present = read_row(st.get(), r.row);
+        else if (rc != SQLITE_DONE) continue;
+        out.push_back(std::move(r));
+    }
+    dirty.clear();
+    return out;
+}
+
+// Re-read every dirty rowid and apply the result to the store.
+static void sync_apply(sqlite3* db, SyncState* s) {
+    DataStore& store = *s->store;
+
+    auto students = sync_read<Student>(db, s->dirty[SY_STUDENTS], ST_SYNC_STUDENT,
+        [](sqlite3_stmt* st, Student& r) {
+            if (!column_roll(st, 0, r.roll_no)) return false;
+            r.name = column_str(st, 1); r.address = column_str(st, 2); r.contact = column_str(st, 3);
+            return true;
+        });
+    auto courses = sync_read<Course>(db, s->dirty[SY_COURSES], ST_SYNC_COURSE,
+        [](sqlite3_stmt* st, Course& r) {
+            if (!column_course(st, 0, r.code)) return false;
+            r.title = column_str(st, 1); r.description = column_str(st, 2); r.teacher = column_str(st, 3);
+            return true;
+        });
+    auto grades = sync_read<Grade>(db, s->dirty[SY_GRADES], ST_SYNC_GRADE,
+        [](sqlite3_stmt* st, Grade& r) {
+            if (!column_roll(st, 0, r.roll_no) || !column_course(st, 1, r.course_code)) return false;
+            r.internal_mark = sqlite3_column_double(st, 2);
+            r.final_mark = sqlite3_column_double(st, 3);
+            return true;
+        });
+
+    // 1) Erase every key whose rowid is gone or now holds a different key.
+    //    All erases run before any upsert so a key that moved to another
+    //    rowid in the same transaction is erased once and re-inserted.
+    for (const auto& r : grades) {
+        const std::uint64_t* old = s->grade_key.find(r.rowid);
+        if (!old || (r.present && enrollment_key(r.row.roll_no, r.row.course_code) == *old)) continue;
+        store_erase_grade(store, enrollment_roll(*old), enrollment_course(*old));
+        s->grade_key.erase(r.rowid);
+    }
+    for (const auto& r : students) {
+        const RollId* old = s->student_key.find(r.rowid);
+        if (!old || (r.present && r.row.roll_no == *old)) continue;
+        store_erase_student(store, *old);   // also drops its grades from the store
+        s->student_key.erase(r.rowid);
+    }
+    for (const auto& r : courses) {
+        const CourseId* old = s->course_key.find(r.rowid);
+        if (!old || (r.present && r.row.code == *old)) continue;
+        store_erase_course(store, *old);
+        s->course_key.erase(r.rowid);
+    }
+
+    // 2) Upsert present rows, parents before grades.
+    for (const auto& r : students) {
+        if (!r.present) continue;
+        s->student_key.set(r.rowid, r.row.roll_no);
+        if (Student* cur = find_student(store, r.row.roll_no)) *cur = r.row;
+        else store_insert_student(store, r.row);
+    }
+    for (const auto& r : courses) {
+        if (!r.present) continue;
+        s->course_key.set(r.rowid, r.row.code);
+        if (Course* cur = find_course(store, r.row.code)) *cur = r.row;
+        else store_insert_course(store, r.row);
+    }
+    for (const auto& r : grades) {
+        if (!r.present) continue;
+        s->grade_key.set(r.rowid, enrollment_key(r.row.roll_no, r.row.course_code));
+        const std::uint32_t slot = find_grade_slot(store, r.row.roll_no, r.row.course_code);
+        if (slot == NO_SLOT) store_insert_grade(store, r.row);
+        else store_set_marks(store, slot, r.row.internal_mark, r.row.final_mark);
+    }
+}
+
+// Highest sms_changes.seq ever handed out, or -1 if the DB has no change log.
+static sqlite3_int64 log_head(sqlite3* db) {
+    StmtLease st(db, ST_LOG_HEAD);
+    if (!st || sqlite3_step(st.get()) != SQLITE_ROW) return -1;
+    return sqlite3_column_int64(st.get(), 0);
+}
+
+// Bring the store from s->log_seq up to the head of the change log by
+// re-reading every row logged since. Runs in one read transaction so the
+// rows and the new head agree. Returns the number of log entries replayed,
+// or -1 when the log cannot bridge the gap (entries pruned, log went
+// backwards, no log at all); the caller must then reload everything.
+static long long sync_catch_up(sqlite3* db, SyncState* s) {
+    // Queued write-behind rows are already in the store; re-reading their
+    // rows before they commit would put the old values back.
+    writer_drain(db);
+    const bool own_txn = sqlite3_get_autocommit(db) != 0;
+    if (own_txn && !exec_sql(db, "BEGIN;")) return -1;
+
+    long long n = -1;
+    const sqlite3_int64 head = log_head(db);
+    if (head >= s->log_seq) {
+        StmtLease st(db, ST_LOG_SINCE);
+        if (st) {
+            sqlite3_bind_int64(st.get(), 1, s->log_seq);
+            sqlite3_int64 expect = s->log_seq + 1;   // seqs are gapless unless pruned
+            n = 0;
+            while (sqlite3_step(st.get()) == SQLITE_ROW) {
+                if (sqlite3_column_int64(st.get(), 0) != expect++) { n = -1; break; }
+                const int t = sqlite3_column_int(st.get(), 1);
+                if (t >= 0 && t < SY_COUNT_) s->dirty[t].push_back(sqlite3_column_int64(st.get(), 2));
+                ++n;
+            }
+            if (expect != head + 1) n = -1;
         }
-        sqlite3_finalize(st);
     }
+    if (n >= 0) {
+        sync_apply(db, s);
+        s->log_seq = head;
+    }
+    for (auto& d : s->dirty) d.clear();
+    if (own_txn) exec_sql(db, "COMMIT;");
+    return n;
+}
+
+static void sync_flush(sqlite3* db) {
+    SyncState* s = db ? sync_state(db) : nullptr;
+    if (!s || !s->ready || s->applying || !sqlite3_get_autocommit(db)) return;
+    s->applying = true;
+    s->ready = false;
+    sync_apply(db, s);
 
-    // --- load courses -------------------------------------------------------
+    // The change log grew by one entry per row change. If it grew by exactly
+    // the number the update hook saw, nobody else wrote in between and the
+    // store is current up to the head. Otherwise catch up from the log
+    // (re-reading rows already applied is harmless) or, if the log was
+    // pruned under us, reload.
+    const sqlite3_int64 head = log_head(db);
+    if (head >= 0) {
+        if (head - s->log_seq == s->hook_rows) s->log_seq = head;
+        else if (sync_catch_up(db, s) < 0) db_load_all(db, *s->store);
+    }
+    s->hook_rows = 0;
+    s->applying = false;
+}
+
+// Stamp of the live database: db_id/user_version plus the change-log head.
+static bool read_db_stamp(sqlite3* db, SnapshotStamp& out) {
     {
-        sqlite3_stmt* st = nullptr;
-        if (sqlite3_prepare_v2(db, "SELECT code,title,description,teacher FROM courses;", -1, &st, nullptr) != SQLITE_OK)
-            return false;
-        while (sqlite3_step(st) == SQLITE_ROW) {
-            Course c;
-            c.code = reinterpret_cast<const char*>(sqlite3_column_text(st, 0));
-            c.title = reinterpret_cast<const char*>(sqlite3_column_text(st, 1));
-            c.description = reinterpret_cast<const char*>(sqlite3_column_text(st, 2));
-            c.teacher = reinterpret_cast<const char*>(sqlite3_column_text(st, 3));
-            store.all_courses.push_back(c);
+        StmtLease st(db, ST_STAMP);
+        if (!st || sqlite3_step(st.get()) != SQLITE_ROW) return false;
+        out.db_id = sqlite3_column_int64(st.get(), 0);
+        out.user_version = sqlite3_column_int64(st.get(), 1);
+    }
+    out.change_seq = log_head(db);
+    return out.change_seq >= 0;
+}
+
+// Try the snapshot; returns false (store left empty) when it cannot be used.
+static bool load_from_snapshot(sqlite3* db, SyncState* s, const std::string& path, DbLoadReport& rep) {
+    SnapshotStamp now, snap;
+    if (path.empty() || !read_db_stamp(db, now)) return false;
+
+    SnapshotRowids rowids;
+    if (!snapshot_load(path, now, *s->store, rowids, snap)) return false;
+
+    // Far behind? Replaying row by row would be slower than a full load.
+    const DataStore& d = *s->store;
+    const long long rows = static_cast<long long>(d.all_students.size() + d.all_courses.size() + d.all_grades.size());
+    if (now.change_seq - snap.change_seq > 4096 + rows / 8) { store_clear(*s->store); return false; }
+
+    s->student_key.reserve(rowids.students.size());
+    s->course_key.reserve(rowids.courses.size());
+    s->grade_key.reserve(rowids.grades.size());
+    for (size_t i = 0; i < rowids.students.size(); ++i) s->student_key.insert(rowids.students[i], d.all_students[i].roll_no);
+    for (size_t i = 0; i < rowids.courses.size(); ++i) s->course_key.insert(rowids.courses[i], d.all_courses[i].code);
+    for (size_t i = 0; i < rowids.grades.size(); ++i)
+        s->grade_key.insert(rowids.grades[i], enrollment_key(d.all_grades.roll_no[i], d.all_grades.course_code[i]));
+    s->log_seq = snap.change_seq;
+
+    rep.replayed = sync_catch_up(db, s);
+    if (rep.replayed < 0) {
+        store_clear(*s->store);
+        s->student_key.clear(); s->course_key.clear(); s->grade_key.clear();
+        return false;
+    }
+    rep.source = rep.replayed ? "snapshot+delta" : "snapshot";
+    return true;
+}
+
+bool db_sync_attach(sqlite3* db, DataStore& store, const std::string& snapshot_path, DbLoadReport* report) {
+    const auto t0 = std::chrono::steady_clock::now();
+    db_sync_detach(db);
+    auto* s = new SyncState();
+    s->store = &store;
+    sqlite3_set_clientdata(db, SYNC_KEY, s, [](void* p) { delete static_cast<SyncState*>(p); });
+    sqlite3_update_hook(db, sync_on_update, s);
+    sqlite3_commit_hook(db, sync_on_commit, s);
+    sqlite3_rollback_hook(db, sync_on_rollback, s);
+    sqlite3_set_authorizer(db, sync_on_authorize, nullptr);   // also re-prepares cached statements
+
+    DbLoadReport rep;
+    bool ok = load_from_snapshot(db, s, snapshot_path, rep);
+    if (!ok) ok = db_load_all(db, store, &rep);   // fills the store and the rowid -> key maps
+    rep.ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+    if (report) *report = rep;
+    return ok;
+}
+
+bool db_sync_save_snapshot(sqlite3* db, const std::string& snapshot_path) {
+    SyncState* s = sync_state(db);
+    if (!s || snapshot_path.empty() || !sqlite3_get_autocommit(db)) return false;
+
+    // Make sure the store reflects the log head the stamp will name. The
+    // catch-up drains the writer first; if it refused a queued write, the
+    // store holds a change the file does not (an update or delete the rowid
+    // check below cannot see), so leave that to db_writer_reconcile.
+    if (sync_catch_up(db, s) < 0 && !db_load_all(db, *s->store)) return false;
+    if (writer_failures(db) > 0) return false;
+    SnapshotStamp stamp;
+    if (!read_db_stamp(db, stamp)) return false;
+    stamp.change_seq = s->log_seq;
+
+    // rowid per store row, from the sync layer's rowid -> key maps.
+    const DataStore& d = *s->store;
+    SnapshotRowids rowids;
+    rowids.students.assign(d.all_students.size(), 0);
+    rowids.courses.assign(d.all_courses.size(), 0);
+    rowids.grades.assign(d.all_grades.size(), 0);
+    size_t mapped = 0;
+    s->student_key.for_each([&](std::int64_t rowid, RollId key) {
+        if (const std::uint32_t* slot = d.student_slot.find(key)) { rowids.students[*slot] = rowid; ++mapped; }
+    });
+    s->course_key.for_each([&](std::int64_t rowid, CourseId key) {
+        if (const std::uint32_t* slot = d.course_slot.find(key)) { rowids.courses[*slot] = rowid; ++mapped; }
+    });
+    s->grade_key.for_each([&](std::int64_t rowid, std::uint64_t key) {
+        if (const std::uint32_t* slot = d.grade_slot.find(key)) { rowids.grades[*slot] = rowid; ++mapped; }
+    });
+    // Every row must have exactly one rowid, or a later delete could be missed.
+    if (mapped != d.all_students.size() + d.all_courses.size() + d.all_grades.size()) return false;
+
+    if (!snapshot_save(snapshot_path, d, rowids, stamp)) return false;
+
+    // The snapshot now covers everything up to log_seq; drop those entries.
+    StmtLease st(db, ST_LOG_PRUNE);
+    if (st) {
+        sqlite3_bind_int64(st.get(), 1, s->log_seq);
+        sqlite3_step(st.get());
+    }
+    return true;
+}
+
+void db_sync_detach(sqlite3* db) {
+    if (!sync_state(db)) return;
+    sqlite3_update_hook(db, nullptr, nullptr);
+    sqlite3_commit_hook(db, nullptr, nullptr);
+    sqlite3_rollback_hook(db, nullptr, nullptr);
+    sqlite3_set_authorizer(db, nullptr, nullptr);
+    sqlite3_set_clientdata(db, SYNC_KEY, nullptr, nullptr);   // deletes the SyncState
+}
+
+void db_sync_flush(sqlite3* db) {
+    sync_flush(db);
+}
+
+/* =========================
+   Full load
+   ========================= */
+
+// One rowid range of one table, read by one connection into its own buffers.
+// db_load_all stitches the chunks back together in rowid order.
+enum LoadTable { LT_STUDENTS, LT_COURSES, LT_GRADES, LT_COUNT_ };
+
+static const char* const LOAD_SQL[LT_COUNT_] = {
+    "SELECT roll_no,name,address,contact,rowid FROM students WHERE rowid BETWEEN ?1 AND ?2;",
+    "SELECT code,title,description,teacher,rowid FROM courses WHERE rowid BETWEEN ?1 AND ?2;",
+    "SELECT roll_no,course_code,internal_mark,final_mark,rowid FROM grades WHERE rowid BETWEEN ?1 AND ?2;",
+};
+
+// Row count and rowid bounds of each table, in LoadTable order.
+static const char* LOAD_SIZE_SQL =
+    "SELECT (SELECT count(*) FROM students),(SELECT min(rowid) FROM students),(SELECT max(rowid) FROM students),"
+    "(SELECT count(*) FROM courses),(SELECT min(rowid) FROM courses),(SELECT max(rowid) FROM courses),"
+    "(SELECT count(*) FROM grades),(SELECT min(rowid) FROM grades),(SELECT max(rowid) FROM grades);";
+
+struct LoadChunk {
+    LoadTable table = LT_STUDENTS;
+    sqlite3_int64 lo = 0, hi = 0;   // inclusive rowid range
+    size_t expect = 0;              // estimated rows, for reserve()
+    bool ok = false;
+    std::vector<std::int64_t> rowids;
+    std::vector<Student> students;
+    std::vector<Course> courses;
+    GradeColumns grades;
+};
+
+// Below this many rows a single connection is faster than opening readers.
+static const size_t LOAD_PARALLEL_MIN_ROWS = 50000;
+// Smallest rowid range worth handing to its own reader.
+static const size_t LOAD_CHUNK_MIN_ROWS = 32768;
+static const unsigned LOAD_MAX_READERS = 8;
+
+// Copy a text column straight into an existing string (no temporary).
+static void column_assign(sqlite3_stmt* st, int col, std::string& out) {
+    const unsigned char* t = sqlite3_column_text(st, col);
+    if (t) out.assign(reinterpret_cast<const char*>(t), static_cast<size_t>(sqlite3_column_bytes(st, col)));
+    else out.clear();
+}
+
+// Read one chunk on `db`. Rows are built in place in the chunk's vectors.
+static bool load_chunk(sqlite3* db, LoadChunk& c) {
+    sqlite3_stmt* st = nullptr;
+    if (sqlite3_prepare_v2(db, LOAD_SQL[c.table], -1, &st, nullptr) != SQLITE_OK) return false;
+    sqlite3_bind_int64(st, 1, c.lo);
+    sqlite3_bind_int64(st, 2, c.hi);
+    c.rowids.reserve(c.expect);
+    int rc;
+    switch (c.table) {
+    case LT_STUDENTS:
+        c.students.reserve(c.expect);
+        while ((rc = sqlite3_step(st)) == SQLITE_ROW) {
+            c.students.emplace_back();
+            Student& s = c.students.back();
+            if (!column_roll(st, 0, s.roll_no)) { c.students.pop_back(); continue; }
+            column_assign(st, 1, s.name);
+            column_assign(st, 2, s.address);
+            column_assign(st, 3, s.contact);
+            c.rowids.push_back(sqlite3_column_int64(st, 4));
         }
-        sqlite3_finalize(st);
+        break;
+    case LT_COURSES:
+        c.courses.reserve(c.expect);
+        while ((rc = sqlite3_step(st)) == SQLITE_ROW) {
+            c.courses.emplace_back();
+            Course& co = c.courses.back();
+            if (!column_course(st, 0, co.code)) { c.courses.pop_back(); continue; }
+            column_assign(st, 1, co.title);
+            column_assign(st, 2, co.description);
+            column_assign(st, 3, co.teacher);
+            c.rowids.push_back(sqlite3_column_int64(st, 4));
+        }
+        break;
+    default:
+        c.grades.reserve(c.expect);
+        while ((rc = sqlite3_step(st)) == SQLITE_ROW) {
+            RollId roll;
+            CourseId code;
+            if (!column_roll(st, 0, roll) || !column_course(st, 1, code)) continue;
+            c.grades.roll_no.push_back(roll);
+            c.grades.course_code.push_back(code);
+            c.grades.internal_mark.push_back(sqlite3_column_double(st, 2));
+            c.grades.final_mark.push_back(sqlite3_column_double(st, 3));
+            c.rowids.push_back(sqlite3_column_int64(st, 4));
+        }
+        break;
+    }
+    sqlite3_finalize(st);
+    c.ok = rc == SQLITE_DONE;
+    return c.ok;
+}
+
+// Move `from` onto the end of `to`; the first piece is taken over whole.
+template <class T>
+static void append_moved(std::vector<T>& to, std::vector<T>& from) {
+    if (to.empty() && to.capacity() < from.size()) { to.swap(from); return; }
+    to.insert(to.end(), std::make_move_iterator(from.begin()), std::make_move_iterator(from.end()));
+    std::vector<T>().swap(from);
+}
+
+// Load full tables into the in-memory DataStore (used by the UI/reporting).
+// Clears the store first to avoid duplicates and rebuilds its indexes at the end.
+//
+// Row counts and rowid bounds are read first so every vector is sized once.
+// Big tables are cut into rowid ranges; when the database is a file, the
+// machine has spare cores and nothing is pending on `db`, the ranges are
+// read concurrently by extra read-only connections (plus `db` itself).
+// Each reader checks that it sees the same change-log head as `db`; if a
+// writer slipped in between, the parallel result is discarded and the
+// ranges are re-read on `db` alone.
+bool db_load_all(sqlite3* db, DataStore& store, DbLoadReport* report) {
+    using Clock = std::chrono::steady_clock;
+    auto ms_since = [](Clock::time_point t) {
+        return std::chrono::duration<double, std::milli>(Clock::now() - t).count();
+    };
+    const auto t_start = Clock::now();
+    DbLoadReport rep;
+    store_clear(store);
+
+    // If this store is the one kept in sync, restart its rowid -> key maps.
+    SyncState* sync = sync_state(db);
+    if (sync && sync->store != &store) sync = nullptr;
+    if (sync) {
+        sync->student_key.clear();
+        sync->course_key.clear();
+        sync->grade_key.clear();
+        for (auto& d : sync->dirty) d.clear();
+        sync->ready = false;
+        sync->hook_rows = 0;
     }
 
-    // --- load grades --------------------------------------------------------
+    // One read transaction, so the three tables (and the change-log head)
+    // come from the same database state.
+    const bool own_txn = sqlite3_get_autocommit(db) != 0;
+    if (own_txn) exec_sql(db, "BEGIN;");
+    struct EndTxn {
+        sqlite3* db; bool own;
+        ~EndTxn() { if (own) exec_sql(db, "COMMIT;"); }
+    } end_txn{ db, own_txn };
+
+    // --- size the tables ----------------------------------------------------
+    auto t = Clock::now();
+    const sqlite3_int64 head = log_head(db);
+    sqlite3_int64 rows[LT_COUNT_] = {}, lo[LT_COUNT_] = {}, hi[LT_COUNT_] = {};
     {
         sqlite3_stmt* st = nullptr;
-        if (sqlite3_prepare_v2(db, "SELECT roll_no,course_code,internal_mark,final_mark FROM grades;", -1, &st, nullptr) != SQLITE_OK)
-            return false;
-        while (sqlite3_step(st) == SQLITE_ROW) {
-            Grade g;
-            g.roll_no = reinterpret_cast<const char*>(sqlite3_column_text(st, 0));
-            g.course_code = reinterpret_cast<const char*>(sqlite3_column_text(st, 1));
-            g.internal_mark = sqlite3_column_double(st, 2);
-            g.final_mark = sqlite3_column_double(st, 3);
-            store.all_grades.push_back(g);
+        if (sqlite3_prepare_v2(db, LOAD_SIZE_SQL, -1, &st, nullptr) != SQLITE_OK) return false;
+        if (sqlite3_step(st) == SQLITE_ROW) {
+            for (int i = 0; i < LT_COUNT_; ++i) {
+                rows[i] = sqlite3_column_int64(st, 3 * i);
+                lo[i] = sqlite3_column_int64(st, 3 * i + 1);
+                hi[i] = sqlite3_column_int64(st, 3 * i + 2);
+            }
         }
         sqlite3_finalize(st);
     }
+    const size_t total_rows = static_cast<size_t>(rows[LT_STUDENTS] + rows[LT_COURSES] + rows[LT_GRADES]);
 
+    const char* path = sqlite3_db_filename(db, "main");
+    const unsigned cores = std::thread::hardware_concurrency();
+    unsigned readers = 1;
+    if (own_txn && head >= 0 && path && *path && cores > 1 && total_rows >= LOAD_PARALLEL_MIN_ROWS)
+        readers = std::min(cores, LOAD_MAX_READERS);
+
+    // Cut each non-empty table into equal rowid ranges.
+    std::vector<LoadChunk> chunks;
+    for (int tb = 0; tb < LT_COUNT_; ++tb) {
+        if (rows[tb] == 0) continue;
+        const size_t n = static_cast<size_t>(rows[tb]);
+        const size_t pieces = std::max<size_t>(1, std::min<size_t>(readers, n / LOAD_CHUNK_MIN_ROWS));
+        const std::uint64_t span = static_cast<std::uint64_t>(hi[tb]) - static_cast<std::uint64_t>(lo[tb]);
+        const std::uint64_t step = span / pieces + 1;
+        for (size_t p = 0; p < pieces; ++p) {
+            LoadChunk c;
+            c.table = static_cast<LoadTable>(tb);
+            c.lo = static_cast<sqlite3_int64>(static_cast<std::uint64_t>(lo[tb]) + p * step);
+            c.hi = p + 1 == pieces ? hi[tb] : static_cast<sqlite3_int64>(static_cast<std::uint64_t>(c.lo) + step - 1);
+            c.expect = pieces == 1 ? n : n / pieces + n / (8 * pieces);
+            chunks.push_back(std::move(c));
+        }
+    }
+    readers = static_cast<unsigned>(std::min<size_t>(readers, chunks.size()));
+    rep.count_ms = ms_since(t);
+
+    // --- read ---------------------------------------------------------------
+    t = Clock::now();
+    bool parallel_ok = readers > 1;
+    if (parallel_ok) {
+        std::atomic<size_t> next{ 0 };
+        std::atomic<bool> failed{ false };
+        auto drain = [&](sqlite3* conn) {
+            for (size_t i; !failed && (i = next++) < chunks.size();)
+                if (!load_chunk(conn, chunks[i])) failed = true;
+        };
+        std::vector<std::thread> pool;
+        for (unsigned r = 1; r < readers; ++r) {
+            pool.emplace_back([&, path] {
+                sqlite3* rdb = nullptr;
+                bool ok = sqlite3_open_v2(path, &rdb, SQLITE_OPEN_READONLY | SQLITE_OPEN_NOMUTEX, nullptr) == SQLITE_OK;
+                if (ok) {
+                    sqlite3_busy_timeout(rdb, 2000);
+                    // The head query is the first read, so it pins this
+                    // connection's snapshot for the chunks that follow.
+                    sqlite3_stmt* st = nullptr;
+                    ok = sqlite3_exec(rdb, "BEGIN;", nullptr, nullptr, nullptr) == SQLITE_OK &&
+                        sqlite3_prepare_v2(rdb, STMT_SQL[ST_LOG_HEAD], -1, &st, nullptr) == SQLITE_OK &&
+                        sqlite3_step(st) == SQLITE_ROW && sqlite3_column_int64(st, 0) == head;
+                    sqlite3_finalize(st);
+                }
+                if (ok) drain(rdb);
+                else failed = true;
+                sqlite3_exec(rdb, "COMMIT;", nullptr, nullptr, nullptr);
+                sqlite3_close(rdb);
+            });
+        }
+        drain(db);
+        for (auto& th : pool) th.join();
+        parallel_ok = !failed;
+    }
+    if (!parallel_ok) {
+        // Single connection (or the parallel attempt was inconsistent/failed).
+        readers = 1;
+        for (LoadChunk& c : chunks) {
+            LoadChunk fresh;
+            fresh.table = c.table; fresh.lo = c.lo; fresh.hi = c.hi; fresh.expect = c.expect;
+            c = std::move(fresh);
+            if (!load_chunk(db, c)) return false;
+        }
+    }
+    rep.readers = static_cast<int>(readers);
+    rep.read_ms = ms_since(t);
+
+    // --- stitch the ranges together (rowid order, as a plain scan) -----------
+    t = Clock::now();
+    size_t got[LT_COUNT_] = {};
+    for (const LoadChunk& c : chunks) got[c.table] += c.rowids.size();
+    store.all_students.reserve(got[LT_STUDENTS]);
+    store.all_courses.reserve(got[LT_COURSES]);
+    store.all_grades.reserve(got[LT_GRADES]);
+    if (sync) {
+        sync->student_key.reserve(got[LT_STUDENTS]);
+        sync->course_key.reserve(got[LT_COURSES]);
+        sync->grade_key.reserve(got[LT_GRADES]);
+    }
+    for (LoadChunk& c : chunks) {
+        if (sync) {
+            for (size_t i = 0; i < c.rowids.size(); ++i) {
+                if (c.table == LT_STUDENTS) sync->student_key.insert(c.rowids[i], c.students[i].roll_no);
+                else if (c.table == LT_COURSES) sync->course_key.insert(c.rowids[i], c.courses[i].code);
+                else sync->grade_key.insert(c.rowids[i], enrollment_key(c.grades.roll_no[i], c.grades.course_code[i]));
+            }
+        }
+        switch (c.table) {
+        case LT_STUDENTS: append_moved(store.all_students, c.students); break;
+        case LT_COURSES: append_moved(store.all_courses, c.courses); break;
+        default:
+            append_moved(store.all_grades.roll_no, c.grades.roll_no);
+            append_moved(store.all_grades.course_code, c.grades.course_code);
+            append_moved(store.all_grades.internal_mark, c.grades.internal_mark);
+            append_moved(store.all_grades.final_mark, c.grades.final_mark);
+            break;
+        }
+        std::vector<std::int64_t>().swap(c.rowids);
+    }
+    rep.merge_ms = ms_since(t);
+
+    t = Clock::now();
+    if (sync) sync->log_seq = std::max<sqlite3_int64>(head, 0);
+    store_rebuild_indexes(store);
+    rep.index_ms = ms_since(t);
+
+    rep.source = "database";
+    rep.ms = ms_since(t_start);
+    if (report) *report = rep;
     return true;
 }
 
@@ -197,154 +1469,768 @@ bool db_load_all(sqlite3* db, DataStore& store) {
 
    // INSERT student row.
 bool db_add_student(sqlite3* db, const Student& s) {
-    const char* sql = "INSERT INTO students(roll_no,name,address,contact) VALUES(?,?,?,?);";
-    sqlite3_stmt* st = nullptr;
-    if (sqlite3_prepare_v2(db, sql, -1, &st, nullptr) != SQLITE_OK) return false;
-    sqlite3_bind_text(st, 1, s.roll_no.c_str(), -1, SQLITE_TRANSIENT);
-    sqlite3_bind_text(st, 2, s.name.c_str(), -1, SQLITE_TRANSIENT);
-    sqlite3_bind_text(st, 3, s.address.c_str(), -1, SQLITE_TRANSIENT);
-    sqlite3_bind_text(st, 4, s.contact.c_str(), -1, SQLITE_TRANSIENT);
-    int rc = sqlite3_step(st);
-    sqlite3_finalize(st);
-    return rc == SQLITE_DONE;
+    StmtLease st(db, ST_ADD_STUDENT);
+    if (!st) return false;
+    bind_roll(st.get(), 1, s.roll_no);
+    bind_str(st.get(), 2, s.name);
+    bind_str(st.get(), 3, s.address);
+    bind_str(st.get(), 4, s.contact);
+    return sqlite3_step(st.get()) == SQLITE_DONE;
 }
 
 // INSERT course row.
 bool db_add_course(sqlite3* db, const Course& c) {
-    const char* sql = "INSERT INTO courses(code,title,description,teacher) VALUES(?,?,?,?);";
-    sqlite3_stmt* st = nullptr;
-    if (sqlite3_prepare_v2(db, sql, -1, &st, nullptr) != SQLITE_OK) return false;
-    sqlite3_bind_text(st, 1, c.code.c_str(), -1, SQLITE_TRANSIENT);
-    sqlite3_bind_text(st, 2, c.title.c_str(), -1, SQLITE_TRANSIENT);
-    sqlite3_bind_text(st, 3, c.description.c_str(), -1, SQLITE_TRANSIENT);
-    sqlite3_bind_text(st, 4, c.teacher.c_str(), -1, SQLITE_TRANSIENT);
-    int rc = sqlite3_step(st);
-    sqlite3_finalize(st);
-    return rc == SQLITE_DONE;
+    StmtLease st(db, ST_ADD_COURSE);
+    if (!st) return false;
+    bind_course(st.get(), 1, c.code);
+    bind_str(st.get(), 2, c.title);
+    bind_str(st.get(), 3, c.description);
+    bind_str(st.get(), 4, c.teacher);
+    return sqlite3_step(st.get()) == SQLITE_DONE;
 }
 
 // ENROLL: create a grades row with default marks for (roll_no, course_code).
-bool db_enroll(sqlite3* db, const std::string& roll_no, const std::string& course_code) {
-    const char* sql = "INSERT INTO grades(roll_no,course_code,internal_mark,final_mark) VALUES(?,?,0,0);";
-    sqlite3_stmt* st = nullptr;
-    if (sqlite3_prepare_v2(db, sql, -1, &st, nullptr) != SQLITE_OK) return false;
-    sqlite3_bind_text(st, 1, roll_no.c_str(), -1, SQLITE_TRANSIENT);
-    sqlite3_bind_text(st, 2, course_code.c_str(), -1, SQLITE_TRANSIENT);
-    int rc = sqlite3_step(st);
-    sqlite3_finalize(st);
-    return rc == SQLITE_DONE;
+bool db_enroll(sqlite3* db, RollId roll_no, CourseId course_code) {
+    StmtLease st(db, ST_ENROLL);
+    if (!st) return false;
+    bind_roll(st.get(), 1, roll_no);
+    bind_course(st.get(), 2, course_code);
+    return sqlite3_step(st.get()) == SQLITE_DONE;
 }
 
 // UPDATE marks for an existing enrollment. Returns false if no row was updated.
-bool db_enter_marks(sqlite3* db, const std::string& roll_no, const std::string& course_code,
+bool db_enter_marks(sqlite3* db, RollId roll_no, CourseId course_code,
     double internal_mark, double final_mark) {
-    const char* sql = "UPDATE grades SET internal_mark=?, final_mark=? WHERE roll_no=? AND course_code=?;";
-    sqlite3_stmt* st = nullptr;
-    if (sqlite3_prepare_v2(db, sql, -1, &st, nullptr) != SQLITE_OK) return false;
-    sqlite3_bind_double(st, 1, internal_mark);
-    sqlite3_bind_double(st, 2, final_mark);
-    sqlite3_bind_text(st, 3, roll_no.c_str(), -1, SQLITE_TRANSIENT);
-    sqlite3_bind_text(st, 4, course_code.c_str(), -1, SQLITE_TRANSIENT);
-    int rc = sqlite3_step(st);
-    bool ok = (rc == SQLITE_DONE) && (sqlite3_changes(db) > 0);
-    sqlite3_finalize(st);
-    return ok;
+    StmtLease st(db, ST_ENTER_MARKS);
+    if (!st) return false;
+    sqlite3_bind_double(st.get(), 1, internal_mark);
+    sqlite3_bind_double(st.get(), 2, final_mark);
+    bind_roll(st.get(), 3, roll_no);
+    bind_course(st.get(), 4, course_code);
+    int rc = sqlite3_step(st.get());
+    return (rc == SQLITE_DONE) && (sqlite3_changes(db) > 0);
 }
 
 // Edit helpers ---------------------------------------------------------------
 
 // UPDATE student fields by roll_no.
 bool db_update_student(sqlite3* db, const Student& s) {
-    const char* sql =
-        "UPDATE students SET name=?, address=?, contact=? WHERE roll_no=?;";
-    sqlite3_stmt* st = nullptr;
-    if (sqlite3_prepare_v2(db, sql, -1, &st, nullptr) != SQLITE_OK) return false;
-    sqlite3_bind_text(st, 1, s.name.c_str(), -1, SQLITE_TRANSIENT);
-    sqlite3_bind_text(st, 2, s.address.c_str(), -1, SQLITE_TRANSIENT);
-    sqlite3_bind_text(st, 3, s.contact.c_str(), -1, SQLITE_TRANSIENT);
-    sqlite3_bind_text(st, 4, s.roll_no.c_str(), -1, SQLITE_TRANSIENT);
-    int rc = sqlite3_step(st);
-    bool ok = (rc == SQLITE_DONE && sqlite3_changes(db) > 0);
-    sqlite3_finalize(st);
-    return ok;
+    StmtLease st(db, ST_UPDATE_STUDENT);
+    if (!st) return false;
+    bind_str(st.get(), 1, s.name);
+    bind_str(st.get(), 2, s.address);
+    bind_str(st.get(), 3, s.contact);
+    bind_roll(st.get(), 4, s.roll_no);
+    int rc = sqlite3_step(st.get());
+    return (rc == SQLITE_DONE && sqlite3_changes(db) > 0);
 }
 
 // UPDATE course fields by code.
 bool db_update_course(sqlite3* db, const Course& c) {
-    const char* sql =
-        "UPDATE courses SET title=?, description=?, teacher=? WHERE code=?;";
-    sqlite3_stmt* st = nullptr;
-    if (sqlite3_prepare_v2(db, sql, -1, &st, nullptr) != SQLITE_OK) return false;
-    sqlite3_bind_text(st, 1, c.title.c_str(), -1, SQLITE_TRANSIENT);
-    sqlite3_bind_text(st, 2, c.description.c_str(), -1, SQLITE_TRANSIENT);
-    sqlite3_bind_text(st, 3, c.teacher.c_str(), -1, SQLITE_TRANSIENT);
-    sqlite3_bind_text(st, 4, c.code.c_str(), -1, SQLITE_TRANSIENT);
-    int rc = sqlite3_step(st);
-    bool ok = (rc == SQLITE_DONE && sqlite3_changes(db) > 0);
-    sqlite3_finalize(st);
-    return ok;
+    StmtLease st(db, ST_UPDATE_COURSE);
+    if (!st) return false;
+    bind_str(st.get(), 1, c.title);
+    bind_str(st.get(), 2, c.description);
+    bind_str(st.get(), 3, c.teacher);
+    bind_course(st.get(), 4, c.code);
+    int rc = sqlite3_step(st.get());
+    return (rc == SQLITE_DONE && sqlite3_changes(db) > 0);
 }
 
 // Delete helpers -------------------------------------------------------------
 
 // Delete a student by roll; cascades remove their grade rows.
-bool db_delete_student(sqlite3* db, const std::string& roll) {
-    const char* sql = "DELETE FROM students WHERE roll_no=?;";
-    sqlite3_stmt* st = nullptr;
-    if (sqlite3_prepare_v2(db, sql, -1, &st, nullptr) != SQLITE_OK) return false;
-    sqlite3_bind_text(st, 1, roll.c_str(), -1, SQLITE_TRANSIENT);
-    int rc = sqlite3_step(st);
-    bool ok = (rc == SQLITE_DONE && sqlite3_changes(db) > 0);
-    sqlite3_finalize(st);
-    return ok; // cascades will delete grades for this student
+bool db_delete_student(sqlite3* db, RollId roll) {
+    StmtLease st(db, ST_DELETE_STUDENT);
+    if (!st) return false;
+    bind_roll(st.get(), 1, roll);
+    int rc = sqlite3_step(st.get());
+    return (rc == SQLITE_DONE && sqlite3_changes(db) > 0); // cascades will delete grades for this student
 }
 
 // Delete a course by code; cascades remove its grade rows.
-bool db_delete_course(sqlite3* db, const std::string& code) {
-    const char* sql = "DELETE FROM courses WHERE code=?;";
-    sqlite3_stmt* st = nullptr;
-    if (sqlite3_prepare_v2(db, sql, -1, &st, nullptr) != SQLITE_OK) return false;
-    sqlite3_bind_text(st, 1, code.c_str(), -1, SQLITE_TRANSIENT);
-    int rc = sqlite3_step(st);
-    bool ok = (rc == SQLITE_DONE && sqlite3_changes(db) > 0);
-    sqlite3_finalize(st);
-    return ok; // cascades will delete grades for this course
+bool db_delete_course(sqlite3* db, CourseId code) {
+    StmtLease st(db, ST_DELETE_COURSE);
+    if (!st) return false;
+    bind_course(st.get(), 1, code);
+    int rc = sqlite3_step(st.get());
+    return (rc == SQLITE_DONE && sqlite3_changes(db) > 0); // cascades will delete grades for this course
 }
 
 // Delete a single enrollment (grade row) by composite key.
-bool db_delete_enrollment(sqlite3* db, const std::string& roll, const std::string& code) {
-    const char* sql = "DELETE FROM grades WHERE roll_no=? AND course_code=?;";
+bool db_delete_enrollment(sqlite3* db, RollId roll, CourseId code) {
+    StmtLease st(db, ST_DELETE_ENROLLMENT);
+    if (!st) return false;
+    bind_roll(st.get(), 1, roll);
+    bind_course(st.get(), 2, code);
+    int rc = sqlite3_step(st.get());
+    return (rc == SQLITE_DONE && sqlite3_changes(db) > 0);
+}
+
+/* =========================
+   Transactions and batches
+   ========================= */
+
+bool db_begin(sqlite3* db) {
+    StmtLease st(db, ST_BEGIN);
+    return st && sqlite3_step(st.get()) == SQLITE_DONE;
+}
+
+bool db_commit(sqlite3* db) {
+    StmtLease st(db, ST_COMMIT);
+    return st && sqlite3_step(st.get()) == SQLITE_DONE;
+}
+
+void db_rollback(sqlite3* db) {
+    if (sqlite3_get_autocommit(db)) return;   // nothing open (or already rolled back)
+    StmtLease st(db, ST_ROLLBACK);
+    if (st) sqlite3_step(st.get());
+}
+
+// A failed row is "fatal" when the error is about the connection or file
+// rather than the row's data (I/O, disk full, lock, corruption). Constraint
+// violations and "no row matched" only fail that row.
+static bool is_fatal_error(sqlite3* db) {
+    switch (sqlite3_errcode(db) & 0xff) {
+    case SQLITE_OK: case SQLITE_DONE: case SQLITE_ROW:
+    case SQLITE_CONSTRAINT: case SQLITE_MISMATCH: case SQLITE_TOOBIG:
+        return false;
+    default:
+        return true;
+    }
+}
+
+// A large batch into one table runs with triggers switched off on this
+// connection (SQLITE_DBCONFIG_ENABLE_TRIGGER) and then runs the catch-up
+// statements of that table's INSERT_ACTIONS once. FTS5 flushes its pending
+// index at every statement savepoint, so the students_fts insert alone
+// writes one index segment per inserted row (about 4/5 of a bulk student
+// insert); the rest is a trigger call per row. The switch is a setting of
+// this connection, not DDL: the schema is untouched, other connections keep
+// their prepared statements and never see the triggers off. Only this
+// connection re-prepares, once, on the next step of each statement.
+// Batches smaller than this keep the trigger: the catch-ups are a handful
+// of statements of their own.
+static const size_t DEFER_TRIGGERS_MIN_ROWS = 256;
+
+// Triggers off on `db` for the guard's lifetime (or until resume()), so
+// every early return of a batch switches them back on.
+class TriggerPause {
+public:
+    explicit TriggerPause(sqlite3* db) : db_(db) { sqlite3_db_config(db_, SQLITE_DBCONFIG_ENABLE_TRIGGER, 0, nullptr); }
+    ~TriggerPause() { resume(); }
+    TriggerPause(const TriggerPause&) = delete;
+    TriggerPause& operator=(const TriggerPause&) = delete;
+    void resume() {
+        if (db_) sqlite3_db_config(db_, SQLITE_DBCONFIG_ENABLE_TRIGGER, 1, nullptr);
+        db_ = nullptr;
+    }
+private:
+    sqlite3* db_;
+};
+
+static std::string max_rowid_sql(const char* table) {
+    return std::string("SELECT COALESCE(MAX(rowid), 0) FROM ") + table + ";";
+}
+
+// Largest rowid of `table`; every row the batch adds gets a larger one.
+static bool max_rowid(sqlite3* db, const char* table, sqlite3_int64& out) {
     sqlite3_stmt* st = nullptr;
-    if (sqlite3_prepare_v2(db, sql, -1, &st, nullptr) != SQLITE_OK) return false;
-    sqlite3_bind_text(st, 1, roll.c_str(), -1, SQLITE_TRANSIENT);
-    sqlite3_bind_text(st, 2, code.c_str(), -1, SQLITE_TRANSIENT);
-    int rc = sqlite3_step(st);
-    bool ok = (rc == SQLITE_DONE && sqlite3_changes(db) > 0);
+    const std::string sql = max_rowid_sql(table);
+    if (sqlite3_prepare_v2(db, sql.c_str(), -1, &st, nullptr) != SQLITE_OK) return false;
+    const bool ok = sqlite3_step(st) == SQLITE_ROW;
+    if (ok) out = sqlite3_column_int64(st, 0);
     sqlite3_finalize(st);
     return ok;
 }
 
-// Quick counts for live dashboard/menu. One round-trip using scalar subqueries.
-bool db_get_counts(sqlite3* db, DbCounts& out) {
-    static const char* SQL =
-        "SELECT "
-        " (SELECT COUNT(*) FROM students) AS s, "
-        " (SELECT COUNT(*) FROM courses)  AS c, "
-        " (SELECT COUNT(*) FROM grades)   AS g;";
+// Do for every row of `table` above `after` what its trigger would have.
+static bool catch_up_inserts(sqlite3* db, const char* table, sqlite3_int64 after) {
+    for (const InsertAction& a : INSERT_ACTIONS) {
+        if (!a.catch_up || std::strcmp(a.table, table) != 0) continue;
+        sqlite3_stmt* st = nullptr;
+        if (sqlite3_prepare_v2(db, insert_catch_up_sql(a).c_str(), -1, &st, nullptr) != SQLITE_OK) return false;
+        sqlite3_bind_int64(st, 1, after);
+        const int rc = sqlite3_step(st);
+        sqlite3_finalize(st);
+        if (rc != SQLITE_DONE) return false;
+    }
+    return true;
+}
 
-    sqlite3_stmt* st = nullptr;
-    if (sqlite3_prepare_v2(db, SQL, -1, &st, nullptr) != SQLITE_OK) {
+// Shared driver for the db_*_many functions: opens a transaction unless the
+// caller already has one, writes each row with `write_row`, records per-row
+// results, and commits. On a fatal error everything is rolled back. When
+// the batch owns its transaction and is large, the INSERT_ACTIONS of
+// `table` are replaced by their set-based catch-up statements.
+template <class Row, class WriteRow>
+static bool run_batch(sqlite3* db, const std::vector<Row>& rows, BatchResult& out,
+    WriteRow write_row, const char* table = nullptr) {
+    out.row_ok.assign(rows.size(), false);
+    out.succeeded = out.failed = 0;
+
+    const bool own_txn = sqlite3_get_autocommit(db) != 0;
+    if (own_txn && !db_begin(db)) return false;
+
+    sqlite3_int64 before = 0;
+    const bool defer = own_txn && table && rows.size() >= DEFER_TRIGGERS_MIN_ROWS;
+    if (defer && !max_rowid(db, table, before)) {
+        std::cerr << "Batch setup failed: " << sqlite3_errmsg(db) << "\n";
+        db_rollback(db);
+        out.failed = static_cast<int>(rows.size());
+        return false;
+    }
+    std::optional<TriggerPause> paused;
+    if (defer) paused.emplace(db);
+
+    for (size_t i = 0; i < rows.size(); ++i) {
+        if (write_row(rows[i])) {
+            out.row_ok[i] = true;
+            ++out.succeeded;
+        }
+        else if (is_fatal_error(db)) {
+            std::cerr << "Batch aborted at row " << i << ": " << sqlite3_errmsg(db) << "\n";
+            if (own_txn) db_rollback(db);
+            out.row_ok.assign(rows.size(), false);
+            out.succeeded = 0;
+            out.failed = static_cast<int>(rows.size());
+            return false;
+        }
+    }
+
+    if (paused) paused->resume();
+    if (defer && !catch_up_inserts(db, table, before)) {
+        std::cerr << "Batch trigger catch-up failed: " << sqlite3_errmsg(db) << "\n";
+        db_rollback(db);
+        out.row_ok.assign(rows.size(), false);
+        out.succeeded = 0;
+        out.failed = static_cast<int>(rows.size());
+        return false;
+    }
+
+    if (own_txn && !db_commit(db)) {
+        std::cerr << "Batch commit failed: " << sqlite3_errmsg(db) << "\n";
+        db_rollback(db);
+        out.row_ok.assign(rows.size(), false);
+        out.succeeded = 0;
+        out.failed = static_cast<int>(rows.size());
         return false;
     }
+    out.failed = static_cast<int>(rows.size()) - out.succeeded;
+    return true;
+}
+
+bool db_add_students(sqlite3* db, const std::vector<Student>& rows, BatchResult& out) {
+    return run_batch(db, rows, out, [&](const Student& s) { return db_add_student(db, s); },
+        "students");
+}
+
+bool db_add_courses(sqlite3* db, const std::vector<Course>& rows, BatchResult& out) {
+    return run_batch(db, rows, out, [&](const Course& c) { return db_add_course(db, c); },
+        "courses");
+}
+
+bool db_enroll_many(sqlite3* db,
+    const std::vector<std::pair<RollId, CourseId>>& pairs, BatchResult& out) {
+    return run_batch(db, pairs, out, [&](const std::pair<RollId, CourseId>& p) {
+        return db_enroll(db, p.first, p.second);
+        }, "grades");
+}
+
+bool db_enter_marks_many(sqlite3* db, const std::vector<Grade>& rows, BatchResult& out) {
+    return run_batch(db, rows, out, [&](const Grade& g) {
+        return db_enter_marks(db, g.roll_no, g.course_code, g.internal_mark, g.final_mark);
+        });
+}
+
+// Quick counts for live dashboard/menu: one primary-key lookup in sms_counts.
+bool db_get_counts(sqlite3* db, DbCounts& out) {
+    StmtLease st(db, ST_GET_COUNTS);
+    if (!st) return false;
 
     bool ok = false;
-    if (sqlite3_step(st) == SQLITE_ROW) {
-        out.students = sqlite3_column_int(st, 0);
-        out.courses = sqlite3_column_int(st, 1);
-        out.enrolments = sqlite3_column_int(st, 2);
+    if (sqlite3_step(st.get()) == SQLITE_ROW) {
+        out.students = sqlite3_column_int(st.get(), 0);
+        out.courses = sqlite3_column_int(st.get(), 1);
+        out.enrolments = sqlite3_column_int(st.get(), 2);
         ok = true;
     }
+    return ok;
+}
+
+/* =========================
+   Write-behind writer
+   ========================= */
+
+// One thread with its own connection commits queued writes in batches so
+// the caller never waits for sqlite3_step or fsync. Commands arrive through
+// a lock-free MPSC queue; the writer takes everything queued (up to
+// DbWriterOptions::max_batch), runs it in one BEGIN IMMEDIATE ... COMMIT,
+// then settles each command's promise. A flush is a command with no op: its
+// promise is settled with the batch it lands in, i.e. after everything
+// queued before it has committed.
+//
+// Group commit: with a window set, the writer holds a batch open for up to
+// that long after its first command, collecting what concurrent callers
+// queue meanwhile, so N callers share one transaction and one sync. A full
+// batch, a flush barrier or shutdown closes the window early.
+//
+// Only the writer thread touches its connection, and it never touches the
+// DataStore: callers update the cache themselves before queueing. The sync
+// layer of the main connection still learns each new row's rowid from the
+// change log when it next catches up (sync_catch_up drains the queue first).
+
+struct WriteCmd {
+    std::function<bool(sqlite3*)> op;   // empty = flush barrier
+    std::promise<bool> done;
+};
+
+struct DbWriter {
+    sqlite3* conn = nullptr;
+    MpscQueue<WriteCmd> queue;
+    std::atomic<size_t> pending{ 0 };   // queued and not yet settled
+    std::atomic<int> failures{ 0 };     // failed since the last reconcile
+    std::atomic<bool> sleeping{ false };
+    std::atomic<bool> stopping{ false };
+    DbWriterOptions opt;
+    std::mutex m;                       // only for sleeping/waking
+    std::condition_variable wake;
+    std::thread thread;
+};
+
+static const char* WRITER_KEY = "pspschool.writer";
+
+static DbWriter* writer_of(sqlite3* db) {
+    return db ? static_cast<DbWriter*>(sqlite3_get_clientdata(db, WRITER_KEY)) : nullptr;
+}
+
+// Run one batch in one transaction. An op that fails on its own data only
+// fails itself; a fatal error (I/O, lock, full disk) or a failed COMMIT
+// rolls back and fails the whole batch.
+static void writer_run_batch(DbWriter& w, std::vector<WriteCmd>& batch) {
+    std::vector<char> ok(batch.size(), 1);
+    bool all_failed = !db_begin(w.conn);
+    for (size_t i = 0; i < batch.size() && !all_failed; ++i) {
+        if (!batch[i].op || batch[i].op(w.conn)) continue;
+        ok[i] = 0;
+        if (is_fatal_error(w.conn)) all_failed = true;
+    }
+    if (!all_failed && !db_commit(w.conn)) all_failed = true;
+    if (all_failed) {
+        std::cerr << "Background write failed: " << sqlite3_errmsg(w.conn) << "\n";
+        db_rollback(w.conn);
+        ok.assign(batch.size(), 0);
+    }
+    // Counters first: whoever a promise wakes must already see them.
+    for (size_t i = 0; i < batch.size(); ++i)
+        if (!ok[i] && batch[i].op) w.failures.fetch_add(1);
+    w.pending.fetch_sub(batch.size());
+    for (size_t i = 0; i < batch.size(); ++i) batch[i].done.set_value(ok[i] != 0);
+}
+
+// Move queued commands into `batch` up to the size limit. Returns true if
+// a flush barrier was among them (the batch should commit right away).
+static bool writer_take(DbWriter& w, std::vector<WriteCmd>& batch) {
+    bool barrier = false;
+    WriteCmd cmd;
+    while (batch.size() < w.opt.max_batch && w.queue.pop(cmd)) {
+        barrier = barrier || !cmd.op;
+        batch.push_back(std::move(cmd));
+    }
+    return barrier;
+}
+
+static void writer_loop(DbWriter* w) {
+    using Clock = std::chrono::steady_clock;
+    const auto window = std::chrono::microseconds(w->opt.group_window_us);
+    std::vector<WriteCmd> batch;
+    for (;;) {
+        bool barrier = writer_take(*w, batch);
+        if (!batch.empty()) {
+            // Group commit: keep collecting until the window closes.
+            const auto deadline = Clock::now() + window;
+            while (window.count() > 0 && !barrier && batch.size() < w->opt.max_batch &&
+                !w->stopping.load() && Clock::now() < deadline) {
+                if (w->pending.load() > batch.size()) {   // more queued than taken
+                    barrier = writer_take(*w, batch);
+                    if (w->pending.load() > batch.size()) std::this_thread::yield();   // push mid-flight
+                    continue;
+                }
+                std::unique_lock<std::mutex> lk(w->m);
+                w->sleeping.store(true);
+                if (w->pending.load() <= batch.size() && !w->stopping.load()) w->wake.wait_until(lk, deadline);
+                w->sleeping.store(false);
+            }
+            writer_run_batch(*w, batch);
+            batch.clear();
+            continue;
+        }
+        if (w->pending.load() > 0) { std::this_thread::yield(); continue; }   // a push is mid-flight
+        if (w->stopping.load()) return;
+        // Sleep until a producer sees `sleeping` and wakes us. Setting the
+        // flag before re-checking `pending` (both seq_cst) means a push
+        // either is seen here or sees the flag.
+        std::unique_lock<std::mutex> lk(w->m);
+        w->sleeping.store(true);
+        if (w->pending.load() == 0 && !w->stopping.load()) w->wake.wait(lk);
+        w->sleeping.store(false);
+    }
+}
+
+static void writer_wake(DbWriter& w) {
+    if (!w.sleeping.load()) return;
+    { std::lock_guard<std::mutex> lk(w.m); }   // the writer is inside wait() now
+    w.wake.notify_one();
+}
+
+static std::future<bool> writer_push(DbWriter& w, std::function<bool(sqlite3*)> op) {
+    WriteCmd cmd;
+    cmd.op = std::move(op);
+    std::future<bool> f = cmd.done.get_future();
+    w.pending.fetch_add(1);   // before the push, so the writer never sees it go negative
+    w.queue.push(std::move(cmd));
+    writer_wake(w);
+    return f;
+}
+
+static void writer_drain(sqlite3* db) {
+    DbWriter* w = writer_of(db);
+    if (w && !w->stopping.load() && w->pending.load() > 0) writer_push(*w, nullptr).wait();
+}
+
+static int writer_failures(sqlite3* db) {
+    const DbWriter* w = writer_of(db);
+    return w ? w->failures.load() : 0;
+}
+
+bool db_writer_start(sqlite3* db, const DbWriterOptions& options) {
+    if (!db || writer_of(db)) return writer_of(db) != nullptr;
+    const char* path = sqlite3_db_filename(db, "main");
+    if (!path || !*path) return false;   // in-memory DB: a second connection would see another database
+    DbProfile profile;
+    db_read_profile(db, profile);
+    auto* w = new DbWriter();
+    w->opt = options;
+    if (w->opt.max_batch == 0) w->opt.max_batch = 1;
+    if (!db_open(w->conn, path, profile)) { delete w; return false; }
+    w->thread = std::thread(writer_loop, w);
+    sqlite3_set_clientdata(db, WRITER_KEY, w, nullptr);   // db_writer_stop frees it
+    return true;
+}
+
+std::future<bool> db_write_async(sqlite3* db, std::function<bool(sqlite3*)> op) {
+    DbWriter* w = writer_of(db);
+    if (w && !w->stopping.load()) return writer_push(*w, std::move(op));
+    // No writer: write now, on the caller's connection.
+    std::promise<bool> p;
+    p.set_value(op ? op(db) : true);
+    return p.get_future();
+}
+
+bool db_enter_marks_grouped(sqlite3* db, RollId roll_no, CourseId course_code,
+    double internal_mark, double final_mark) {
+    return db_write_async(db, [=](sqlite3* w) {
+        return db_enter_marks(w, roll_no, course_code, internal_mark, final_mark);
+        }).get();
+}
+
+void db_writer_flush(sqlite3* db) {
+    writer_drain(db);
+}
+
+size_t db_writer_pending(sqlite3* db) {
+    const DbWriter* w = writer_of(db);
+    return w ? w->pending.load() : 0;
+}
+
+int db_writer_reconcile(sqlite3* db) {
+    DbWriter* w = writer_of(db);
+    if (!w || w->failures.load() == 0) return 0;
+    writer_drain(db);
+    const int failed = w->failures.exchange(0);
+    // The cache holds changes the database refused; take the database's word.
+    if (SyncState* s = sync_state(db)) db_load_all(db, *s->store);
+    return failed;
+}
+
+void db_writer_stop(sqlite3* db) {
+    DbWriter* w = writer_of(db);
+    if (!w) return;
+    w->stopping.store(true);
+    { std::lock_guard<std::mutex> lk(w->m); }
+    w->wake.notify_one();
+    w->thread.join();   // the loop exits only once the queue is empty
+    db_close(w->conn);
+    sqlite3_set_clientdata(db, WRITER_KEY, nullptr, nullptr);
+    delete w;
+}
+
+/* =========================
+   Reports (SQL pushdown)
+   ========================= */
+
+// Same text as student_report (services.hpp), computed by the database:
+// transcript rows stream from grades_student_marks in course-code order and
+// the header figures are summed over those same rows, so they always agree.
+bool db_student_report(sqlite3* db, RollId roll_no, std::ostream& out) {
+    if (!roll_no.valid()) { out << "Student not found.\n"; return true; }
+    {
+        StmtLease st(db, ST_REPORT_STUDENT);
+        if (!st) return false;
+        bind_roll(st.get(), 1, roll_no);
+        const int rc = sqlite3_step(st.get());
+        if (rc == SQLITE_DONE) { out << "Student not found.\n"; return true; }
+        if (rc != SQLITE_ROW) return false;
+        out << "Student: " << column_str(st.get(), 0) << " (" << roll_no << ")\n";
+    }
+
+    GradeAgg agg;
+    {
+        StmtLease st(db, ST_REPORT_STUDENT_ROWS);
+        if (!st) return false;
+        bind_roll(st.get(), 1, roll_no);
+        int rc;
+        while ((rc = sqlite3_step(st.get())) == SQLITE_ROW) {
+            Grade g;
+            if (!column_course(st.get(), 0, g.course_code)) continue;   // skipped by the loader too
+            g.internal_mark = sqlite3_column_double(st.get(), 2);
+            g.final_mark = sqlite3_column_double(st.get(), 3);
+            agg_add(agg, g.weighted());
+            out << " - ";
+            if (sqlite3_column_type(st.get(), 1) == SQLITE_NULL) out << g.course_code;
+            else out << column_str(st.get(), 1);
+            out << " | internal=" << g.internal_mark
+                << " final=" << g.final_mark
+                << " grade=" << g.weighted() << "\n";
+        }
+        if (rc != SQLITE_DONE) return false;
+    }
+
+    if (agg.count > 0) {
+        out << "Overall average: " << agg.average()
+            << " | Courses: " << agg.count
+            << " | Passed: " << agg.passed << "/" << agg.count << "\n";
+    }
+    else out << "No courses enrolled.\n";
+    return true;
+}
+
+// Same text as course_report (services.hpp): one aggregate over the
+// course's range of grades_course_rank.
+bool db_course_report(sqlite3* db, CourseId code, std::ostream& out) {
+    if (!code.valid()) { out << "Course not found.\n"; return true; }
+    {
+        StmtLease st(db, ST_REPORT_COURSE);
+        if (!st) return false;
+        bind_course(st.get(), 1, code);
+        const int rc = sqlite3_step(st.get());
+        if (rc == SQLITE_DONE) { out << "Course not found.\n"; return true; }
+        if (rc != SQLITE_ROW) return false;
+        out << "Course: " << column_str(st.get(), 0) << " (" << code << ") - " << column_str(st.get(), 1) << "\n";
+    }
+
+    StmtLease st(db, ST_REPORT_COURSE_AGG);
+    if (!st) return false;
+    bind_course(st.get(), 1, code);
+    sqlite3_bind_double(st.get(), 2, PASS_MARK);
+    if (sqlite3_step(st.get()) != SQLITE_ROW) return false;
+    const long long count = sqlite3_column_int64(st.get(), 0);
+    if (count == 0) { out << "No students enrolled.\n"; return true; }
+    out << "Enrolled: " << count
+        << " | Average: " << sqlite3_column_double(st.get(), 1) / static_cast<double>(count)
+        << " | Passed: " << sqlite3_column_int64(st.get(), 2) << "/" << count << "\n"
+        << "Lowest: " << sqlite3_column_double(st.get(), 3)
+        << " | Highest: " << sqlite3_column_double(st.get(), 4) << "\n";
+    return true;
+}
+
+bool db_grades_below(sqlite3* db, CourseId code, double below, std::vector<Grade>& out) {
+    out.clear();
+    StmtLease st(db, ST_GRADES_BELOW);
+    if (!st) return false;
+    bind_course(st.get(), 1, code);
+    sqlite3_bind_double(st.get(), 2, below);
+    int rc;
+    while ((rc = sqlite3_step(st.get())) == SQLITE_ROW) {
+        Grade g;
+        if (!column_roll(st.get(), 0, g.roll_no) || !column_course(st.get(), 1, g.course_code)) continue;
+        g.internal_mark = sqlite3_column_double(st.get(), 2);
+        g.final_mark = sqlite3_column_double(st.get(), 3);
+        out.push_back(g);
+    }
+    return rc == SQLITE_DONE;
+}
+
+bool db_course_top(sqlite3* db, CourseId code, int n, std::vector<Grade>& out) {
+    out.clear();
+    StmtLease st(db, ST_COURSE_TOP);
+    if (!st) return false;
+    bind_course(st.get(), 1, code);
+    sqlite3_bind_int(st.get(), 2, n);
+    int rc;
+    while ((rc = sqlite3_step(st.get())) == SQLITE_ROW) {
+        Grade g;
+        if (!column_roll(st.get(), 0, g.roll_no) || !column_course(st.get(), 1, g.course_code)) continue;
+        g.internal_mark = sqlite3_column_double(st.get(), 2);
+        g.final_mark = sqlite3_column_double(st.get(), 3);
+        out.push_back(g);
+    }
+    return rc == SQLITE_DONE;
+}
+
+bool db_first_grades(sqlite3* db, int n, std::vector<Grade>& out) {
+    out.clear();
+    StmtLease st(db, ST_FIRST_GRADES);
+    if (!st) return false;
+    sqlite3_bind_int(st.get(), 1, n);
+    int rc;
+    while ((rc = sqlite3_step(st.get())) == SQLITE_ROW) {
+        Grade g;
+        if (!column_roll(st.get(), 0, g.roll_no) || !column_course(st.get(), 1, g.course_code)) continue;
+        g.internal_mark = sqlite3_column_double(st.get(), 2);
+        g.final_mark = sqlite3_column_double(st.get(), 3);
+        out.push_back(g);
+    }
+    return rc == SQLITE_DONE;
+}
+
+/* =========================
+   Search (FTS5)
+   ========================= */
+
+// Turn free text into an FTS5 query: every word becomes a quoted prefix
+// term ("ava"* "main"*), all of which must match. Quoting keeps user input
+// from being read as FTS syntax (AND, NEAR, column filters, stray quotes).
+// Empty if the text has no word characters.
+static std::string fts_query(const std::string& text) {
+    std::string q, word;
+    auto flush = [&] {
+        if (word.empty()) return;
+        if (!q.empty()) q += ' ';
+        q += '"';
+        q += word;
+        q += "\"*";
+        word.clear();
+    };
+    for (char ch : text) {
+        const unsigned char u = static_cast<unsigned char>(ch);
+        // Same split as the unicode61 tokenizer for ASCII; bytes >= 0x80 are
+        // kept so accented names reach the tokenizer whole.
+        if (std::isalnum(u) || u >= 0x80) word += ch;
+        else flush();
+    }
+    flush();
+    return q;
+}
+
+bool db_search_students(sqlite3* db, const std::string& text, int limit, std::vector<Student>& out) {
+    out.clear();
+    const std::string q = fts_query(text);
+    if (q.empty()) return true;
+    StmtLease st(db, ST_SEARCH_STUDENTS);
+    if (!st) return false;
+    sqlite3_bind_text(st.get(), 1, q.c_str(), static_cast<int>(q.size()), SQLITE_TRANSIENT);
+    sqlite3_bind_int(st.get(), 2, limit);
+    int rc;
+    while ((rc = sqlite3_step(st.get())) == SQLITE_ROW) {
+        Student s;
+        if (!column_roll(st.get(), 0, s.roll_no)) continue;
+        column_assign(st.get(), 1, s.name);
+        column_assign(st.get(), 2, s.address);
+        column_assign(st.get(), 3, s.contact);
+        out.push_back(std::move(s));
+    }
+    return rc == SQLITE_DONE;
+}
+
+bool db_search_courses(sqlite3* db, const std::string& text, int limit, std::vector<Course>& out) {
+    out.clear();
+    const std::string q = fts_query(text);
+    if (q.empty()) return true;
+    StmtLease st(db, ST_SEARCH_COURSES);
+    if (!st) return false;
+    sqlite3_bind_text(st.get(), 1, q.c_str(), static_cast<int>(q.size()), SQLITE_TRANSIENT);
+    sqlite3_bind_int(st.get(), 2, limit);
+    int rc;
+    while ((rc = sqlite3_step(st.get())) == SQLITE_ROW) {
+        Course c;
+        if (!column_course(st.get(), 0, c.code)) continue;
+        column_assign(st.get(), 1, c.title);
+        column_assign(st.get(), 2, c.description);
+        column_assign(st.get(), 3, c.teacher);
+        out.push_back(std::move(c));
+    }
+    return rc == SQLITE_DONE;
+}
+
+/* =========================
+   Query-plan check
+   ========================= */
+
+// SQL the engine runs on our behalf that never appears as a string in this
+// file: the child-table deletes behind each ON DELETE CASCADE.
+static const char* const FK_CASCADE_SQL[] = {
+    "DELETE FROM grades WHERE roll_no=?;",       // db_delete_student
+    "DELETE FROM grades WHERE course_code=?;",   // db_delete_course
+};
+
+// EXPLAIN QUERY PLAN one statement; append a line per full scan of a table
+// not named in `allowed` (" t1 t2 ").
+static bool check_plan(sqlite3* db, const std::string& sql, const std::string& allowed,
+    std::vector<std::string>& problems) {
+    sqlite3_stmt* st = nullptr;
+    const std::string eqp = "EXPLAIN QUERY PLAN " + sql;
+    if (sqlite3_prepare_v2(db, eqp.c_str(), -1, &st, nullptr) != SQLITE_OK) {
+        problems.push_back("cannot prepare: " + sql + " (" + sqlite3_errmsg(db) + ")");
+        return false;
+    }
+    bool ok = true;
+    while (sqlite3_step(st) == SQLITE_ROW) {
+        const std::string detail = column_str(st, 3);
+        // "SCAN <table> [USING ...]"; "SCAN CONSTANT ROW" is a FROM-less SELECT.
+        if (detail.compare(0, 5, "SCAN ") != 0 || detail == "SCAN CONSTANT ROW") continue;
+        const std::string table = detail.substr(5, detail.find(' ', 5) - 5);
+        if (allowed.find(" " + table + " ") != std::string::npos) continue;
+        // Virtual tables always report SCAN; "VIRTUAL TABLE INDEX n:<idxStr>"
+        // with a non-empty idxStr means the module was handed a constraint
+        // (FTS5: M = MATCH) and does its own lookup.
+        const size_t vt = detail.find(" VIRTUAL TABLE INDEX ");
+        if (vt != std::string::npos) {
+            const size_t colon = detail.find(':', vt);
+            if (colon != std::string::npos && colon + 1 < detail.size()) continue;
+        }
+        problems.push_back("full scan: " + sql + "\n    " + detail);
+        ok = false;
+    }
     sqlite3_finalize(st);
     return ok;
 }
 
+// Every statement this file prepares, with the tables it may scan because
+// the scan is the point (count(*), the key-format pass), stops early
+// (EXISTS, LIMIT) or the table is tiny. The rest of the app prepares no SQL
+// of its own (`sms sql` runs the user's). Trigger bodies are not planned by
+// EXPLAIN; the INSERT ones are covered through their catch-up statements.
+bool db_check_query_plans(sqlite3* db, std::vector<std::string>& problems) {
+    const char* const ALL_TABLES = " students courses grades ";
+    bool ok = true;
+    auto check = [&](const std::string& sql, const char* allowed) {
+        ok = check_plan(db, sql, allowed, problems) && ok;
+    };
+    for (int id = 0; id < ST_COUNT_; ++id) {
+        const char* allowed = id == ST_LOG_HEAD ? " sqlite_sequence "
+            : id == ST_STAMP ? " pragma_user_version "
+            : id == ST_FIRST_GRADES ? " grades " : " ";
+        check(STMT_SQL[id], allowed);
+    }
+    for (const char* sql : LOAD_SQL) check(sql, " ");
+    for (const char* sql : FK_CASCADE_SQL) check(sql, " ");
+    check(LOAD_SIZE_SQL, ALL_TABLES);
+    check(SEED_PROBE_SQL, ALL_TABLES);
+    check(BAD_KEYS_SQL, ALL_TABLES);
+    check(WEIGHTED_PROBE_SQL, " pragma_table_xinfo ");
+    for (const char* table : { "students", "courses", "grades" }) check(max_rowid_sql(table), " ");
+    for (const InsertAction& a : INSERT_ACTIONS)
+        if (a.catch_up) check(insert_catch_up_sql(a), " ");
+    return ok;
+}
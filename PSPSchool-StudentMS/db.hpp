@@ -1,8 +1,13 @@
 #pragma once
+#include <functional>
+#include <future>
+#include <iosfwd>
 #include <string>
+#include <utility>
+#include <vector>
 #include "sqlite3.h"
 #include "models.hpp"
-#include "services.hpp"   // for DataStore (holds vectors)
+#include "repository.hpp" // for DataStore (vectors + indexes)
 
 /*
 -------------------------------------------------------------------------------
@@ -15,30 +20,126 @@ need to deal with raw sqlite3_* calls.
 
 Design:
   - Each function returns `bool` to indicate success/failure.
-  - Callers should update the in-memory `DataStore` only when DB ops succeed.
+  - A `DataStore` attached with `db_sync_attach` follows every committed
+    change on this connection automatically (no hand-paired store updates).
   - `DbCounts` provides live counts (students, courses, enrolments) for menus.
 
 Usage convention:
-  - Call `db_open` once at startup, then `db_init_and_seed`.
-  - Use `db_load_all` to populate `DataStore` cache after opening.
+  - Call `db_open` once at startup (pick a DbProfile), then `db_init_and_seed`.
+  - Use `db_sync_attach` (or a one-off `db_load_all`) to populate the
+    `DataStore` cache after opening.
   - Always call `db_close` before exiting.
 -------------------------------------------------------------------------------
 */
 
-/// Opens (creates if not exists) the SQLite DB file at path.
+// ==========================
+// Connection profiles
+// ==========================
+
+/// Per-connection settings applied by db_open. Empty strings and negative
+/// numbers mean "leave the SQLite default".
+struct DbProfile {
+    std::string name;              // label only: "durable", "balanced", ...
+    std::string journal_mode;      // DELETE, TRUNCATE, WAL, MEMORY
+    std::string synchronous;       // OFF, NORMAL, FULL, EXTRA
+    long long cache_size_kib = -1; // page cache size in KiB
+    long long mmap_size = -1;      // bytes of the file to memory-map (0 = off)
+    std::string temp_store;        // DEFAULT, FILE, MEMORY
+    int busy_timeout_ms = -1;      // wait this long on a locked DB before SQLITE_BUSY
+};
+
+/// Rollback journal + synchronous=FULL. Matches the historical behaviour.
+DbProfile db_profile_durable();
+
+/// WAL + synchronous=NORMAL, larger cache and mmap. Readers and the writer do
+/// not block each other and commits skip the per-transaction fsync of the
+/// database file (WAL is synced at checkpoints).
+DbProfile db_profile_balanced();
+
+/// For one-off imports: in-memory journal, synchronous=OFF, big cache.
+/// A crash mid-load can corrupt the file, so only use it on a copy/new DB.
+DbProfile db_profile_bulk_load();
+
+/// Opens (creates if not exists) the SQLite DB file at path and applies
+/// `profile`. If `applied` is given it receives the settings SQLite actually
+/// reports afterwards (e.g. journal_mode stays "memory" for ":memory:").
 /// Returns true on success, false on failure. On failure, `db` is set to nullptr.
-bool db_open(sqlite3*& db, const std::string& path);
+bool db_open(sqlite3*& db, const std::string& path,
+    const DbProfile& profile = db_profile_durable(), DbProfile* applied = nullptr);
+
+/// Read the current connection settings back into `out` (name is left as is).
+bool db_read_profile(sqlite3* db, DbProfile& out);
+
+/// Register the app's SQL functions on `db` (db_open does this):
+///   weighted(internal, final)           0.3*internal + 0.7*final (Grade::weighted)
+///   passed(internal, final [, mark])    1 if weighted >= mark (default PASS_MARK)
+/// Both are deterministic (usable in WHERE/ORDER BY, CHECKs, views). The
+/// schema itself does not call them, so tools without them still work.
+bool db_register_functions(sqlite3* db);
 
 /// Close DB (safe if db==nullptr). Call once at shutdown.
 void db_close(sqlite3* db);
 
+/// Turn the per-connection statement cache off or back on (it is on after
+/// db_open). Off, every db_* call prepares and finalizes its SQL again, as
+/// before the cache; only `sms bench-statements` uses this, to time both.
+void db_set_stmt_cache(sqlite3* db, bool enabled);
+
 /// Create tables if missing and insert a small set of dummy data (only if empty).
 /// Safe to call on every startup.
 bool db_init_and_seed(sqlite3* db);
 
+/// How db_sync_attach / db_load_all filled the store.
+struct DbLoadReport {
+    std::string source;      // "snapshot", "snapshot+delta" or "database"
+    long long replayed = 0;  // change-log entries re-read on top of the snapshot
+    double ms = 0.0;         // wall time of the whole load
+
+    // Breakdown of a full table load (source == "database"):
+    int readers = 0;         // connections that scanned the tables
+    double count_ms = 0.0;   // row counts / rowid bounds used to size the vectors
+    double read_ms = 0.0;    // table scans (wall time across all readers)
+    double merge_ms = 0.0;   // joining rowid ranges + sync rowid maps
+    double index_ms = 0.0;   // store_rebuild_indexes
+};
+
 /// Load all rows from DB into the in-memory DataStore vectors.
-/// Clears the vectors first to avoid duplicates.
-bool db_load_all(sqlite3* db, DataStore& store);
+/// Clears the vectors first to avoid duplicates. Large file databases are
+/// read by several read-only connections in parallel (rowid ranges); the
+/// result is the same as a single scan. `report` receives the timings.
+bool db_load_all(sqlite3* db, DataStore& store, DbLoadReport* report = nullptr);
+
+// ==========================
+// Cache sync
+// ==========================
+
+/// Load `store` and keep it in step with this connection from now on.
+/// Update/commit/rollback hooks collect the rowids each write touches
+/// (including FK cascades and trigger side effects); once the change is
+/// committed the rows are re-read and applied to `store`. Rolled-back work
+/// is dropped. `store` must outlive the attachment (db_close detaches).
+/// Writes by other connections are picked up from the sms_changes log at
+/// the next local commit.
+///
+/// If `snapshot_path` names a snapshot written for this database
+/// (db_sync_save_snapshot), the store is rebuilt from it and only the rows
+/// logged since are re-read; otherwise (missing, stale, corrupt, far behind)
+/// everything is loaded from the tables. `report` says which path ran.
+bool db_sync_attach(sqlite3* db, DataStore& store,
+    const std::string& snapshot_path = "", DbLoadReport* report = nullptr);
+
+/// Write the attached store to `snapshot_path` for the next startup and
+/// prune the change-log entries it covers. Call before db_close. Waits for
+/// the background writer first and returns false, writing nothing, while it
+/// has failures db_writer_reconcile has not collected yet.
+bool db_sync_save_snapshot(sqlite3* db, const std::string& snapshot_path);
+
+/// Remove the hooks; `store` keeps its current contents.
+void db_sync_detach(sqlite3* db);
+
+/// Apply pending committed changes now. The db_* functions do this
+/// themselves; call it after running SQL directly through sqlite3_exec.
+void db_sync_flush(sqlite3* db);
 
 // ==========================
 // INSERT operations
@@ -48,14 +149,14 @@ bool db_add_student(sqlite3* db, const Student& s);
 bool db_add_course(sqlite3* db, const Course& c);
 
 /// Enroll a student in a course: creates a row in `grades` with marks=0.
-bool db_enroll(sqlite3* db, const std::string& roll_no, const std::string& course_code);
+bool db_enroll(sqlite3* db, RollId roll_no, CourseId course_code);
 
 // ==========================
 // UPDATE operations
 // ==========================
 
 /// Enter/update marks for an existing enrollment.
-bool db_enter_marks(sqlite3* db, const std::string& roll_no, const std::string& course_code,
+bool db_enter_marks(sqlite3* db, RollId roll_no, CourseId course_code,
     double internal_mark, double final_mark);
 
 /// Update student fields (by roll_no).
@@ -69,13 +170,47 @@ bool db_update_course(sqlite3* db, const Course& c);
 // ==========================
 
 /// Delete student (cascades to their grades).
-bool db_delete_student(sqlite3* db, const std::string& roll);
+bool db_delete_student(sqlite3* db, RollId roll);
 
 /// Delete course (cascades to its grades).
-bool db_delete_course(sqlite3* db, const std::string& code);
+bool db_delete_course(sqlite3* db, CourseId code);
 
 /// Delete one enrollment (grade row).
-bool db_delete_enrollment(sqlite3* db, const std::string& roll, const std::string& code);
+bool db_delete_enrollment(sqlite3* db, RollId roll, CourseId code);
+
+// ==========================
+// Transactions and BATCH operations
+// ==========================
+
+/// Explicit transaction control. db_begin takes the write lock up front
+/// (BEGIN IMMEDIATE) so a batch never fails halfway on lock upgrade.
+bool db_begin(sqlite3* db);
+bool db_commit(sqlite3* db);
+void db_rollback(sqlite3* db);
+
+/// Per-row outcome of a batch call. row_ok[i] corresponds to input row i.
+/// A row fails on its own (duplicate key, unknown student/course, no such
+/// enrollment) without aborting the rest of the batch.
+struct BatchResult {
+    std::vector<bool> row_ok;
+    int succeeded = 0;
+    int failed = 0;
+};
+
+/// Batch entry points. Each one runs the whole input inside a single
+/// BEGIN/COMMIT (or inside the caller's transaction if one is already open)
+/// and reuses the cached per-row statement. Returns false only if the
+/// transaction itself could not be committed; in that case nothing was written
+/// and every row_ok entry is false.
+bool db_add_students(sqlite3* db, const std::vector<Student>& rows, BatchResult& out);
+bool db_add_courses(sqlite3* db, const std::vector<Course>& rows, BatchResult& out);
+
+/// Enroll many (roll_no, course_code) pairs, e.g. a whole cohort into a course.
+bool db_enroll_many(sqlite3* db,
+    const std::vector<std::pair<RollId, CourseId>>& pairs, BatchResult& out);
+
+/// Enter marks for many enrollments; each Grade supplies key + both marks.
+bool db_enter_marks_many(sqlite3* db, const std::vector<Grade>& rows, BatchResult& out);
 
 // ==========================
 // Counts (for dashboards/menus)
@@ -89,6 +224,123 @@ struct DbCounts {
 };
 
 /// Populate `out` with counts of students, courses, and enrolments.
-/// Returns true on success.
+/// Reads the single trigger-maintained row in sms_counts, so it is cheap
+/// enough to call on every menu redraw. Returns true on success.
 bool db_get_counts(sqlite3* db, DbCounts& out);
 
+// ==========================
+// Write-behind
+// ==========================
+
+/// How the background writer groups queued writes into transactions.
+struct DbWriterOptions {
+    /// Group-commit window: after the first write of a batch arrives, keep
+    /// the transaction open this long (microseconds) for writes from other
+    /// callers, so they share one COMMIT and one sync. 0 = commit as soon
+    /// as the queue is empty (lowest latency for a single user).
+    int group_window_us = 0;
+    /// Most writes per transaction; a full batch commits without waiting
+    /// out the window.
+    size_t max_batch = 1024;
+};
+
+/// Start a background writer for `db`: a thread with its own connection to
+/// the same file (same profile) that commits queued writes in batches. The
+/// caller updates the DataStore itself and queues the matching db_* call:
+///
+///   add_student(data, s);
+///   db_write_async(db, [s](sqlite3* w) { return db_add_student(w, s); });
+///
+/// so a menu action returns without waiting for the disk. db_close stops
+/// the writer after committing everything still queued. Returns false (and
+/// db_write_async keeps writing synchronously) if the second connection
+/// cannot be opened. For end-of-term marks entry by many concurrent
+/// callers, e.g. { 2000, 256 }: up to 2 ms or 256 rows per commit.
+bool db_writer_start(sqlite3* db, const DbWriterOptions& options = DbWriterOptions());
+
+/// Queue `op` for the writer. It runs on the writer's connection inside a
+/// batch transaction, so it must only use that connection (the argument).
+/// The future turns true once the batch has committed (durable as far as
+/// the profile's synchronous setting goes) and false if `op` or the commit
+/// failed. Without a writer, runs `op` on `db` right away. Dropping the
+/// future is fine; nothing waits on it then.
+std::future<bool> db_write_async(sqlite3* db, std::function<bool(sqlite3*)> op);
+
+/// db_enter_marks through the writer, blocking until its group has
+/// committed. Safe to call from many threads at once on the same `db`; each
+/// caller gets its own row's result (false: no such enrollment, or the
+/// group's commit failed). Needs a running writer to be thread-safe.
+bool db_enter_marks_grouped(sqlite3* db, RollId roll_no, CourseId course_code,
+    double internal_mark, double final_mark);
+
+/// Block until every write queued so far has committed (or failed).
+void db_writer_flush(sqlite3* db);
+
+/// Writes queued but not committed yet (0 without a writer). While this is
+/// non-zero, SQL reads on `db` may not show the latest changes yet.
+size_t db_writer_pending(sqlite3* db);
+
+/// If queued writes failed since the last call, the DataStore holds changes
+/// the database does not: wait for the queue, reload the attached store from
+/// the database and return how many writes failed. Returns 0 (doing nothing)
+/// otherwise; cheap enough to call on every menu redraw.
+int db_writer_reconcile(sqlite3* db);
+
+/// Commit what is queued, stop the thread and close its connection. Called
+/// by db_close; safe to call without a writer.
+void db_writer_stop(sqlite3* db);
+
+// ==========================
+// Reports (SQL pushdown)
+// ==========================
+
+/// Print the same student report as student_report (services.hpp), but
+/// computed by SQLite from covering indexes and streamed straight to `out`,
+/// so it needs no DataStore and works on databases too large to cache.
+/// Returns false on a database error (a missing student is not an error).
+bool db_student_report(sqlite3* db, RollId roll_no, std::ostream& out);
+
+/// Same as course_report (services.hpp), computed by one indexed aggregate.
+bool db_course_report(sqlite3* db, CourseId code, std::ostream& out);
+
+/// Enrollments in `code` whose weighted mark is below `below`, lowest
+/// first. A range read on the course ranking index.
+bool db_grades_below(sqlite3* db, CourseId code, double below, std::vector<Grade>& out);
+
+/// The `n` best enrollments in `code` (highest weighted mark first, ties by
+/// roll number); position i in `out` is class rank i + 1. Reads only the
+/// first n entries of the course ranking index, however big the class is.
+bool db_course_top(sqlite3* db, CourseId code, int n, std::vector<Grade>& out);
+
+/// The first `n` grade rows in table order, for the write benchmarks to
+/// rewrite unchanged.
+bool db_first_grades(sqlite3* db, int n, std::vector<Grade>& out);
+
+// ==========================
+// Search
+// ==========================
+
+/// Students whose name or address contains every word of `text` (each word
+/// also matches as a prefix: "av ma" finds "Ava Martin"), best bm25 match
+/// first, at most `limit` rows. Case- and accent-insensitive. Empty text
+/// gives no rows. Served by the students_fts full-text index; every match
+/// is scored, so a selective query (a name) answers in well under a
+/// millisecond while a word found in most rows costs time per row.
+bool db_search_students(sqlite3* db, const std::string& text, int limit, std::vector<Student>& out);
+
+/// Same for courses, over title, description and teacher.
+bool db_search_courses(sqlite3* db, const std::string& text, int limit, std::vector<Course>& out);
+
+// ==========================
+// Diagnostics
+// ==========================
+
+/// Run EXPLAIN QUERY PLAN over every SQL statement this layer prepares
+/// (the statement cache, load, migration and bulk catch-up SQL, plus the
+/// child deletes behind the FK cascades) and report any that would scan a
+/// whole table instead of seeking through an index. Expected scans
+/// (COUNT(*), EXISTS probes, LIMIT reads, tiny system tables) are allowed.
+/// Returns false if any statement regressed; `problems` gets one entry
+/// (SQL + plan line) per offender. Run via `sms --check-plans` and by the
+/// PSPSchool-StudentMS.Tests project.
+bool db_check_query_plans(sqlite3* db, std::vector<std::string>& problems);
@@ -8,8 +8,8 @@
  helpers.hpp — In-memory cache helpers
 -------------------------------------------------------------------------------
 These functions operate on the DataStore vectors (students, courses, grades)
-without touching the SQLite database. They are always called *after* the DB
-operation has succeeded to keep the cache consistent with the DB.
+without touching the SQLite database. They are called *before* the matching
+DB write, which then follows on the background writer (see below).
 
 Naming convention:
   - exists_*   -> read-only check for presence.
@@ -22,8 +22,12 @@ Return values:
     or erased.
 
 Usage reminder:
-  - Call DB functions (db_add_*, db_update_*, db_delete_*) first.
-  - Only if DB call returns true, call the corresponding helper here.
+  - Call the helper here first; it refuses what the cache already rejects
+    (duplicate key, unknown student/course).
+  - Only if it returns true, queue the matching DB call (db_add_*,
+    db_update_*, db_delete_*) with db_write_async.
+  - A queued write the DB refuses leaves the cache ahead of the file;
+    db_writer_reconcile (called on every menu redraw) reloads it.
 -------------------------------------------------------------------------------
 */
 
@@ -32,15 +36,15 @@ Usage reminder:
 // ==========================
 
 /// True if a student with given roll exists in DataStore.
-bool exists_student(const DataStore& d, const std::string& roll);
+bool exists_student(const DataStore& d, RollId roll);
 
 /// True if a course with given code exists in DataStore.
-bool exists_course(const DataStore& d, const std::string& code);
+bool exists_course(const DataStore& d, CourseId code);
 
 /// True if a (student, course) enrollment already exists in DataStore.
 bool already_enrolled(const DataStore& d,
-    const std::string& roll,
-    const std::string& code);
+    RollId roll,
+    CourseId code);
 
 // ==========================
 // Updates
@@ -60,15 +64,15 @@ bool apply_course_update(DataStore& d, const Course& c);
 
 /// Remove student and cascade delete their grades.
 /// Returns true if removed.
-bool remove_student(DataStore& d, const std::string& roll);
+bool remove_student(DataStore& d, RollId roll);
 
 /// Remove course and cascade delete grades for that course.
 /// Returns true if removed.
-bool remove_course(DataStore& d, const std::string& code);
+bool remove_course(DataStore& d, CourseId code);
 
 /// Remove a single enrollment (grade row).
 /// Returns true if removed.
-bool remove_enrollment(DataStore& d, const std::string& roll, const std::string& code);
+bool remove_enrollment(DataStore& d, RollId roll, CourseId code);
 
 
 
@@ -0,0 +1,1127 @@
+#include "http_server.hpp"
+#include <iostream>
+
+/*
+-------------------------------------------------------------------------------
+ http_server.cpp - Event loop, worker pool and JSON routes for http_server.hpp
+-------------------------------------------------------------------------------
+Only the loop thread touches sockets and connection state. It reads until a
+request is complete, parks the connection (no read interest) and queues the
+request for the workers; a worker builds the whole response, hands it back
+through a completion list and an eventfd, and the loop sends it (switching
+to EPOLLOUT if the socket is full) before it looks at the next pipelined
+request on that connection. A connection therefore has at most one request
+in a worker, and responses go out in request order.
+-------------------------------------------------------------------------------
+*/
+
+#if SMS_HAVE_HTTP
+
+#include <algorithm>
+#include <cctype>
+#include <charconv>
+#include <cmath>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <shared_mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include <arpa/inet.h>
+#include <csignal>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include "db.hpp"
+#include "helpers.hpp"
+#include "services.hpp"
+#include "validation.hpp"
+
+namespace {
+
+constexpr std::size_t MAX_HEADER_BYTES = 16 * 1024;
+constexpr std::size_t MAX_BODY_BYTES = 1024 * 1024;
+constexpr std::size_t DEFAULT_PAGE = 100;
+constexpr std::size_t MAX_PAGE = 1000;
+
+// ==========================
+// JSON
+// ==========================
+
+void json_string(std::string& o, const std::string& s) {
+    static const char HEX[] = "0123456789abcdef";
+    o += '"';
+    for (unsigned char c : s) {
+        if (c == '"' || c == '\\') { o += '\\'; o += static_cast<char>(c); }
+        else if (c == '\n') o += "\\n";
+        else if (c == '\r') o += "\\r";
+        else if (c == '\t') o += "\\t";
+        else if (c < 0x20) { o += "\\u00"; o += HEX[c >> 4]; o += HEX[c & 15]; }
+        else o += static_cast<char>(c);
+    }
+    o += '"';
+}
+
+// Shortest round-trip form; null if not finite.
+void json_number(std::string& o, double v) {
+    char buf[32];
+    auto r = std::to_chars(buf, buf + sizeof buf, v);
+    if (r.ec != std::errc() || v != v || v - v != 0) { o += "null"; return; }
+    o.append(buf, r.ptr);
+}
+
+// Derived figures (weighted, averages) to 2 decimals, like the exports.
+void json_derived(std::string& o, double v) {
+    json_number(o, std::round(v * 100) / 100);
+}
+
+void json_uint(std::string& o, std::size_t v) {
+    char buf[24];
+    auto r = std::to_chars(buf, buf + sizeof buf, v);
+    o.append(buf, r.ptr);
+}
+
+// "key": with the leading comma when it is not the first member.
+void json_key(std::string& o, const char* key) {
+    if (o.back() != '{') o += ',';
+    o += '"';
+    o += key;
+    o += "\":";
+}
+
+void put_student(std::string& o, const Student& s) {
+    o += '{';
+    json_key(o, "roll_no"); json_string(o, to_string(s.roll_no));
+    json_key(o, "name"); json_string(o, s.name);
+    json_key(o, "address"); json_string(o, s.address);
+    json_key(o, "contact"); json_string(o, s.contact);
+    o += '}';
+}
+
+void put_course(std::string& o, const Course& c) {
+    o += '{';
+    json_key(o, "code"); json_string(o, to_string(c.code));
+    json_key(o, "title"); json_string(o, c.title);
+    json_key(o, "description"); json_string(o, c.description);
+    json_key(o, "teacher"); json_string(o, c.teacher);
+    o += '}';
+}
+
+void put_grade(std::string& o, const Grade& g) {
+    const double w = g.weighted();
+    o += '{';
+    json_key(o, "roll_no"); json_string(o, to_string(g.roll_no));
+    json_key(o, "course_code"); json_string(o, to_string(g.course_code));
+    json_key(o, "internal_mark"); json_number(o, g.internal_mark);
+    json_key(o, "final_mark"); json_number(o, g.final_mark);
+    json_key(o, "weighted"); json_derived(o, w);
+    json_key(o, "passed"); o += w >= PASS_MARK ? "true" : "false";
+    o += '}';
+}
+
+// count / average / passed / lowest / highest; figures are null when empty.
+template <class Stats>
+void put_stats(std::string& o, const Stats& st, const char* count_key) {
+    json_key(o, count_key); json_uint(o, st.count);
+    json_key(o, "passed"); json_uint(o, st.passed);
+    json_key(o, "average"); if (st.count) json_derived(o, st.average()); else o += "null";
+    json_key(o, "lowest"); if (st.count) json_derived(o, st.min_weighted); else o += "null";
+    json_key(o, "highest"); if (st.count) json_derived(o, st.max_weighted); else o += "null";
+}
+
+// A member of a flat request object. `text` is the unescaped string, or the
+// raw token (number, true, false, null) when `quoted` is false.
+struct JsonField {
+    std::string key;
+    std::string text;
+    bool quoted = false;
+};
+
+void put_utf8(std::string& o, unsigned cp) {
+    if (cp < 0x80) o += static_cast<char>(cp);
+    else if (cp < 0x800) { o += static_cast<char>(0xC0 | (cp >> 6)); o += static_cast<char>(0x80 | (cp & 0x3F)); }
+    else if (cp < 0x10000) {
+        o += static_cast<char>(0xE0 | (cp >> 12));
+        o += static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+        o += static_cast<char>(0x80 | (cp & 0x3F));
+    }
+    else {
+        o += static_cast<char>(0xF0 | (cp >> 18));
+        o += static_cast<char>(0x80 | ((cp >> 12) & 0x3F));
+        o += static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+        o += static_cast<char>(0x80 | (cp & 0x3F));
+    }
+}
+
+bool read_hex4(const std::string& s, std::size_t& i, unsigned& out) {
+    if (i + 4 > s.size()) return false;
+    auto r = std::from_chars(s.data() + i, s.data() + i + 4, out, 16);
+    if (r.ec != std::errc() || r.ptr != s.data() + i + 4) return false;
+    i += 4;
+    return true;
+}
+
+// Parse the string starting at s[i] == '"'; leaves i past the closing quote.
+bool read_json_string(const std::string& s, std::size_t& i, std::string& out) {
+    out.clear();
+    ++i;
+    while (i < s.size()) {
+        const char c = s[i++];
+        if (c == '"') return true;
+        if (static_cast<unsigned char>(c) < 0x20) return false;
+        if (c != '\\') { out += c; continue; }
+        if (i >= s.size()) return false;
+        switch (s[i++]) {
+        case '"': out += '"'; break;
+        case '\\': out += '\\'; break;
+        case '/': out += '/'; break;
+        case 'b': out += '\b'; break;
+        case 'f': out += '\f'; break;
+        case 'n': out += '\n'; break;
+        case 'r': out += '\r'; break;
+        case 't': out += '\t'; break;
+        case 'u': {
+            unsigned cp = 0;
+            if (!read_hex4(s, i, cp)) return false;
+            if (cp >= 0xD800 && cp < 0xDC00) {   // surrogate pair
+                unsigned lo = 0;
+                if (s.compare(i, 2, "\\u") != 0) return false;
+                i += 2;
+                if (!read_hex4(s, i, lo) || lo < 0xDC00 || lo >= 0xE000) return false;
+                cp = 0x10000 + ((cp - 0xD800) << 10) + (lo - 0xDC00);
+            }
+            else if (cp >= 0xDC00 && cp < 0xE000) return false;
+            put_utf8(out, cp);
+            break;
+        }
+        default: return false;
+        }
+    }
+    return false;
+}
+
+// {"key": "string" | number | true | false | null, ...}. Nested objects and
+// arrays are rejected; no route takes them.
+bool parse_json_object(const std::string& s, std::vector<JsonField>& out) {
+    auto ws = [&](std::size_t& i) { while (i < s.size() && (s[i] == ' ' || s[i] == '\t' || s[i] == '\n' || s[i] == '\r')) ++i; };
+    std::size_t i = 0;
+    ws(i);
+    if (i >= s.size() || s[i] != '{') return false;
+    ++i;
+    ws(i);
+    if (i < s.size() && s[i] == '}') { ++i; ws(i); return i == s.size(); }
+    for (;;) {
+        JsonField f;
+        if (i >= s.size() || s[i] != '"' || !read_json_string(s, i, f.key)) return false;
+        ws(i);
+        if (i >= s.size() || s[i] != ':') return false;
+        ++i;
+        ws(i);
+        if (i >= s.size()) return false;
+        if (s[i] == '"') {
+            if (!read_json_string(s, i, f.text)) return false;
+            f.quoted = true;
+        }
+        else {
+            const std::size_t b = i;
+            while (i < s.size() && (std::isalnum(static_cast<unsigned char>(s[i])) || s[i] == '-' || s[i] == '+' || s[i] == '.')) ++i;
+            if (i == b) return false;
+            f.text.assign(s, b, i - b);
+        }
+        out.push_back(std::move(f));
+        ws(i);
+        if (i < s.size() && s[i] == ',') { ++i; ws(i); continue; }
+        if (i < s.size() && s[i] == '}') { ++i; ws(i); return i == s.size(); }
+        return false;
+    }
+}
+
+const JsonField* field(const std::vector<JsonField>& f, const char* key) {
+    for (const JsonField& x : f) if (x.key == key) return &x;
+    return nullptr;
+}
+
+// ==========================
+// HTTP
+// ==========================
+
+struct HttpRequest {
+    std::string method;
+    std::string path;
+    std::string query;
+    std::string body;
+    bool keep_alive = true;
+};
+
+struct HttpResponse {
+    int status = 200;
+    std::string body;          // JSON
+};
+
+const char* status_text(int status) {
+    switch (status) {
+    case 200: return "OK";
+    case 201: return "Created";
+    case 400: return "Bad Request";
+    case 404: return "Not Found";
+    case 405: return "Method Not Allowed";
+    case 409: return "Conflict";
+    case 413: return "Payload Too Large";
+    case 431: return "Request Header Fields Too Large";
+    case 500: return "Internal Server Error";
+    case 501: return "Not Implemented";
+    case 505: return "HTTP Version Not Supported";
+    default: return "Unknown";
+    }
+}
+
+HttpResponse error(int status, const std::string& message) {
+    HttpResponse r;
+    r.status = status;
+    r.body = "{\"error\":";
+    json_string(r.body, message);
+    r.body += '}';
+    return r;
+}
+
+std::string serialize(const HttpResponse& r, bool keep_alive) {
+    std::string o;
+    o.reserve(r.body.size() + 128);
+    o += "HTTP/1.1 ";
+    json_uint(o, static_cast<std::size_t>(r.status));
+    o += ' ';
+    o += status_text(r.status);
+    o += "\r\nContent-Type: application/json\r\nContent-Length: ";
+    json_uint(o, r.body.size());
+    o += keep_alive ? "\r\n\r\n" : "\r\nConnection: close\r\n\r\n";
+    o += r.body;
+    return o;
+}
+
+bool iequals(const char* a, const char* b, std::size_t n) {
+    for (std::size_t i = 0; i < n; ++i)
+        if (std::tolower(static_cast<unsigned char>(a[i])) != std::tolower(static_cast<unsigned char>(b[i]))) return false;
+    return true;
+}
+
+bool header_is(const char* p, std::size_t n, const char* name) {
+    const std::size_t len = std::strlen(name);
+    return n == len && iequals(p, name, len);
+}
+
+bool value_has(const std::string& v, const char* token) {
+    const std::size_t len = std::strlen(token);
+    for (std::size_t i = 0; i + len <= v.size(); ++i)
+        if (iequals(v.data() + i, token, len)) return true;
+    return false;
+}
+
+// Parse one request from the front of `in`. Returns 0 when more bytes are
+// needed, 1 with `req` filled and `used` bytes consumed, or an HTTP error
+// status for a request that cannot be served (the connection is closed).
+int parse_request(const std::string& in, HttpRequest& req, std::size_t& used) {
+    const std::size_t head_end = in.find("\r\n\r\n");
+    if (head_end == std::string::npos) return in.size() > MAX_HEADER_BYTES ? 431 : 0;
+    if (head_end > MAX_HEADER_BYTES) return 431;
+
+    const std::size_t line_end = in.find("\r\n");
+    const std::string line = in.substr(0, line_end);
+    const std::size_t sp1 = line.find(' ');
+    const std::size_t sp2 = line.rfind(' ');
+    if (sp1 == std::string::npos || sp2 == sp1) return 400;
+    req.method = line.substr(0, sp1);
+    const std::string target = line.substr(sp1 + 1, sp2 - sp1 - 1);
+    const std::string version = line.substr(sp2 + 1);
+    if (version.compare(0, 7, "HTTP/1.") != 0 || version.size() != 8) return version.compare(0, 5, "HTTP/") == 0 ? 505 : 400;
+    if (target.empty() || target[0] != '/') return 400;
+    const std::size_t q = target.find('?');
+    req.path = target.substr(0, q);
+    req.query = q == std::string::npos ? "" : target.substr(q + 1);
+    req.keep_alive = version[7] == '1';
+
+    std::size_t length = 0;
+    for (std::size_t p = line_end + 2; p < head_end;) {
+        std::size_t e = in.find("\r\n", p);
+        if (e > head_end) e = head_end;
+        const std::size_t colon = in.find(':', p);
+        if (colon == std::string::npos || colon > e) return 400;
+        std::size_t v = colon + 1;
+        while (v < e && (in[v] == ' ' || in[v] == '\t')) ++v;
+        const std::string value = in.substr(v, e - v);
+        const char* name = in.data() + p;
+        const std::size_t name_len = colon - p;
+        if (header_is(name, name_len, "content-length")) {
+            auto r = std::from_chars(value.data(), value.data() + value.size(), length);
+            if (r.ec != std::errc() || r.ptr != value.data() + value.size()) return 400;
+            if (length > MAX_BODY_BYTES) return 413;
+        }
+        else if (header_is(name, name_len, "transfer-encoding")) {
+            return 501;   // chunked request bodies are not supported
+        }
+        else if (header_is(name, name_len, "connection")) {
+            if (value_has(value, "close")) req.keep_alive = false;
+            else if (value_has(value, "keep-alive")) req.keep_alive = true;
+        }
+        p = e + 2;
+    }
+
+    const std::size_t body_at = head_end + 4;
+    if (in.size() < body_at + length) return 0;
+    req.body.assign(in, body_at, length);
+    used = body_at + length;
+    return 1;
+}
+
+// offset= and limit= from the query string.
+void page_of(const std::string& query, std::size_t& offset, std::size_t& limit) {
+    offset = 0;
+    limit = DEFAULT_PAGE;
+    std::size_t p = 0;
+    while (p < query.size()) {
+        std::size_t e = query.find('&', p);
+        if (e == std::string::npos) e = query.size();
+        const std::size_t eq = query.find('=', p);
+        if (eq != std::string::npos && eq < e) {
+            const std::string key = query.substr(p, eq - p);
+            std::size_t v = 0;
+            auto r = std::from_chars(query.data() + eq + 1, query.data() + e, v);
+            if (r.ec == std::errc() && r.ptr == query.data() + e) {
+                if (key == "offset") offset = v;
+                else if (key == "limit") limit = std::min(v, MAX_PAGE);
+            }
+        }
+        p = e + 1;
+    }
+}
+
+std::vector<std::string> split_path(const std::string& path) {
+    std::vector<std::string> parts;
+    std::size_t p = 1;
+    while (p <= path.size()) {
+        std::size_t e = path.find('/', p);
+        if (e == std::string::npos) e = path.size();
+        if (e > p) parts.push_back(path.substr(p, e - p));
+        p = e + 1;
+    }
+    return parts;
+}
+
+// ==========================
+// Routes
+// ==========================
+
+class Api {
+public:
+    Api(sqlite3* db, DataStore& data) : db_(db), data_(data) {}
+
+    HttpResponse handle(const HttpRequest& req) {
+        const std::vector<std::string> p = split_path(req.path);
+        const std::string& m = req.method;
+        const std::size_t n = p.size();
+        if (n >= 1 && p[0] == "students") {
+            if (n == 1) return m == "GET" ? list_students(req) : m == "POST" ? add_student(req) : not_allowed();
+            if (n == 2) return m == "GET" ? get_student(p[1]) : m == "PUT" ? edit_student(p[1], req)
+                : m == "DELETE" ? delete_student(p[1]) : not_allowed();
+        }
+        else if (n >= 1 && p[0] == "courses") {
+            if (n == 1) return m == "GET" ? list_courses(req) : m == "POST" ? add_course(req) : not_allowed();
+            if (n == 2) return m == "GET" ? get_course(p[1]) : m == "PUT" ? edit_course(p[1], req)
+                : m == "DELETE" ? delete_course(p[1]) : not_allowed();
+        }
+        else if (n >= 1 && p[0] == "enrollments") {
+            if (n == 1) return m == "GET" ? list_grades(req) : m == "POST" ? enroll(req) : not_allowed();
+            if (n == 3) return m == "GET" ? get_grade(p[1], p[2]) : m == "DELETE" ? unenroll(p[1], p[2]) : not_allowed();
+        }
+        else if (n == 3 && p[0] == "marks") {
+            return m == "PUT" ? marks(p[1], p[2], req) : not_allowed();
+        }
+        else if (n >= 2 && p[0] == "reports") {
+            if (n == 3 && p[1] == "students") return m == "GET" ? student_report(p[2]) : not_allowed();
+            if (n == 3 && p[1] == "courses") return m == "GET" ? course_report(p[2]) : not_allowed();
+            if (n == 2 && p[1] == "summary") return m == "GET" ? summary() : not_allowed();
+        }
+        else if (n == 1 && p[0] == "counts") {
+            return m == "GET" ? counts() : not_allowed();
+        }
+        return error(404, "no such route: " + req.path);
+    }
+
+private:
+    using Shared = std::shared_lock<std::shared_mutex>;
+    using Unique = std::unique_lock<std::shared_mutex>;
+
+    static HttpResponse not_allowed() { return error(405, "method not allowed"); }
+
+    static HttpResponse ok(int status, std::string body) {
+        HttpResponse r;
+        r.status = status;
+        r.body = std::move(body);
+        return r;
+    }
+
+    // Queue `op` behind the cache change made under `lk`, release the lock
+    // and wait for the commit. If the database refused it, the cache is
+    // ahead of the file: reload it.
+    HttpResponse write(Unique& lk, std::function<bool(sqlite3*)> op, HttpResponse reply) {
+        std::future<bool> done = db_write_async(db_, std::move(op));
+        lk.unlock();
+        if (done.get()) return reply;
+        Unique relock(mu_);
+        db_writer_reconcile(db_);
+        return error(500, "the database refused the change; reloaded from it");
+    }
+
+    // Request body and id parsing; each fills `err` with a 400 on failure.
+    static bool body_of(const HttpRequest& req, std::vector<JsonField>& f, HttpResponse& err) {
+        if (parse_json_object(req.body, f)) return true;
+        err = error(400, "body must be a flat JSON object");
+        return false;
+    }
+
+    // The field rules and messages are validation.hpp's (shared with `sms
+    // import` and `sms exec`); here only the JSON shape is checked.
+    static bool text(const std::vector<JsonField>& f, const char* key, std::string& out, HttpResponse& err) {
+        const JsonField* x = field(f, key);
+        if (x && x->quoted) { out = x->text; return true; }
+        err = error(400, std::string(key) + " must be a string");
+        return false;
+    }
+
+    static bool mark(const std::vector<JsonField>& f, const char* key, double& out, HttpResponse& err) {
+        const JsonField* x = field(f, key);
+        std::string msg;
+        if (x && !x->quoted && check_mark(x->text, key, out, msg)) return true;
+        err = error(400, x && !x->quoted ? msg : std::string(key) + " must be a number 0-100");
+        return false;
+    }
+
+    static bool roll_of(const std::string& s, RollId& out, HttpResponse& err) {
+        std::string msg;
+        if (check_roll(s, out, msg)) return true;
+        err = error(400, msg);
+        return false;
+    }
+
+    static bool code_of(const std::string& s, CourseId& out, HttpResponse& err) {
+        std::string msg;
+        if (check_course_code(s, out, msg)) return true;
+        err = error(400, msg);
+        return false;
+    }
+
+    static bool student_fields(const std::vector<JsonField>& f, Student& s, HttpResponse& err) {
+        std::string name, address, contact, msg;
+        if (!text(f, "name", name, err) || !text(f, "address", address, err) || !text(f, "contact", contact, err))
+            return false;
+        if (check_student_fields(name, address, contact, s, msg)) return true;
+        err = error(400, msg);
+        return false;
+    }
+
+    static bool course_fields(const std::vector<JsonField>& f, Course& c, HttpResponse& err) {
+        std::string title, description, teacher, msg;
+        if (!text(f, "title", title, err) || !text(f, "description", description, err) || !text(f, "teacher", teacher, err))
+            return false;
+        if (check_course_fields(title, description, teacher, c, msg)) return true;
+        err = error(400, msg);
+        return false;
+    }
+
+    // ---- Students ----------------------------------------------------------
+
+    HttpResponse list_students(const HttpRequest& req) {
+        std::size_t offset, limit;
+        page_of(req.query, offset, limit);
+        Shared lk(mu_);
+        const std::vector<Student>& all = data_.all_students;
+        std::string o = "{";
+        json_key(o, "total"); json_uint(o, all.size());
+        json_key(o, "offset"); json_uint(o, offset);
+        json_key(o, "items"); o += '[';
+        for (std::size_t i = offset; i < all.size() && i - offset < limit; ++i) {
+            if (i > offset) o += ',';
+            put_student(o, all[i]);
+        }
+        o += "]}";
+        return ok(200, std::move(o));
+    }
+
+    HttpResponse get_student(const std::string& id) {
+        HttpResponse err;
+        RollId roll;
+        if (!roll_of(id, roll, err)) return err;
+        Shared lk(mu_);
+        const Student* s = find_student(data_, roll);
+        if (!s) return error(404, "no student " + id);
+        std::string o;
+        put_student(o, *s);
+        return ok(200, std::move(o));
+    }
+
+    HttpResponse add_student(const HttpRequest& req) {
+        HttpResponse err;
+        std::vector<JsonField> f;
+        Student s;
+        std::string roll_text;
+        if (!body_of(req, f, err)
+            || !text(f, "roll_no", roll_text, err) || !roll_of(roll_text, s.roll_no, err)
+            || !student_fields(f, s, err)) return err;
+        std::string o;
+        put_student(o, s);
+        Unique lk(mu_);
+        if (!::add_student(data_, s)) return error(409, "roll_no " + roll_text + " already exists");
+        return write(lk, [s](sqlite3* w) { return db_add_student(w, s); }, ok(201, std::move(o)));
+    }
+
+    HttpResponse edit_student(const std::string& id, const HttpRequest& req) {
+        HttpResponse err;
+        std::vector<JsonField> f;
+        Student s;
+        if (!roll_of(id, s.roll_no, err) || !body_of(req, f, err) || !student_fields(f, s, err)) return err;
+        std::string o;
+        put_student(o, s);
+        Unique lk(mu_);
+        if (!apply_student_update(data_, s)) return error(404, "no student " + id);
+        return write(lk, [s](sqlite3* w) { return db_update_student(w, s); }, ok(200, std::move(o)));
+    }
+
+    HttpResponse delete_student(const std::string& id) {
+        HttpResponse err;
+        RollId roll;
+        if (!roll_of(id, roll, err)) return err;
+        Unique lk(mu_);
+        if (!remove_student(data_, roll)) return error(404, "no student " + id);
+        return write(lk, [roll](sqlite3* w) { return db_delete_student(w, roll); }, ok(200, "{}"));
+    }
+
+    // ---- Courses -----------------------------------------------------------
+
+    HttpResponse list_courses(const HttpRequest& req) {
+        std::size_t offset, limit;
+        page_of(req.query, offset, limit);
+        Shared lk(mu_);
+        const std::vector<Course>& all = data_.all_courses;
+        std::string o = "{";
+        json_key(o, "total"); json_uint(o, all.size());
+        json_key(o, "offset"); json_uint(o, offset);
+        json_key(o, "items"); o += '[';
+        for (std::size_t i = offset; i < all.size() && i - offset < limit; ++i) {
+            if (i > offset) o += ',';
+            put_course(o, all[i]);
+        }
+        o += "]}";
+        return ok(200, std::move(o));
+    }
+
+    HttpResponse get_course(const std::string& id) {
+        HttpResponse err;
+        CourseId code;
+        if (!code_of(id, code, err)) return err;
+        Shared lk(mu_);
+        const Course* c = find_course(data_, code);
+        if (!c) return error(404, "no course " + id);
+        std::string o;
+        put_course(o, *c);
+        return ok(200, std::move(o));
+    }
+
+    HttpResponse add_course(const HttpRequest& req) {
+        HttpResponse err;
+        std::vector<JsonField> f;
+        Course c;
+        std::string code_text;
+        if (!body_of(req, f, err)
+            || !text(f, "code", code_text, err) || !code_of(code_text, c.code, err)
+            || !course_fields(f, c, err)) return err;
+        std::string o;
+        put_course(o, c);
+        Unique lk(mu_);
+        if (!::add_course(data_, c)) return error(409, "course code " + code_text + " already exists");
+        return write(lk, [c](sqlite3* w) { return db_add_course(w, c); }, ok(201, std::move(o)));
+    }
+
+    HttpResponse edit_course(const std::string& id, const HttpRequest& req) {
+        HttpResponse err;
+        std::vector<JsonField> f;
+        Course c;
+        if (!code_of(id, c.code, err) || !body_of(req, f, err) || !course_fields(f, c, err)) return err;
+        std::string o;
+        put_course(o, c);
+        Unique lk(mu_);
+        if (!apply_course_update(data_, c)) return error(404, "no course " + id);
+        return write(lk, [c](sqlite3* w) { return db_update_course(w, c); }, ok(200, std::move(o)));
+    }
+
+    HttpResponse delete_course(const std::string& id) {
+        HttpResponse err;
+        CourseId code;
+        if (!code_of(id, code, err)) return err;
+        Unique lk(mu_);
+        if (!remove_course(data_, code)) return error(404, "no course " + id);
+        return write(lk, [code](sqlite3* w) { return db_delete_course(w, code); }, ok(200, "{}"));
+    }
+
+    // ---- Enrollments and marks ---------------------------------------------
+
+    HttpResponse list_grades(const HttpRequest& req) {
+        std::size_t offset, limit;
+        page_of(req.query, offset, limit);
+        Shared lk(mu_);
+        const GradeColumns& all = data_.all_grades;
+        std::string o = "{";
+        json_key(o, "total"); json_uint(o, all.size());
+        json_key(o, "offset"); json_uint(o, offset);
+        json_key(o, "items"); o += '[';
+        for (std::size_t i = offset; i < all.size() && i - offset < limit; ++i) {
+            if (i > offset) o += ',';
+            put_grade(o, all[i]);
+        }
+        o += "]}";
+        return ok(200, std::move(o));
+    }
+
+    HttpResponse get_grade(const std::string& r, const std::string& c) {
+        HttpResponse err;
+        RollId roll;
+        CourseId code;
+        if (!roll_of(r, roll, err) || !code_of(c, code, err)) return err;
+        Shared lk(mu_);
+        const std::uint32_t slot = find_grade_slot(data_, roll, code);
+        if (slot == NO_SLOT) return error(404, r + " is not enrolled in " + c);
+        std::string o;
+        put_grade(o, data_.all_grades[slot]);
+        return ok(200, std::move(o));
+    }
+
+    HttpResponse enroll(const HttpRequest& req) {
+        HttpResponse err;
+        std::vector<JsonField> f;
+        std::string r, c;
+        RollId roll;
+        CourseId code;
+        if (!body_of(req, f, err)
+            || !text(f, "roll_no", r, err) || !roll_of(r, roll, err)
+            || !text(f, "course_code", c, err) || !code_of(c, code, err)) return err;
+        std::string o;
+        put_grade(o, Grade{ roll, code, 0.0, 0.0 });
+        Unique lk(mu_);
+        if (!exists_student(data_, roll)) return error(404, "no student " + r);
+        if (!exists_course(data_, code)) return error(404, "no course " + c);
+        if (!enroll_student(data_, roll, code)) return error(409, r + " is already enrolled in " + c);
+        return write(lk, [roll, code](sqlite3* w) { return db_enroll(w, roll, code); }, ok(201, std::move(o)));
+    }
+
+    HttpResponse unenroll(const std::string& r, const std::string& c) {
+        HttpResponse err;
+        RollId roll;
+        CourseId code;
+        if (!roll_of(r, roll, err) || !code_of(c, code, err)) return err;
+        Unique lk(mu_);
+        if (!remove_enrollment(data_, roll, code)) return error(404, r + " is not enrolled in " + c);
+        return write(lk, [roll, code](sqlite3* w) { return db_delete_enrollment(w, roll, code); }, ok(200, "{}"));
+    }
+
+    HttpResponse marks(const std::string& r, const std::string& c, const HttpRequest& req) {
+        HttpResponse err;
+        std::vector<JsonField> f;
+        RollId roll;
+        CourseId code;
+        double im = 0, fm = 0;
+        if (!roll_of(r, roll, err) || !code_of(c, code, err) || !body_of(req, f, err)
+            || !mark(f, "internal_mark", im, err) || !mark(f, "final_mark", fm, err)) return err;
+        std::string o;
+        put_grade(o, Grade{ roll, code, im, fm });
+        Unique lk(mu_);
+        if (!enter_marks(data_, roll, code, im, fm)) return error(404, r + " is not enrolled in " + c);
+        return write(lk, [roll, code, im, fm](sqlite3* w) { return db_enter_marks(w, roll, code, im, fm); },
+            ok(200, std::move(o)));
+    }
+
+    // ---- Reports -----------------------------------------------------------
+
+    // Same content as student_report (services.hpp): courses in code order.
+    HttpResponse student_report(const std::string& id) {
+        HttpResponse err;
+        RollId roll;
+        if (!roll_of(id, roll, err)) return err;
+        Shared lk(mu_);
+        const Student* s = find_student(data_, roll);
+        if (!s) return error(404, "no student " + id);
+        std::vector<std::uint32_t> slots = student_grade_slots(data_, roll);
+        std::sort(slots.begin(), slots.end(), [&](std::uint32_t a, std::uint32_t b) {
+            return data_.all_grades.course_code[a] < data_.all_grades.course_code[b];
+        });
+        std::string o = "{";
+        json_key(o, "roll_no"); json_string(o, id);
+        json_key(o, "name"); json_string(o, s->name);
+        json_key(o, "courses"); o += '[';
+        for (std::size_t i = 0; i < slots.size(); ++i) {
+            const Grade g = data_.all_grades[slots[i]];
+            const std::uint32_t cs = data_.grade_links[slots[i]].course;
+            const double w = g.weighted();
+            if (i) o += ',';
+            o += '{';
+            json_key(o, "course_code"); json_string(o, to_string(g.course_code));
+            json_key(o, "title"); json_string(o, cs == NO_SLOT ? std::string() : data_.all_courses[cs].title);
+            json_key(o, "internal_mark"); json_number(o, g.internal_mark);
+            json_key(o, "final_mark"); json_number(o, g.final_mark);
+            json_key(o, "weighted"); json_derived(o, w);
+            json_key(o, "passed"); o += w >= PASS_MARK ? "true" : "false";
+            o += '}';
+        }
+        o += ']';
+        put_stats(o, *student_stats(data_, roll), "courses_taken");
+        o += '}';
+        return ok(200, std::move(o));
+    }
+
+    // Same figures as course_report: the course's running aggregate.
+    HttpResponse course_report(const std::string& id) {
+        HttpResponse err;
+        CourseId code;
+        if (!code_of(id, code, err)) return err;
+        Shared lk(mu_);
+        const Course* c = find_course(data_, code);
+        if (!c) return error(404, "no course " + id);
+        std::string o = "{";
+        json_key(o, "code"); json_string(o, id);
+        json_key(o, "title"); json_string(o, c->title);
+        json_key(o, "teacher"); json_string(o, c->teacher);
+        put_stats(o, *course_stats(data_, code), "enrolled");
+        o += '}';
+        return ok(200, std::move(o));
+    }
+
+    // Same figures as school_summary: one kernel pass over the mark columns.
+    HttpResponse summary() {
+        Shared lk(mu_);
+        const GradeColumns& g = data_.all_grades;
+        const GradeStats st = grade_kernel(g.internal_mark.data(), g.final_mark.data(), g.size(), PASS_MARK);
+        std::string o = "{";
+        put_stats(o, st, "enrolled");
+        o += '}';
+        return ok(200, std::move(o));
+    }
+
+    HttpResponse counts() {
+        Shared lk(mu_);
+        std::string o = "{";
+        json_key(o, "students"); json_uint(o, data_.all_students.size());
+        json_key(o, "courses"); json_uint(o, data_.all_courses.size());
+        json_key(o, "enrollments"); json_uint(o, data_.all_grades.size());
+        o += '}';
+        return ok(200, std::move(o));
+    }
+
+    sqlite3* db_;
+    DataStore& data_;
+    std::shared_mutex mu_;     // shared: reads of data_; unique: cache change + queueing its write
+};
+
+// ==========================
+// Event loop
+// ==========================
+
+// epoll ids; connections count up from FIRST_CONN.
+constexpr std::uint64_t LISTEN_ID = 0, DONE_ID = 1, STOP_ID = 2, FIRST_CONN = 3;
+
+int g_stop_fd = -1;   // eventfd the signal handler pokes
+
+extern "C" void on_stop_signal(int) {
+    const std::uint64_t one = 1;
+    if (g_stop_fd >= 0) (void)!write(g_stop_fd, &one, sizeof one);
+}
+
+struct Conn {
+    int fd = -1;
+    std::string in;            // received, not yet parsed
+    std::string out;           // response bytes not yet sent
+    std::size_t sent = 0;
+    bool busy = false;         // a request is with the workers
+    bool close_after = false;  // close once `out` is sent
+    bool dead = false;         // peer gone while busy; drop on completion
+    bool eof = false;          // peer finished sending; close after the last reply
+};
+
+struct Job {
+    std::uint64_t conn;
+    HttpRequest req;
+};
+
+struct Done {
+    std::uint64_t conn;
+    std::string bytes;
+    bool close;
+};
+
+class Server {
+public:
+    Server(Api& api, unsigned workers) : api_(api), worker_count_(workers) {}
+
+    bool run(const HttpServerOptions& opt) {
+        if (!listen_on(opt)) return false;
+        epfd_ = epoll_create1(EPOLL_CLOEXEC);
+        done_fd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        stop_fd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        if (epfd_ < 0 || done_fd_ < 0 || stop_fd_ < 0) { close_all(); return false; }
+        watch(listen_fd_, LISTEN_ID, EPOLLIN, EPOLL_CTL_ADD);
+        watch(done_fd_, DONE_ID, EPOLLIN, EPOLL_CTL_ADD);
+        watch(stop_fd_, STOP_ID, EPOLLIN, EPOLL_CTL_ADD);
+
+        g_stop_fd = stop_fd_;
+        struct sigaction sa = {}, old_int = {}, old_term = {}, old_pipe = {};
+        sa.sa_handler = on_stop_signal;
+        sigemptyset(&sa.sa_mask);
+        sigaction(SIGINT, &sa, &old_int);
+        sigaction(SIGTERM, &sa, &old_term);
+        sa.sa_handler = SIG_IGN;
+        sigaction(SIGPIPE, &sa, &old_pipe);
+
+        for (unsigned i = 0; i < worker_count_; ++i) workers_.emplace_back([this] { work(); });
+        std::cout << "Serving http://" << opt.host << ":" << opt.port << "/ with " << worker_count_
+            << " workers; Ctrl+C to stop.\n" << std::flush;
+
+        std::vector<epoll_event> events(256);
+        bool stop = false;
+        while (!stop) {
+            const int n = epoll_wait(epfd_, events.data(), static_cast<int>(events.size()), -1);
+            if (n < 0 && errno == EINTR) continue;
+            if (n < 0) break;
+            for (int i = 0; i < n; ++i) {
+                const std::uint64_t id = events[i].data.u64;
+                if (id == LISTEN_ID) accept_all();
+                else if (id == DONE_ID) completed();
+                else if (id == STOP_ID) stop = true;
+                else on_event(id, events[i].events);
+            }
+        }
+
+        {
+            std::lock_guard<std::mutex> lk(jobs_m_);
+            stopping_ = true;
+        }
+        jobs_cv_.notify_all();
+        for (std::thread& t : workers_) t.join();
+        sigaction(SIGINT, &old_int, nullptr);
+        sigaction(SIGTERM, &old_term, nullptr);
+        sigaction(SIGPIPE, &old_pipe, nullptr);
+        g_stop_fd = -1;
+        close_all();
+        return true;
+    }
+
+private:
+    bool listen_on(const HttpServerOptions& opt) {
+        sockaddr_in addr = {};
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(static_cast<std::uint16_t>(opt.port));
+        if (inet_pton(AF_INET, opt.host.c_str(), &addr.sin_addr) != 1) return false;
+        listen_fd_ = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        if (listen_fd_ < 0) return false;
+        const int one = 1;
+        setsockopt(listen_fd_, SOL_SOCKET, SO_REUSEADDR, &one, sizeof one);
+        if (bind(listen_fd_, reinterpret_cast<sockaddr*>(&addr), sizeof addr) != 0 || listen(listen_fd_, SOMAXCONN) != 0) {
+            close(listen_fd_);
+            listen_fd_ = -1;
+            return false;
+        }
+        return true;
+    }
+
+    void watch(int fd, std::uint64_t id, std::uint32_t events, int op) {
+        epoll_event ev = {};
+        ev.events = events;
+        ev.data.u64 = id;
+        epoll_ctl(epfd_, op, fd, &ev);
+    }
+
+    void accept_all() {
+        for (;;) {
+            const int fd = accept4(listen_fd_, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+            if (fd < 0) return;   // EAGAIN, or out of descriptors until one closes
+            const int one = 1;
+            setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof one);
+            const std::uint64_t id = next_id_++;
+            conns_[id].fd = fd;
+            watch(fd, id, EPOLLIN | EPOLLRDHUP, EPOLL_CTL_ADD);
+        }
+    }
+
+    void drop(std::uint64_t id) {
+        auto it = conns_.find(id);
+        if (it == conns_.end()) return;
+        if (!it->second.dead) epoll_ctl(epfd_, EPOLL_CTL_DEL, it->second.fd, nullptr);
+        close(it->second.fd);
+        conns_.erase(it);
+    }
+
+    void on_event(std::uint64_t id, std::uint32_t events) {
+        auto it = conns_.find(id);
+        if (it == conns_.end()) return;
+        Conn& c = it->second;
+        if (c.busy) {
+            // Only HUP/ERR arrive while parked: stop watching, finish later.
+            if (events & (EPOLLHUP | EPOLLERR)) {
+                epoll_ctl(epfd_, EPOLL_CTL_DEL, c.fd, nullptr);
+                c.dead = true;
+            }
+            return;
+        }
+        if (events & EPOLLOUT) { flush(id, c); return; }
+        if (events & (EPOLLIN | EPOLLRDHUP | EPOLLHUP | EPOLLERR)) read_from(id, c);
+    }
+
+    void read_from(std::uint64_t id, Conn& c) {
+        char buf[64 * 1024];
+        for (;;) {
+            const ssize_t n = recv(c.fd, buf, sizeof buf, 0);
+            if (n > 0) { c.in.append(buf, static_cast<std::size_t>(n)); continue; }
+            if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) break;
+            if (n < 0 && errno == EINTR) continue;
+            if (n < 0) { drop(id); return; }   // reset
+            c.eof = true;   // half-close: still answer what was sent
+            break;
+        }
+        next_request(id, c);
+    }
+
+    // Hand the next complete request on `c` to the workers, or answer a
+    // malformed one and close; otherwise wait for more bytes.
+    void next_request(std::uint64_t id, Conn& c) {
+        Job job;
+        std::size_t used = 0;
+        const int r = parse_request(c.in, job.req, used);
+        if (r == 0) {
+            if (c.eof) drop(id);
+            else watch(c.fd, id, EPOLLIN | EPOLLRDHUP, EPOLL_CTL_MOD);
+            return;
+        }
+        if (r != 1) {
+            c.out = serialize(error(r, status_text(r)), false);
+            c.sent = 0;
+            c.close_after = true;
+            c.in.clear();
+            flush(id, c);
+            return;
+        }
+        c.in.erase(0, used);
+        c.busy = true;
+        watch(c.fd, id, 0, EPOLL_CTL_MOD);
+        job.conn = id;
+        {
+            std::lock_guard<std::mutex> lk(jobs_m_);
+            jobs_.push_back(std::move(job));
+        }
+        jobs_cv_.notify_one();
+    }
+
+    void flush(std::uint64_t id, Conn& c) {
+        while (c.sent < c.out.size()) {
+            const ssize_t n = send(c.fd, c.out.data() + c.sent, c.out.size() - c.sent, MSG_NOSIGNAL);
+            if (n > 0) { c.sent += static_cast<std::size_t>(n); continue; }
+            if (n < 0 && errno == EINTR) continue;
+            if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+                watch(c.fd, id, EPOLLOUT, EPOLL_CTL_MOD);
+                return;
+            }
+            drop(id);
+            return;
+        }
+        c.out.clear();
+        c.sent = 0;
+        if (c.close_after) { drop(id); return; }
+        next_request(id, c);   // a pipelined request may already be buffered
+    }
+
+    void completed() {
+        std::uint64_t count;
+        (void)!read(done_fd_, &count, sizeof count);
+        std::vector<Done> done;
+        {
+            std::lock_guard<std::mutex> lk(done_m_);
+            done.swap(done_);
+        }
+        for (Done& d : done) {
+            auto it = conns_.find(d.conn);
+            if (it == conns_.end()) continue;
+            Conn& c = it->second;
+            c.busy = false;
+            if (c.dead) { drop(d.conn); continue; }
+            c.out = std::move(d.bytes);
+            c.sent = 0;
+            c.close_after = d.close || c.eof;
+            flush(d.conn, c);
+        }
+    }
+
+    void work() {
+        for (;;) {
+            Job job;
+            {
+                std::unique_lock<std::mutex> lk(jobs_m_);
+                jobs_cv_.wait(lk, [this] { return stopping_ || !jobs_.empty(); });
+                if (jobs_.empty()) return;
+                job = std::move(jobs_.front());
+                jobs_.pop_front();
+            }
+            Done d{ job.conn, serialize(api_.handle(job.req), job.req.keep_alive), !job.req.keep_alive };
+            {
+                std::lock_guard<std::mutex> lk(done_m_);
+                done_.push_back(std::move(d));
+            }
+            const std::uint64_t one = 1;
+            (void)!write(done_fd_, &one, sizeof one);
+        }
+    }
+
+    void close_all() {
+        for (auto& kv : conns_) close(kv.second.fd);
+        conns_.clear();
+        for (int* fd : { &listen_fd_, &epfd_, &done_fd_, &stop_fd_ })
+            if (*fd >= 0) { close(*fd); *fd = -1; }
+    }
+
+    Api& api_;
+    unsigned worker_count_;
+    int listen_fd_ = -1, epfd_ = -1, done_fd_ = -1, stop_fd_ = -1;
+    std::unordered_map<std::uint64_t, Conn> conns_;   // loop thread only
+    std::uint64_t next_id_ = FIRST_CONN;
+
+    std::vector<std::thread> workers_;
+    std::mutex jobs_m_;
+    std::condition_variable jobs_cv_;
+    std::deque<Job> jobs_;
+    bool stopping_ = false;
+
+    std::mutex done_m_;
+    std::vector<Done> done_;
+};
+
+} // namespace
+
+bool http_serve(sqlite3* db, DataStore& data, const HttpServerOptions& options) {
+    unsigned workers = options.workers;
+    if (workers == 0) workers = std::max(4u, 2 * std::thread::hardware_concurrency());
+    Api api(db, data);
+    Server server(api, workers);
+    if (!server.run(options)) {
+        std::cout << "Could not listen on " << options.host << ":" << options.port << "\n";
+        return false;
+    }
+    return true;
+}
+
+#else
+
+bool http_serve(sqlite3*, DataStore&, const HttpServerOptions&) {
+    return false;   // not supported on this platform
+}
+
+#endif
@@ -0,0 +1,67 @@
+#pragma once
+#include <cstddef>
+#include <iosfwd>
+#include <string>
+#include <vector>
+#include "sqlite3.h"
+
+/*
+-------------------------------------------------------------------------------
+ batch_exec.hpp - Headless command scripts (`sms exec`)
+-------------------------------------------------------------------------------
+One command per line, words separated by blanks; a word with blanks in it is
+double-quoted ("" for a literal quote). Blank lines and lines starting with
+# are skipped.
+
+  add-student    <roll_no> <name> <address> <contact>
+  add-course     <code> <title> <description> <teacher>
+  edit-student   <roll_no> <name> <address> <contact>
+  edit-course    <code> <title> <description> <teacher>
+  enroll         <roll_no> <code>
+  marks          <roll_no> <code> <internal_mark> <final_mark>
+  unenroll       <roll_no> <code>
+  remove-student <roll_no>
+  remove-course  <code>
+  report student <roll_no>
+  report course  <code>
+  sync
+
+e.g.
+
+  add-student S120 "Aroha Ngata" "5 Tui St, Hamilton" 021-555-0101
+  enroll S120 MTH101
+  marks S120 MTH101 75 88
+
+Fields are checked with the same rules as the menu prompts and `sms import`
+(validation.hpp; marks 0..100). Writes do not wait for the disk: they are
+queued on the background writer (db_write_async), which commits whatever
+has queued up - up to 16384 writes - in one transaction while the next
+lines are parsed. `report` and `sync` wait until every earlier write has
+committed, so a report sees the script's own changes.
+
+A line that fails - bad syntax, or rejected by the database (duplicate key,
+unknown student/course, no such enrollment) - is reported with its line
+number and the script carries on with the next line.
+
+  ExecReport rep;
+  exec_script(db, std::cin, std::cout, rep);
+-------------------------------------------------------------------------------
+*/
+
+struct ExecError {
+    std::size_t line = 0;      // 1-based line in the script
+    std::string message;
+};
+
+struct ExecReport {
+    std::size_t commands = 0;  // lines run (no blanks or comments)
+    std::size_t writes = 0;    // of which queued to the writer
+    std::size_t failed = 0;    // == errors.size()
+    std::vector<ExecError> errors;   // in line order
+    double ms = 0;             // wall time, first line to last commit
+};
+
+/// Run the script read from `in` against `db`, writing report output to
+/// `out`. Starts the background writer (with large batches) if `db` has
+/// none. Returns false if any line failed.
+bool exec_script(sqlite3* db, std::istream& in, std::ostream& out, ExecReport& rep);
@@ -0,0 +1,62 @@
+#pragma once
+#include <cstddef>
+#include <string>
+#include <vector>
+#include "sqlite3.h"
+
+/*
+-------------------------------------------------------------------------------
+ csv_import.hpp - Bulk import of students, courses, enrollments and marks
+-------------------------------------------------------------------------------
+One CSV file per kind, one record per line, fields in this order:
+
+  students      roll_no,name,address,contact
+  courses       code,title,description,teacher
+  enrollments   roll_no,course_code
+  marks         roll_no,course_code,internal_mark,final_mark
+
+A first line naming the columns (starting "roll_no" / "code") is skipped, as
+are blank lines and a UTF-8 BOM. Fields may be quoted ("Flat 2, 10 High St",
+"" for a literal quote) but may not span lines. Unquoted fields are trimmed.
+
+Every field is checked with the same rule the menu prompts use
+(validation.hpp; marks 0..100), so an imported row is one a user could have
+typed. Rows that fail validation, or that the database rejects (duplicate
+key, unknown student/course, no such enrollment), are skipped and listed in
+the report with their line number; all other rows are imported.
+
+The file is memory-mapped and cut into chunks at line boundaries; worker
+threads parse and validate chunks while the calling thread writes finished
+chunks, in file order, one transaction per chunk (db_add_students and
+friends). Chunks already committed stay committed if a later one fails.
+
+  ImportReport rep;
+  csv_import(db, ImportKind::Students, "intake.csv", rep);
+  for (const ImportError& e : rep.errors) std::cout << e.line << ": " << e.message << "\n";
+-------------------------------------------------------------------------------
+*/
+
+enum class ImportKind { Students, Courses, Enrollments, Marks };
+
+/// "students", "courses", "enrollments" or "marks".
+bool parse_import_kind(const std::string& name, ImportKind& out);
+
+struct ImportError {
+    std::size_t line = 0;      // 1-based line in the input file
+    std::string message;
+};
+
+struct ImportReport {
+    std::size_t rows = 0;      // data rows seen (no header or blank lines)
+    std::size_t imported = 0;
+    std::size_t rejected = 0;  // == errors.size()
+    std::vector<ImportError> errors;   // in line order
+    unsigned threads = 0;      // parser threads used
+    double ms = 0;             // wall time, map to last commit
+};
+
+/// Import `path` into `db`. `threads` = 0 uses one parser per hardware
+/// thread. Returns false if the file cannot be mapped or a chunk's
+/// transaction fails (the report then covers the chunks before it).
+bool csv_import(sqlite3* db, ImportKind kind, const std::string& path,
+    ImportReport& out, unsigned threads = 0);
@@ -0,0 +1,63 @@
+#pragma once
+#include <cstddef>
+#include <string>
+#include "repository.hpp"
+
+/*
+-------------------------------------------------------------------------------
+ data_export.hpp - Stream the DataStore out as CSV or JSON
+-------------------------------------------------------------------------------
+Tables and columns:
+
+  students      roll_no, name, address, contact
+  courses       code, title, description, teacher
+  enrollments   roll_no, course_code, internal_mark, final_mark, weighted, passed
+
+CSV has a header line and quotes a field only when it contains a comma,
+quote or line break ("" for a literal quote), so students.csv and
+courses.csv can be fed straight back to `sms import`. JSON is an array of
+objects, one per line; "all" writes one object holding all three arrays.
+
+Marks are written with std::to_chars in shortest round-trip form, so they
+read back as the exact doubles in the store. weighted is derived (computed
+with grade_kernel, like the reports) and is written to 2 decimals; passed
+is weighted >= PASS_MARK.
+
+Arrow (enrollments only) is an Arrow IPC file - the layout pyarrow.feather,
+pandas, DuckDB and Polars read directly - with roll_no and course_code
+dictionary-encoded (int32 indexes into the students' / courses' codes, in
+store order) and internal_mark, final_mark, weighted as float64 columns,
+copied straight from the store's mark arrays. One record batch, no
+compression, written front to back with no seeks.
+
+Rows are formatted straight into a 1 MB buffer - no per-row strings or
+streams - and full buffers go to a background thread that writes them
+while the next one fills.
+
+  ExportReport rep;
+  export_store(data, ExportKind::Enrollments, ExportFormat::Csv, "grades.csv", rep);
+
+The store must not change while an export runs.
+-------------------------------------------------------------------------------
+*/
+
+enum class ExportKind { Students, Courses, Enrollments, All };
+enum class ExportFormat { Csv, Json, Arrow };
+
+/// "students", "courses", "enrollments" or "all" (JSON only).
+bool parse_export_kind(const std::string& name, ExportKind& out);
+
+/// "csv", "json" or "arrow".
+bool parse_export_format(const std::string& name, ExportFormat& out);
+
+struct ExportReport {
+    std::size_t rows = 0;      // rows across all tables written
+    std::size_t bytes = 0;
+    double ms = 0;             // wall time until the file is closed
+};
+
+/// Write `kind` from `data` to `path` (overwritten). Returns false if the
+/// file cannot be written, for ExportKind::All with CSV, or for Arrow with
+/// anything but ExportKind::Enrollments.
+bool export_store(const DataStore& data, ExportKind kind, ExportFormat format,
+    const std::string& path, ExportReport& out);
@@ -0,0 +1,180 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <utility>
+#include <vector>
+#include "keys.hpp"
+
+/*
+-------------------------------------------------------------------------------
+ flat_map.hpp - Open-addressing hash map for the DataStore indexes
+-------------------------------------------------------------------------------
+FlatMap<K, V> keeps its entries in one flat array (linear probing, load
+factor <= 1/2, power-of-two capacity). Compared with std::unordered_map it
+allocates once per growth instead of once per entry, so bulk-building an
+index over a million grades is several times faster and lookups touch one
+cache line.
+
+Each key type declares, through FlatKey<K>, a hash and one value that never
+occurs as a real key (used to mark empty cells):
+  RollId / CourseId   invalid id (v == 0)
+  std::uint64_t       0 (enrollment_key of two valid ids is never 0)
+  std::int64_t        INT64_MIN (SQLite never hands out that rowid)
+
+Erase uses backward shifting, so there are no tombstones and lookups stay
+short after many deletes. Pointers returned by find() are invalidated by
+any insert.
+
+The empty-cell value itself is never a key: find() and erase() report it
+as absent and insert() / set() refuse it, so an invalid id passed to a
+lookup cannot land on an empty cell and read its stale value.
+-------------------------------------------------------------------------------
+*/
+
+template <class K> struct FlatKey;
+
+namespace flat_detail {
+// 64-bit finalizer (MurmurHash3 fmix64): spreads sequential ids over the table.
+constexpr std::uint64_t mix(std::uint64_t x) {
+    x ^= x >> 33;
+    x *= 0xff51afd7ed558ccdull;
+    x ^= x >> 33;
+    x *= 0xc4ceb9fe1a85ec53ull;
+    x ^= x >> 33;
+    return x;
+}
+}
+
+template <> struct FlatKey<std::uint64_t> {
+    static constexpr std::uint64_t empty() { return 0; }
+    static constexpr std::uint64_t hash(std::uint64_t k) { return flat_detail::mix(k); }
+};
+template <> struct FlatKey<std::int64_t> {
+    static constexpr std::int64_t empty() { return std::numeric_limits<std::int64_t>::min(); }
+    static constexpr std::uint64_t hash(std::int64_t k) { return flat_detail::mix(static_cast<std::uint64_t>(k)); }
+};
+template <> struct FlatKey<RollId> {
+    static constexpr RollId empty() { return RollId{}; }
+    static constexpr std::uint64_t hash(RollId k) { return flat_detail::mix(k.v); }
+};
+template <> struct FlatKey<CourseId> {
+    static constexpr CourseId empty() { return CourseId{}; }
+    static constexpr std::uint64_t hash(CourseId k) { return flat_detail::mix(k.v); }
+};
+
+template <class K, class V>
+class FlatMap {
+public:
+    struct Entry {
+        K key;
+        V value;
+    };
+
+    size_t size() const { return size_; }
+    bool empty() const { return size_ == 0; }
+
+    void clear() {
+        cells_.clear();
+        mask_ = 0;
+        size_ = 0;
+    }
+
+    // Make room for `n` entries without rehashing.
+    void reserve(size_t n) {
+        size_t cap = 16;
+        while (cap < 2 * n) cap *= 2;
+        if (cap > cells_.size()) rehash(cap);
+    }
+
+    const V* find(const K& key) const {
+        if (cells_.empty() || key == FlatKey<K>::empty()) return nullptr;
+        for (size_t i = home(key);; i = (i + 1) & mask_) {
+            const Entry& e = cells_[i];
+            if (e.key == key) return &e.value;
+            if (e.key == FlatKey<K>::empty()) return nullptr;
+        }
+    }
+    V* find(const K& key) { return const_cast<V*>(static_cast<const FlatMap*>(this)->find(key)); }
+
+    bool contains(const K& key) const { return find(key) != nullptr; }
+
+    // Insert if absent. Returns false (and leaves the old value) on duplicate
+    // or on the empty-cell key.
+    bool insert(const K& key, const V& value) {
+        if (key == FlatKey<K>::empty()) return false;
+        grow_for_one();
+        Entry* e = probe(key);
+        if (e->key == key) return false;
+        e->key = key;
+        e->value = value;
+        ++size_;
+        return true;
+    }
+
+    // Insert or overwrite. Returns false (and stores nothing) on the
+    // empty-cell key.
+    bool set(const K& key, const V& value) {
+        if (key == FlatKey<K>::empty()) return false;
+        grow_for_one();
+        Entry* e = probe(key);
+        if (!(e->key == key)) { e->key = key; ++size_; }
+        e->value = value;
+        return true;
+    }
+
+    bool erase(const K& key) {
+        if (cells_.empty() || key == FlatKey<K>::empty()) return false;
+        size_t i = home(key);
+        for (;; i = (i + 1) & mask_) {
+            if (cells_[i].key == key) break;
+            if (cells_[i].key == FlatKey<K>::empty()) return false;
+        }
+        // Backward-shift: pull later entries of the same probe run into the hole.
+        for (size_t j = (i + 1) & mask_;; j = (j + 1) & mask_) {
+            if (cells_[j].key == FlatKey<K>::empty()) break;
+            const size_t h = home(cells_[j].key);
+            // Move j into i unless its home lies cyclically in (i, j].
+            const bool stays = (i <= j) ? (i < h && h <= j) : (i < h || h <= j);
+            if (!stays) { cells_[i] = cells_[j]; i = j; }
+        }
+        cells_[i].key = FlatKey<K>::empty();
+        --size_;
+        return true;
+    }
+
+    // Visit every (key, value); order is unspecified.
+    template <class F>
+    void for_each(F f) const {
+        for (const Entry& e : cells_)
+            if (!(e.key == FlatKey<K>::empty())) f(e.key, e.value);
+    }
+
+private:
+    size_t home(const K& key) const { return static_cast<size_t>(FlatKey<K>::hash(key)) & mask_; }
+
+    // Cell holding `key`, or the empty cell where it would go.
+    Entry* probe(const K& key) {
+        for (size_t i = home(key);; i = (i + 1) & mask_) {
+            Entry& e = cells_[i];
+            if (e.key == key || e.key == FlatKey<K>::empty()) return &e;
+        }
+    }
+
+    void grow_for_one() {
+        if (2 * (size_ + 1) > cells_.size()) rehash(cells_.empty() ? 16 : cells_.size() * 2);
+    }
+
+    void rehash(size_t cap) {
+        std::vector<Entry> old;
+        old.swap(cells_);
+        cells_.assign(cap, Entry{ FlatKey<K>::empty(), V{} });
+        mask_ = cap - 1;
+        for (const Entry& e : old)
+            if (!(e.key == FlatKey<K>::empty())) *probe(e.key) = e;
+    }
+
+    std::vector<Entry> cells_;
+    size_t mask_ = 0;
+    size_t size_ = 0;
+};
@@ -0,0 +1,49 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+/*
+-------------------------------------------------------------------------------
+ grade_kernel.hpp - Batch math over the grade columns
+-------------------------------------------------------------------------------
+Works on the contiguous internal_mark / final_mark arrays kept by DataStore
+(see GradeColumns in repository.hpp) instead of one Grade at a time.
+
+  weighted = 0.3 * internal + 0.7 * final      (same formula as Grade::weighted)
+  passed   = weighted >= pass_mark
+
+Implementation is picked at compile time:
+  - AVX2  (4 doubles per step) when built with /arch:AVX2 or -mavx2
+  - SSE2  (2 doubles per step) on any x64 build
+  - plain scalar loop elsewhere, or when GRADE_KERNEL_FORCE_SCALAR is defined
+Per-row results are bit-identical across the three paths. Only the order in
+which the sum is accumulated differs, so totals can differ in the last bits.
+-------------------------------------------------------------------------------
+*/
+
+/// Summary over a range of grades. min/max are 0 when count == 0.
+struct GradeStats {
+    double sum_weighted = 0.0;
+    std::size_t count = 0;
+    std::size_t passed = 0;
+    double min_weighted = 0.0;
+    double max_weighted = 0.0;
+
+    double average() const { return count ? sum_weighted / static_cast<double>(count) : 0.0; }
+};
+
+/// Default pass threshold used by reports.
+constexpr double PASS_MARK = 50.0;
+
+/// Process rows [0, n) of the two mark columns.
+/// `weighted_out` (n doubles) and `passed_out` (n bytes, 0/1) are optional.
+GradeStats grade_kernel(const double* internal_mark, const double* final_mark, std::size_t n,
+    double pass_mark, double* weighted_out = nullptr, std::uint8_t* passed_out = nullptr);
+
+/// Same summary for a scattered subset of rows (e.g. one student's grade
+/// slots from the adjacency lists).
+GradeStats grade_kernel_gather(const double* internal_mark, const double* final_mark,
+    const std::uint32_t* slots, std::size_t n, double pass_mark);
+
+/// Name of the compiled-in path ("avx2", "sse2" or "scalar"), for diagnostics.
+const char* grade_kernel_isa();
@@ -0,0 +1,70 @@
+#pragma once
+#include <string>
+#include "repository.hpp"
+#include "sqlite3.h"
+
+/*
+-------------------------------------------------------------------------------
+ http_server.hpp - Local HTTP/1.1 JSON API over the cache (`sms serve`)
+-------------------------------------------------------------------------------
+Several front-office terminals (or the portal) share one process and one
+warm DataStore instead of each running its own console copy.
+
+  GET    /students?offset=0&limit=100     {"total":N,"offset":0,"items":[student...]}
+  GET    /students/S001                   student
+  POST   /students                        {"roll_no","name","address","contact"}
+  PUT    /students/S001                   {"name","address","contact"}
+  DELETE /students/S001                   (grades go too, like the menu)
+  GET    /courses?offset=&limit=          {"total":N,"offset":0,"items":[course...]}
+  GET    /courses/MTH101                  course
+  POST   /courses                         {"code","title","description","teacher"}
+  PUT    /courses/MTH101                  {"title","description","teacher"}
+  DELETE /courses/MTH101
+  GET    /enrollments?offset=&limit=      {"total":N,"offset":0,"items":[enrollment...]}
+  GET    /enrollments/S001/MTH101         enrollment
+  POST   /enrollments                     {"roll_no","course_code"}
+  DELETE /enrollments/S001/MTH101
+  PUT    /marks/S001/MTH101               {"internal_mark":75,"final_mark":88}
+  GET    /reports/students/S001           transcript + average / passed
+  GET    /reports/courses/MTH101          enrolled / average / passed / lowest / highest
+  GET    /reports/summary                 the same figures over all enrollments
+  GET    /counts                          {"students":N,"courses":N,"enrollments":N}
+
+Bodies are flat JSON objects; ids are written as in the menu ("S001",
+"MTH101"). Fields are checked with the menu's rules (validation.hpp; marks
+0..100). Marks are returned exactly; weighted marks and report figures are
+rounded to 2 decimals. Errors are {"error":"..."} with 400 (invalid input),
+404 (no such student / course / enrollment, or route), 405, 409 (duplicate)
+or 500 (the database refused a write; the cache is then reloaded from it).
+
+Reads are answered from `data` under a shared lock. A write takes the lock
+exclusively just long enough to change the cache and queue the matching db_*
+call on the background writer (the menu's write-behind pattern), then waits
+for its commit before replying, so a 2xx means the change is in the file.
+Writes from concurrent requests share the writer's transactions.
+
+One thread runs an epoll loop (accept, read, parse, send; keep-alive and
+pipelining); complete requests go to a fixed pool of worker threads. The
+server listens on 127.0.0.1 only. Linux only (SMS_HAVE_HTTP); elsewhere
+http_serve returns false and main refuses `serve` and `loadtest` up front.
+-------------------------------------------------------------------------------
+*/
+
+// The one platform guard for the server (epoll, eventfd) and for the
+// load_test.hpp client that drives it.
+#if defined(__linux__)
+#define SMS_HAVE_HTTP 1
+#else
+#define SMS_HAVE_HTTP 0
+#endif
+
+struct HttpServerOptions {
+    std::string host = "127.0.0.1";
+    int port = 8080;
+    unsigned workers = 0;      // 0 = twice the hardware threads (at least 4)
+};
+
+/// Serve `data` (attached to `db` with db_sync_attach, with a running
+/// background writer) until SIGINT or SIGTERM. Returns false if the socket
+/// cannot be opened.
+bool http_serve(sqlite3* db, DataStore& data, const HttpServerOptions& options);
@@ -0,0 +1,193 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <ostream>
+#include <string>
+
+/*
+-------------------------------------------------------------------------------
+ keys.hpp - Packed 32-bit keys for roll numbers and course codes
+-------------------------------------------------------------------------------
+Roll numbers are always "S" + 3..6 digits and course codes are always
+2..4 uppercase letters + 3 digits (see validation.hpp). Both fit in 32 bits,
+so the models carry them as small integer types instead of std::string:
+
+  RollId    bit 31 = valid, bits 20..21 = digit count - 3, bits 0..19 = number
+            ("S001" and "S0001" stay distinct because the width is kept)
+  CourseId  bit 31 = valid, bits 10..29 = four letter slots in base 27
+            (A=1..Z=26, 0 = no letter; short prefixes are padded on the
+            right, so "PE" is P,E,0,0), bits 0..9 = number 0..999
+
+CourseIds sort like their text ("PE101" < "PEA101" < "PEB101"), because a
+missing letter packs lower than any letter just as a digit sorts before a
+letter in the text.
+
+A default-constructed id is invalid (v == 0). Comparing or hashing ids is a
+single integer operation. Convert to text only at the edges (DB binding,
+console output) with format_roll / format_course or operator<<.
+-------------------------------------------------------------------------------
+*/
+
+struct RollId {
+    std::uint32_t v = 0;
+    constexpr bool valid() const { return (v >> 31) != 0; }
+};
+
+struct CourseId {
+    std::uint32_t v = 0;
+    constexpr bool valid() const { return (v >> 31) != 0; }
+};
+
+constexpr bool operator==(RollId a, RollId b) { return a.v == b.v; }
+constexpr bool operator!=(RollId a, RollId b) { return a.v != b.v; }
+constexpr bool operator<(RollId a, RollId b) { return a.v < b.v; }
+constexpr bool operator==(CourseId a, CourseId b) { return a.v == b.v; }
+constexpr bool operator!=(CourseId a, CourseId b) { return a.v != b.v; }
+constexpr bool operator<(CourseId a, CourseId b) { return a.v < b.v; }
+
+// Longest text forms plus NUL: "S123456" and "ABCD123".
+constexpr std::size_t ROLL_TEXT_MAX = 8;
+constexpr std::size_t COURSE_TEXT_MAX = 8;
+
+// ==========================
+// Parse (text -> id)
+// ==========================
+
+// Parse "S" + 3..6 digits. Returns false (and leaves `out` untouched) otherwise.
+constexpr bool parse_roll(const char* s, std::size_t n, RollId& out) {
+    if (n < 4 || n > 7 || s[0] != 'S') return false;
+    std::uint32_t num = 0;
+    for (std::size_t i = 1; i < n; ++i) {
+        if (s[i] < '0' || s[i] > '9') return false;
+        num = num * 10 + static_cast<std::uint32_t>(s[i] - '0');
+    }
+    out.v = 0x80000000u | (static_cast<std::uint32_t>(n - 4) << 20) | num;
+    return true;
+}
+
+// Parse 2..4 uppercase letters + 3 digits.
+constexpr bool parse_course(const char* s, std::size_t n, CourseId& out) {
+    if (n < 5 || n > 7) return false;
+    const std::size_t alpha = n - 3;
+    std::uint32_t letters = 0, num = 0;
+    for (std::size_t i = 0; i < 4; ++i) {
+        std::uint32_t slot = 0;
+        if (i < alpha) {
+            if (s[i] < 'A' || s[i] > 'Z') return false;
+            slot = static_cast<std::uint32_t>(s[i] - 'A') + 1;
+        }
+        letters = letters * 27 + slot;
+    }
+    for (std::size_t i = alpha; i < n; ++i) {
+        if (s[i] < '0' || s[i] > '9') return false;
+        num = num * 10 + static_cast<std::uint32_t>(s[i] - '0');
+    }
+    out.v = 0x80000000u | (letters << 10) | num;
+    return true;
+}
+
+inline bool parse_roll(const std::string& s, RollId& out) { return parse_roll(s.data(), s.size(), out); }
+inline bool parse_course(const std::string& s, CourseId& out) { return parse_course(s.data(), s.size(), out); }
+
+// ==========================
+// Format (id -> text)
+// ==========================
+
+// Write the text form into `buf` (at least ROLL_TEXT_MAX bytes, NUL-terminated).
+// Returns the length, or 0 for an invalid id.
+constexpr std::size_t format_roll(RollId id, char* buf) {
+    if (!id.valid()) { buf[0] = '\0'; return 0; }
+    const std::size_t digits = ((id.v >> 20) & 0x3u) + 3;
+    std::uint32_t num = id.v & 0xFFFFFu;
+    buf[0] = 'S';
+    for (std::size_t i = digits; i > 0; --i) { buf[i] = static_cast<char>('0' + num % 10); num /= 10; }
+    buf[digits + 1] = '\0';
+    return digits + 1;
+}
+
+// `buf` must hold at least COURSE_TEXT_MAX bytes.
+constexpr std::size_t format_course(CourseId id, char* buf) {
+    if (!id.valid()) { buf[0] = '\0'; return 0; }
+    std::uint32_t letters = (id.v >> 10) & 0xFFFFFu;
+    std::uint32_t num = id.v & 0x3FFu;
+    char slots[4] = {};
+    for (std::size_t i = 4; i > 0; --i) { slots[i - 1] = static_cast<char>(letters % 27); letters /= 27; }
+    std::size_t n = 0;
+    for (std::size_t i = 0; i < 4 && slots[i] != 0; ++i) buf[n++] = static_cast<char>('A' + slots[i] - 1);
+    for (std::size_t i = n + 3; i > n; --i) { buf[i - 1] = static_cast<char>('0' + num % 10); num /= 10; }
+    buf[n + 3] = '\0';
+    return n + 3;
+}
+
+inline std::string to_string(RollId id) {
+    char buf[ROLL_TEXT_MAX];
+    return std::string(buf, format_roll(id, buf));
+}
+
+inline std::string to_string(CourseId id) {
+    char buf[COURSE_TEXT_MAX];
+    return std::string(buf, format_course(id, buf));
+}
+
+inline std::ostream& operator<<(std::ostream& os, RollId id) {
+    char buf[ROLL_TEXT_MAX];
+    format_roll(id, buf);
+    return os << buf;
+}
+
+inline std::ostream& operator<<(std::ostream& os, CourseId id) {
+    char buf[COURSE_TEXT_MAX];
+    format_course(id, buf);
+    return os << buf;
+}
+
+// Composite enrollment key: (roll_no, course_code) in one 64-bit integer.
+constexpr std::uint64_t enrollment_key(RollId r, CourseId c) {
+    return (static_cast<std::uint64_t>(r.v) << 32) | c.v;
+}
+
+constexpr RollId enrollment_roll(std::uint64_t k) { return RollId{ static_cast<std::uint32_t>(k >> 32) }; }
+constexpr CourseId enrollment_course(std::uint64_t k) { return CourseId{ static_cast<std::uint32_t>(k) }; }
+
+namespace std {
+template <> struct hash<RollId> {
+    size_t operator()(RollId id) const noexcept { return hash<uint32_t>()(id.v); }
+};
+template <> struct hash<CourseId> {
+    size_t operator()(CourseId id) const noexcept { return hash<uint32_t>()(id.v); }
+};
+}
+
+// Compile-time round trips keep the bit layout honest.
+namespace keys_detail {
+constexpr bool roll_round_trips(const char* s, std::size_t n) {
+    RollId id;
+    char buf[ROLL_TEXT_MAX] = {};
+    if (!parse_roll(s, n, id) || format_roll(id, buf) != n) return false;
+    for (std::size_t i = 0; i < n; ++i) if (buf[i] != s[i]) return false;
+    return true;
+}
+constexpr bool course_round_trips(const char* s, std::size_t n) {
+    CourseId id;
+    char buf[COURSE_TEXT_MAX] = {};
+    if (!parse_course(s, n, id) || format_course(id, buf) != n) return false;
+    for (std::size_t i = 0; i < n; ++i) if (buf[i] != s[i]) return false;
+    return true;
+}
+constexpr CourseId course(const char* s, std::size_t n) {
+    CourseId id;
+    parse_course(s, n, id);
+    return id;
+}
+}
+static_assert(keys_detail::roll_round_trips("S001", 4), "RollId layout");
+static_assert(keys_detail::roll_round_trips("S000000", 7), "RollId layout");
+static_assert(keys_detail::roll_round_trips("S999999", 7), "RollId layout");
+static_assert(keys_detail::course_round_trips("PE101", 5), "CourseId layout");
+static_assert(keys_detail::course_round_trips("MTH101", 6), "CourseId layout");
+static_assert(keys_detail::course_round_trips("ZZZ999", 6), "CourseId layout");
+static_assert(keys_detail::course_round_trips("AA000", 5), "CourseId layout");
+static_assert(keys_detail::course_round_trips("ZZZZ999", 7), "CourseId layout");
+static_assert(keys_detail::course("PE999", 5) < keys_detail::course("PEA000", 6)
+    && keys_detail::course("PEA999", 6) < keys_detail::course("PEB000", 6), "CourseId order");
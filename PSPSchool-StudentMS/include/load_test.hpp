@@ -0,0 +1,45 @@
+#pragma once
+#include <cstddef>
+#include <string>
+
+/*
+-------------------------------------------------------------------------------
+ load_test.hpp - HTTP load generator for `sms serve` (`sms loadtest`)
+-------------------------------------------------------------------------------
+Opens `connections` keep-alive connections, one thread each, and sends
+requests back to back for `seconds`. The targets are the first 1000
+enrollments (GET /enrollments?limit=1000), fetched once up front; each
+request picks one at random and is one of
+
+  GET /reports/students/<roll>   GET /reports/courses/<code>
+  GET /enrollments/<roll>/<code>
+
+or, for `write_percent` of requests, PUT /marks/<roll>/<code> with random
+marks. Writes change real data: point a write test at a copy of school.db.
+
+  LoadTestOptions opt;
+  opt.connections = 32;
+  LoadTestReport rep;
+  if (http_load_test(opt, rep)) std::cout << rep.requests / rep.seconds << " req/s\n";
+-------------------------------------------------------------------------------
+*/
+
+struct LoadTestOptions {
+    std::string host = "127.0.0.1";
+    int port = 8080;
+    int connections = 16;
+    double seconds = 10;
+    int write_percent = 0;     // 0..100
+};
+
+struct LoadTestReport {
+    std::size_t requests = 0;  // completed, any status
+    std::size_t writes = 0;
+    std::size_t errors = 0;    // non-2xx responses and broken connections
+    double seconds = 0;        // measured run time
+    double p50_ms = 0, p99_ms = 0, max_ms = 0;   // request latency
+};
+
+/// Run the test against a server on `host:port`. Returns false if it
+/// cannot connect or finds no enrollments to target.
+bool http_load_test(const LoadTestOptions& options, LoadTestReport& out);
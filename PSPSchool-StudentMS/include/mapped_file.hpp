@@ -0,0 +1,98 @@
+#pragma once
+#include <cstddef>
+#include <string>
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+/*
+-------------------------------------------------------------------------------
+ mapped_file.hpp - Read-only memory mapping of a whole file
+-------------------------------------------------------------------------------
+Maps a file into memory so readers (snapshot loader, importers) can parse it
+in place without copying it into a buffer first. Windows uses
+CreateFileMapping/MapViewOfFile, everything else mmap.
+
+  MappedFile f;
+  if (f.open("school.snap")) parse(f.data(), f.size());
+
+The mapping is released by close() or the destructor. Empty files cannot be
+mapped; open() returns false for them.
+-------------------------------------------------------------------------------
+*/
+
+class MappedFile {
+public:
+    MappedFile() = default;
+    ~MappedFile() { close(); }
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    bool open(const std::string& path) {
+        close();
+#ifdef _WIN32
+        file_ = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+            OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+        if (file_ == INVALID_HANDLE_VALUE) return false;
+        LARGE_INTEGER sz;
+        if (!GetFileSizeEx(file_, &sz) || sz.QuadPart == 0) { close(); return false; }
+        mapping_ = CreateFileMappingA(file_, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (!mapping_) { close(); return false; }
+        void* p = MapViewOfFile(mapping_, FILE_MAP_READ, 0, 0, 0);
+        if (!p) { close(); return false; }
+        data_ = static_cast<const unsigned char*>(p);
+        size_ = static_cast<std::size_t>(sz.QuadPart);
+#else
+        fd_ = ::open(path.c_str(), O_RDONLY);
+        if (fd_ < 0) return false;
+        struct stat st;
+        if (fstat(fd_, &st) != 0 || st.st_size == 0) { close(); return false; }
+        void* p = mmap(nullptr, static_cast<std::size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd_, 0);
+        if (p == MAP_FAILED) { close(); return false; }
+        data_ = static_cast<const unsigned char*>(p);
+        size_ = static_cast<std::size_t>(st.st_size);
+#endif
+        return true;
+    }
+
+    void close() {
+#ifdef _WIN32
+        if (data_) UnmapViewOfFile(data_);
+        if (mapping_) CloseHandle(mapping_);
+        if (file_ != INVALID_HANDLE_VALUE) CloseHandle(file_);
+        mapping_ = nullptr;
+        file_ = INVALID_HANDLE_VALUE;
+#else
+        if (data_) munmap(const_cast<unsigned char*>(data_), size_);
+        if (fd_ >= 0) ::close(fd_);
+        fd_ = -1;
+#endif
+        data_ = nullptr;
+        size_ = 0;
+    }
+
+    bool is_open() const { return data_ != nullptr; }
+    const unsigned char* data() const { return data_; }
+    std::size_t size() const { return size_; }
+
+private:
+    const unsigned char* data_ = nullptr;
+    std::size_t size_ = 0;
+#ifdef _WIN32
+    HANDLE file_ = INVALID_HANDLE_VALUE;
+    HANDLE mapping_ = nullptr;
+#else
+    int fd_ = -1;
+#endif
+};
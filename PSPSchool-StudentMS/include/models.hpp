@@ -1,5 +1,6 @@
 #pragma once
 #include <string>
+#include "keys.hpp"   // RollId / CourseId packed keys
 
 /*
 -------------------------------------------------------------------------------
@@ -11,13 +12,14 @@ Defines plain data structures for the three main entities in the system:
   - Grade (enrollment + marks)
 
 These are simple value types with public fields, suitable for storage in both
-SQLite tables and in-memory vectors (DataStore).
+SQLite tables and in-memory vectors (DataStore). Keys are packed 32-bit ids
+(keys.hpp); they are turned back into text only for the DB and the console.
 -------------------------------------------------------------------------------
 */
 
 // A student record
 struct Student {
-    std::string roll_no;   // primary key-like, e.g. S001
+    RollId roll_no;        // primary key-like, e.g. S001
     std::string name;
     std::string address;
     std::string contact;
@@ -25,7 +27,7 @@ struct Student {
 
 // A course record
 struct Course {
-    std::string code;        // primary key-like, e.g. MTH101
+    CourseId code;           // primary key-like, e.g. MTH101
     std::string title;
     std::string description;
     std::string teacher;
@@ -33,8 +35,8 @@ struct Course {
 
 // One grade record linking a student and a course
 struct Grade {
-    std::string roll_no;     // foreign key -> Student
-    std::string course_code; // foreign key -> Course
+    RollId roll_no;          // foreign key -> Student
+    CourseId course_code;    // foreign key -> Course
     double internal_mark{ 0.0 }; // 0..100, typically coursework/tests
     double final_mark{ 0.0 };    // 0..100, final exam
 
@@ -42,4 +44,7 @@ struct Grade {
     double weighted() const {
         return 0.3 * internal_mark + 0.7 * final_mark;
     }
-};
\ No newline at end of file
+};
+
+// Two packed keys + two marks: small enough to keep millions in cache.
+static_assert(sizeof(Grade) == 24, "Grade should stay 24 bytes");
@@ -0,0 +1,67 @@
+#pragma once
+#include <atomic>
+#include <utility>
+
+/*
+-------------------------------------------------------------------------------
+ mpsc_queue.hpp - Lock-free multi-producer / single-consumer FIFO
+-------------------------------------------------------------------------------
+Unbounded linked queue after Dmitry Vyukov's MPSC design. push() is one
+atomic exchange plus one store, safe from any number of threads at once;
+pop() must only ever be called by one thread (the consumer).
+
+The list always holds one "stub" node whose value was already taken; the
+consumer owns it and frees it when it moves past. A push that has done its
+exchange but not yet linked its node is invisible for that instant, so pop()
+can briefly report empty while a push is in flight. Callers that need to
+know whether work is outstanding keep their own counter.
+
+  MpscQueue<Job> q;
+  q.push(job);            // any thread
+  Job j;
+  while (q.pop(j)) run(j);   // consumer thread only
+-------------------------------------------------------------------------------
+*/
+
+template <class T>
+class MpscQueue {
+public:
+    MpscQueue() : head_(new Node()), tail_(head_.load(std::memory_order_relaxed)) {}
+    ~MpscQueue() {
+        while (tail_) {
+            Node* next = tail_->next.load(std::memory_order_relaxed);
+            delete tail_;
+            tail_ = next;
+        }
+    }
+    MpscQueue(const MpscQueue&) = delete;
+    MpscQueue& operator=(const MpscQueue&) = delete;
+
+    void push(T value) {
+        Node* n = new Node(std::move(value));
+        Node* prev = head_.exchange(n, std::memory_order_acq_rel);
+        prev->next.store(n, std::memory_order_release);
+    }
+
+    // Consumer only. Moves the oldest value into `out`; false if none is
+    // visible yet.
+    bool pop(T& out) {
+        Node* next = tail_->next.load(std::memory_order_acquire);
+        if (!next) return false;
+        out = std::move(next->value);
+        delete tail_;
+        tail_ = next;   // `next` becomes the new stub
+        return true;
+    }
+
+private:
+    struct Node {
+        Node() = default;
+        explicit Node(T v) : value(std::move(v)) {}
+        std::atomic<Node*> next{ nullptr };
+        T value{};
+    };
+
+    std::atomic<Node*> head_;   // last pushed node (producers)
+    Node* tail_;                // stub; its successor is the oldest value (consumer)
+};
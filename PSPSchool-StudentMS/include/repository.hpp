@@ -0,0 +1,473 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include <utility>
+#include "models.hpp"
+#include "flat_map.hpp"     // open-addressing key -> slot indexes
+#include "grade_kernel.hpp"  // GradeStats, PASS_MARK, gather kernel for rescans
+
+/*
+-------------------------------------------------------------------------------
+ repository.hpp - DataStore (in-memory cache) and its lookup indexes
+-------------------------------------------------------------------------------
+DataStore keeps every student, course and grade row in plain vectors so the
+UI can iterate them directly. Next to the vectors it keeps hash indexes from
+key to "slot" (position in the vector), which makes lookups by roll_no, code
+or (roll_no, course_code) O(1) on average. The indexes are FlatMaps
+(flat_map.hpp), so rebuilding them after a bulk load is a few passes over
+flat arrays rather than one allocation per row.
+
+Grades are stored column-wise (GradeColumns) so the mark columns are
+contiguous arrays for the SIMD kernel in grade_kernel.hpp.
+
+It also keeps adjacency lists: for every student slot, the grade slots of
+that student, and the same per course. Reports and cascading deletes walk
+only the k grades that belong to one student/course instead of all grades.
+Each grade remembers its position inside both lists (GradeLink), so removing
+a grade patches the lists in O(1).
+
+Finally it keeps running aggregates per student and per course (GradeAgg:
+sum of weighted grades, count, passed, min, max), updated by every grade
+insert / mark change / erase. Sum, count and passed are O(1) to maintain;
+min/max are O(1) unless the row that held the extreme leaves or moves
+inward, in which case that one student's/course's list is rescanned.
+
+Rules for contributors
+  - Read the vectors freely, but add/remove rows only through the store_*
+    functions below. They keep the indexes in step with the vectors.
+  - Removal swaps the last row into the freed slot and pops the back (O(1)).
+    The order of rows in the vectors is therefore not stable across deletes.
+  - A grade can only be inserted when its student and course are present;
+    erasing a student/course erases its grades too (mirrors ON DELETE CASCADE).
+  - Student/course fields that are not keys can be edited in place through
+    find_* pointers; grade marks change through store_set_marks. Never change
+    a key field in place; erase and re-insert instead.
+  - If you fill the vectors in bulk (e.g. db_load_all), call
+    store_rebuild_indexes once afterwards.
+-------------------------------------------------------------------------------
+*/
+
+// Sentinel for "no slot" (e.g. a grade loaded for a missing student).
+constexpr std::uint32_t NO_SLOT = 0xFFFFFFFFu;
+
+// Where one grade sits in the adjacency lists.
+struct GradeLink {
+    std::uint32_t student = NO_SLOT;      // slot in all_students
+    std::uint32_t student_pos = NO_SLOT;  // index inside grades_of_student[student]
+    std::uint32_t course = NO_SLOT;       // slot in all_courses
+    std::uint32_t course_pos = NO_SLOT;   // index inside grades_of_course[course]
+};
+
+// Running aggregate over the weighted grades of one student or course.
+// min/max are 0 while count == 0 (same convention as GradeStats).
+struct GradeAgg {
+    double sum_weighted = 0.0;
+    std::uint32_t count = 0;
+    std::uint32_t passed = 0;
+    double min_weighted = 0.0;
+    double max_weighted = 0.0;
+
+    double average() const { return count ? sum_weighted / count : 0.0; }
+};
+
+// Grade rows stored column by column (struct-of-arrays). The two mark
+// columns are contiguous doubles so batch math (grade_kernel.hpp) can stream
+// over them with SIMD. operator[] assembles a Grade by value for code that
+// wants a row; write through the store_* functions.
+struct GradeColumns {
+    std::vector<RollId>   roll_no;
+    std::vector<CourseId> course_code;
+    std::vector<double>   internal_mark;
+    std::vector<double>   final_mark;
+
+    size_t size() const { return roll_no.size(); }
+    bool empty() const { return roll_no.empty(); }
+
+    Grade operator[](size_t i) const {
+        return Grade{ roll_no[i], course_code[i], internal_mark[i], final_mark[i] };
+    }
+
+    void reserve(size_t n) {
+        roll_no.reserve(n); course_code.reserve(n);
+        internal_mark.reserve(n); final_mark.reserve(n);
+    }
+
+    void push_back(const Grade& g) {
+        roll_no.push_back(g.roll_no); course_code.push_back(g.course_code);
+        internal_mark.push_back(g.internal_mark); final_mark.push_back(g.final_mark);
+    }
+
+    // Copy row `src` over row `dst` (used by swap-and-pop removal).
+    void move_row(size_t dst, size_t src) {
+        roll_no[dst] = roll_no[src]; course_code[dst] = course_code[src];
+        internal_mark[dst] = internal_mark[src]; final_mark[dst] = final_mark[src];
+    }
+
+    void pop_back() {
+        roll_no.pop_back(); course_code.pop_back();
+        internal_mark.pop_back(); final_mark.pop_back();
+    }
+
+    void clear() {
+        roll_no.clear(); course_code.clear();
+        internal_mark.clear(); final_mark.clear();
+    }
+};
+
+// Our simple "database" / in-memory cache
+struct DataStore {
+    std::vector<Student> all_students;
+    std::vector<Course>  all_courses;
+    GradeColumns         all_grades;
+
+    // key -> slot in the vectors above
+    FlatMap<RollId, std::uint32_t> student_slot;             // roll_no
+    FlatMap<CourseId, std::uint32_t> course_slot;            // code
+    FlatMap<std::uint64_t, std::uint32_t> grade_slot;        // enrollment_key(roll_no, course_code)
+
+    // adjacency: grade slots per student/course slot (parallel to the vectors)
+    std::vector<std::vector<std::uint32_t>> grades_of_student;
+    std::vector<std::vector<std::uint32_t>> grades_of_course;
+    std::vector<GradeLink> grade_links;                      // parallel to all_grades
+
+    // running aggregates (parallel to all_students / all_courses)
+    std::vector<GradeAgg> student_agg;
+    std::vector<GradeAgg> course_agg;
+};
+
+// ==========================
+// Lookups (O(1) average)
+// ==========================
+
+inline const Student* find_student(const DataStore& d, RollId roll) {
+    const std::uint32_t* slot = d.student_slot.find(roll);
+    return slot ? &d.all_students[*slot] : nullptr;
+}
+
+inline Student* find_student(DataStore& d, RollId roll) {
+    const std::uint32_t* slot = d.student_slot.find(roll);
+    return slot ? &d.all_students[*slot] : nullptr;
+}
+
+inline const Course* find_course(const DataStore& d, CourseId code) {
+    const std::uint32_t* slot = d.course_slot.find(code);
+    return slot ? &d.all_courses[*slot] : nullptr;
+}
+
+inline Course* find_course(DataStore& d, CourseId code) {
+    const std::uint32_t* slot = d.course_slot.find(code);
+    return slot ? &d.all_courses[*slot] : nullptr;
+}
+
+// Slot of the (roll, code) grade row, or NO_SLOT if not enrolled.
+inline std::uint32_t find_grade_slot(const DataStore& d, RollId roll, CourseId code) {
+    const std::uint32_t* slot = d.grade_slot.find(enrollment_key(roll, code));
+    return slot ? *slot : NO_SLOT;
+}
+
+// Grade slots of one student / course (empty if the key is unknown).
+inline const std::vector<std::uint32_t>& student_grade_slots(const DataStore& d, RollId roll) {
+    static const std::vector<std::uint32_t> none;
+    const std::uint32_t* slot = d.student_slot.find(roll);
+    return slot ? d.grades_of_student[*slot] : none;
+}
+
+inline const std::vector<std::uint32_t>& course_grade_slots(const DataStore& d, CourseId code) {
+    static const std::vector<std::uint32_t> none;
+    const std::uint32_t* slot = d.course_slot.find(code);
+    return slot ? d.grades_of_course[*slot] : none;
+}
+
+// Aggregate of one student / course (nullptr if the key is unknown).
+inline const GradeAgg* student_stats(const DataStore& d, RollId roll) {
+    const std::uint32_t* slot = d.student_slot.find(roll);
+    return slot ? &d.student_agg[*slot] : nullptr;
+}
+
+inline const GradeAgg* course_stats(const DataStore& d, CourseId code) {
+    const std::uint32_t* slot = d.course_slot.find(code);
+    return slot ? &d.course_agg[*slot] : nullptr;
+}
+
+// ==========================
+// Aggregate maintenance
+// ==========================
+
+inline double store_weighted_at(const DataStore& d, size_t slot) {
+    return d.all_grades[slot].weighted();
+}
+
+// Recompute one aggregate from its adjacency list (full refresh; also
+// discards any rounding drift the running sum picked up).
+inline void agg_rescan(const DataStore& d, GradeAgg& a, const std::vector<std::uint32_t>& slots) {
+    GradeStats st = grade_kernel_gather(d.all_grades.internal_mark.data(),
+        d.all_grades.final_mark.data(), slots.data(), slots.size(), PASS_MARK);
+    a.sum_weighted = st.sum_weighted;
+    a.count = static_cast<std::uint32_t>(st.count);
+    a.passed = static_cast<std::uint32_t>(st.passed);
+    a.min_weighted = st.min_weighted;
+    a.max_weighted = st.max_weighted;
+}
+
+inline void agg_add(GradeAgg& a, double w) {
+    if (a.count == 0) { a.min_weighted = a.max_weighted = w; }
+    else {
+        if (w < a.min_weighted) a.min_weighted = w;
+        if (w > a.max_weighted) a.max_weighted = w;
+    }
+    a.sum_weighted += w;
+    ++a.count;
+    if (w >= PASS_MARK) ++a.passed;
+}
+
+// Take `w` out of `a`. `slots` is the owner's list *after* the row left it;
+// it is only walked when `w` was the current min or max.
+inline void agg_remove(const DataStore& d, GradeAgg& a, double w, const std::vector<std::uint32_t>& slots) {
+    if (--a.count == 0) { a = GradeAgg{}; return; }
+    a.sum_weighted -= w;
+    if (w >= PASS_MARK) --a.passed;
+    if (w <= a.min_weighted || w >= a.max_weighted) agg_rescan(d, a, slots);
+}
+
+// Replace `old_w` by `new_w`. `slots` already reflects the new marks.
+inline void agg_replace(const DataStore& d, GradeAgg& a, double old_w, double new_w,
+    const std::vector<std::uint32_t>& slots) {
+    a.sum_weighted += new_w - old_w;
+    if (old_w >= PASS_MARK) --a.passed;
+    if (new_w >= PASS_MARK) ++a.passed;
+    if ((old_w <= a.min_weighted && new_w > old_w) || (old_w >= a.max_weighted && new_w < old_w)) {
+        agg_rescan(d, a, slots);
+        return;
+    }
+    if (new_w < a.min_weighted) a.min_weighted = new_w;
+    if (new_w > a.max_weighted) a.max_weighted = new_w;
+}
+
+// ==========================
+// Mutations (keep indexes in step)
+// ==========================
+
+// Insert a row if its key is not present yet. Returns false on duplicate.
+inline bool store_insert_student(DataStore& d, const Student& s) {
+    if (!d.student_slot.insert(s.roll_no, static_cast<std::uint32_t>(d.all_students.size()))) return false;
+    d.all_students.push_back(s);
+    d.grades_of_student.emplace_back();
+    d.student_agg.emplace_back();
+    return true;
+}
+
+inline bool store_insert_course(DataStore& d, const Course& c) {
+    if (!d.course_slot.insert(c.code, static_cast<std::uint32_t>(d.all_courses.size()))) return false;
+    d.all_courses.push_back(c);
+    d.grades_of_course.emplace_back();
+    d.course_agg.emplace_back();
+    return true;
+}
+
+// Returns false on duplicate or if the student/course is not in the store.
+inline bool store_insert_grade(DataStore& d, const Grade& g) {
+    const std::uint32_t* s = d.student_slot.find(g.roll_no);
+    const std::uint32_t* c = d.course_slot.find(g.course_code);
+    if (!s || !c) return false;
+
+    GradeLink link;
+    link.student = *s;
+    link.course = *c;
+    const auto slot = static_cast<std::uint32_t>(d.all_grades.size());
+    if (!d.grade_slot.insert(enrollment_key(g.roll_no, g.course_code), slot)) return false;
+
+    auto& by_s = d.grades_of_student[link.student];
+    auto& by_c = d.grades_of_course[link.course];
+    link.student_pos = static_cast<std::uint32_t>(by_s.size());
+    link.course_pos = static_cast<std::uint32_t>(by_c.size());
+    by_s.push_back(slot);
+    by_c.push_back(slot);
+
+    d.all_grades.push_back(g);
+    d.grade_links.push_back(link);
+
+    const double w = g.weighted();
+    agg_add(d.student_agg[link.student], w);
+    agg_add(d.course_agg[link.course], w);
+    return true;
+}
+
+// Remove grade `slot` from one adjacency list by moving the list's last entry
+// into its position. `pos_of` selects student_pos or course_pos in a link.
+template <class PosOf>
+inline void store_unlink(DataStore& d, std::vector<std::uint32_t>& list, std::uint32_t pos, PosOf pos_of) {
+    const std::uint32_t moved = list.back();
+    list[pos] = moved;
+    pos_of(d.grade_links[moved]) = pos;
+    list.pop_back();
+}
+
+// Remove the grade at `slot` (swap-and-pop) and patch every structure.
+inline void store_erase_grade_at(DataStore& d, size_t slot) {
+    const GradeLink link = d.grade_links[slot];
+    if (link.student != NO_SLOT)
+        store_unlink(d, d.grades_of_student[link.student], link.student_pos,
+            [](GradeLink& l) -> std::uint32_t& { return l.student_pos; });
+    if (link.course != NO_SLOT)
+        store_unlink(d, d.grades_of_course[link.course], link.course_pos,
+            [](GradeLink& l) -> std::uint32_t& { return l.course_pos; });
+
+    // Row `slot` is still in place here, and the lists no longer contain it.
+    const double w = store_weighted_at(d, slot);
+    if (link.student != NO_SLOT) agg_remove(d, d.student_agg[link.student], w, d.grades_of_student[link.student]);
+    if (link.course != NO_SLOT) agg_remove(d, d.course_agg[link.course], w, d.grades_of_course[link.course]);
+
+    GradeColumns& cols = d.all_grades;
+    d.grade_slot.erase(enrollment_key(cols.roll_no[slot], cols.course_code[slot]));
+
+    const size_t last = cols.size() - 1;
+    if (slot != last) {
+        cols.move_row(slot, last);
+        d.grade_links[slot] = d.grade_links[last];
+        const GradeLink& m = d.grade_links[slot];
+        const auto s32 = static_cast<std::uint32_t>(slot);
+        if (m.student != NO_SLOT) d.grades_of_student[m.student][m.student_pos] = s32;
+        if (m.course != NO_SLOT) d.grades_of_course[m.course][m.course_pos] = s32;
+        d.grade_slot.set(enrollment_key(cols.roll_no[slot], cols.course_code[slot]), static_cast<std::uint32_t>(slot));
+    }
+    cols.pop_back();
+    d.grade_links.pop_back();
+}
+
+// Overwrite the marks of grade `slot` (keys stay as they are).
+inline void store_set_marks(DataStore& d, size_t slot, double internal_mark, double final_mark) {
+    const double old_w = store_weighted_at(d, slot);
+    d.all_grades.internal_mark[slot] = internal_mark;
+    d.all_grades.final_mark[slot] = final_mark;
+    const double new_w = store_weighted_at(d, slot);
+    if (new_w == old_w) return;
+
+    const GradeLink& link = d.grade_links[slot];
+    if (link.student != NO_SLOT)
+        agg_replace(d, d.student_agg[link.student], old_w, new_w, d.grades_of_student[link.student]);
+    if (link.course != NO_SLOT)
+        agg_replace(d, d.course_agg[link.course], old_w, new_w, d.grades_of_course[link.course]);
+}
+
+inline bool store_erase_grade(DataStore& d, RollId roll, CourseId code) {
+    const std::uint32_t* slot = d.grade_slot.find(enrollment_key(roll, code));
+    if (!slot) return false;
+    store_erase_grade_at(d, *slot);
+    return true;
+}
+
+// Erase a student and all of their grades. O(k) in that student's grades.
+inline bool store_erase_student(DataStore& d, RollId roll) {
+    const std::uint32_t* found = d.student_slot.find(roll);
+    if (!found) return false;
+    const size_t slot = *found;
+
+    auto& own = d.grades_of_student[slot];
+    while (!own.empty()) store_erase_grade_at(d, own.back());
+
+    d.student_slot.erase(roll);
+    const size_t last = d.all_students.size() - 1;
+    if (slot != last) {
+        d.all_students[slot] = std::move(d.all_students[last]);
+        d.grades_of_student[slot] = std::move(d.grades_of_student[last]);
+        d.student_agg[slot] = d.student_agg[last];
+        for (std::uint32_t g : d.grades_of_student[slot])
+            d.grade_links[g].student = static_cast<std::uint32_t>(slot);
+        d.student_slot.set(d.all_students[slot].roll_no, static_cast<std::uint32_t>(slot));
+    }
+    d.all_students.pop_back();
+    d.grades_of_student.pop_back();
+    d.student_agg.pop_back();
+    return true;
+}
+
+// Erase a course and all of its grades. O(k) in that course's grades.
+inline bool store_erase_course(DataStore& d, CourseId code) {
+    const std::uint32_t* found = d.course_slot.find(code);
+    if (!found) return false;
+    const size_t slot = *found;
+
+    auto& own = d.grades_of_course[slot];
+    while (!own.empty()) store_erase_grade_at(d, own.back());
+
+    d.course_slot.erase(code);
+    const size_t last = d.all_courses.size() - 1;
+    if (slot != last) {
+        d.all_courses[slot] = std::move(d.all_courses[last]);
+        d.grades_of_course[slot] = std::move(d.grades_of_course[last]);
+        d.course_agg[slot] = d.course_agg[last];
+        for (std::uint32_t g : d.grades_of_course[slot])
+            d.grade_links[g].course = static_cast<std::uint32_t>(slot);
+        d.course_slot.set(d.all_courses[slot].code, static_cast<std::uint32_t>(slot));
+    }
+    d.all_courses.pop_back();
+    d.grades_of_course.pop_back();
+    d.course_agg.pop_back();
+    return true;
+}
+
+// Drop all rows and indexes.
+inline void store_clear(DataStore& d) {
+    d.all_students.clear();
+    d.all_courses.clear();
+    d.all_grades.clear();
+    d.student_slot.clear();
+    d.course_slot.clear();
+    d.grade_slot.clear();
+    d.grades_of_student.clear();
+    d.grades_of_course.clear();
+    d.grade_links.clear();
+    d.student_agg.clear();
+    d.course_agg.clear();
+}
+
+// Rebuild every index from the vectors (after bulk-filling them). The
+// adjacency lists are built CSR-style: count per owner, reserve exactly,
+// then fill, so each list is allocated once at its final size.
+inline void store_rebuild_indexes(DataStore& d) {
+    d.student_slot.clear();
+    d.course_slot.clear();
+    d.grade_slot.clear();
+    d.student_slot.reserve(d.all_students.size());
+    d.course_slot.reserve(d.all_courses.size());
+    d.grade_slot.reserve(d.all_grades.size());
+    for (size_t i = 0; i < d.all_students.size(); ++i)
+        d.student_slot.insert(d.all_students[i].roll_no, static_cast<std::uint32_t>(i));
+    for (size_t i = 0; i < d.all_courses.size(); ++i)
+        d.course_slot.insert(d.all_courses[i].code, static_cast<std::uint32_t>(i));
+
+    d.grade_links.assign(d.all_grades.size(), GradeLink{});
+    std::vector<std::uint32_t> per_student(d.all_students.size(), 0);
+    std::vector<std::uint32_t> per_course(d.all_courses.size(), 0);
+    const GradeColumns& cols = d.all_grades;
+    for (size_t i = 0; i < cols.size(); ++i) {
+        d.grade_slot.insert(enrollment_key(cols.roll_no[i], cols.course_code[i]), static_cast<std::uint32_t>(i));
+        const std::uint32_t* s = d.student_slot.find(cols.roll_no[i]);
+        const std::uint32_t* c = d.course_slot.find(cols.course_code[i]);
+        GradeLink& link = d.grade_links[i];
+        if (s) {
+            link.student = *s;
+            link.student_pos = per_student[*s]++;
+        }
+        if (c) {
+            link.course = *c;
+            link.course_pos = per_course[*c]++;
+        }
+    }
+
+    d.grades_of_student.assign(d.all_students.size(), {});
+    d.grades_of_course.assign(d.all_courses.size(), {});
+    for (size_t i = 0; i < per_student.size(); ++i) d.grades_of_student[i].resize(per_student[i]);
+    for (size_t i = 0; i < per_course.size(); ++i) d.grades_of_course[i].resize(per_course[i]);
+    for (size_t i = 0; i < d.grade_links.size(); ++i) {
+        const GradeLink& link = d.grade_links[i];
+        const auto s32 = static_cast<std::uint32_t>(i);
+        if (link.student != NO_SLOT) d.grades_of_student[link.student][link.student_pos] = s32;
+        if (link.course != NO_SLOT) d.grades_of_course[link.course][link.course_pos] = s32;
+    }
+
+    d.student_agg.assign(d.all_students.size(), GradeAgg{});
+    d.course_agg.assign(d.all_courses.size(), GradeAgg{});
+    for (size_t i = 0; i < d.student_agg.size(); ++i) agg_rescan(d, d.student_agg[i], d.grades_of_student[i]);
+    for (size_t i = 0; i < d.course_agg.size(); ++i) agg_rescan(d, d.course_agg[i], d.grades_of_course[i]);
+}
@@ -3,22 +3,27 @@
 #include <algorithm>
 #include <iostream>
 #include "models.hpp"
+#include "repository.hpp"   // DataStore + find_* / store_* index helpers
+#include "grade_kernel.hpp" // batch weighted/pass math over the mark columns
 
 /*
 -------------------------------------------------------------------------------
  services.hpp - In-memory "service" helpers and simple store
 -------------------------------------------------------------------------------
 This header defines:
-  - DataStore: a simple in-memory cache of students, courses, and grades.
   - Small helper functions that operate on DataStore for common actions the
     UI needs (add/show/enroll/enter marks/report).
 
 Design notes
   - DataStore mirrors the SQLite database. DB remains the source of truth.
-    Callers should first perform the DB write; only if that succeeds should
-    they call the matching in-memory helper to keep the cache consistent.
-  - All helpers are inline and operate in O(n) time using std::find_if. For
-    larger datasets, consider replacing vectors with maps or adding indexes.
+    The menu writes behind: a mutating helper here changes the store at
+    once, and the matching db_* call is queued on the background writer
+    (db_write_async). When it commits, the sync hooks of an attached store
+    (db_sync_attach) apply the same row again, which changes nothing; if it
+    fails, db_writer_reconcile reloads the store from the database.
+  - All helpers are inline. Key lookups go through the DataStore hash
+    indexes (repository.hpp), so they are O(1) on average. Report headers
+    read the running per-student/per-course aggregates (GradeAgg).
   - All output is written to std::cout to keep the UI minimal for the console.
 
 Conventions
@@ -27,24 +32,13 @@ Conventions
 -------------------------------------------------------------------------------
 */
 
-// Our simple "database" / in-memory cache
-struct DataStore {
-    std::vector<Student> all_students;
-    std::vector<Course>  all_courses;
-    std::vector<Grade>   all_grades;
-};
-
 // ==========================
 // STUDENTS
 // ==========================
 
 // Add a student if roll_no is unique. Returns true on success.
 inline bool add_student(DataStore& data, const Student& s) {
-    auto it = std::find_if(data.all_students.begin(), data.all_students.end(),
-        [&](const Student& x) { return x.roll_no == s.roll_no; });
-    if (it != data.all_students.end()) return false; // already exists
-    data.all_students.push_back(s);
-    return true;
+    return store_insert_student(data, s); // false if roll_no already exists
 }
 
 // Print a simple list of students to stdout.
@@ -70,11 +64,7 @@ inline void show_students(const DataStore& data) {
 
 // Add a course if code is unique. Returns true on success.
 inline bool add_course(DataStore& data, const Course& c) {
-    auto it = std::find_if(data.all_courses.begin(), data.all_courses.end(),
-        [&](const Course& x) { return x.code == c.code; });
-    if (it != data.all_courses.end()) return false;
-    data.all_courses.push_back(c);
-    return true;
+    return store_insert_course(data, c);
 }
 
 // Print a simple list of courses to stdout.
@@ -90,21 +80,10 @@ inline void show_courses(const DataStore& data) {
 
 // Enroll a student in a course by creating a Grade row with 0 marks.
 // Returns false if student/course does not exist or duplicate enrollment.
-inline bool enroll_student(DataStore& data, const std::string& roll_no, const std::string& course_code) {
-    auto s = std::find_if(data.all_students.begin(), data.all_students.end(),
-        [&](const Student& x) { return x.roll_no == roll_no; });
-    if (s == data.all_students.end()) return false;
-
-    auto c = std::find_if(data.all_courses.begin(), data.all_courses.end(),
-        [&](const Course& x) { return x.code == course_code; });
-    if (c == data.all_courses.end()) return false;
-
-    auto dup = std::find_if(data.all_grades.begin(), data.all_grades.end(),
-        [&](const Grade& g) { return g.roll_no == roll_no && g.course_code == course_code; });
-    if (dup != data.all_grades.end()) return false;
-
-    data.all_grades.push_back(Grade{ roll_no, course_code, 0.0, 0.0 });
-    return true;
+inline bool enroll_student(DataStore& data, RollId roll_no, CourseId course_code) {
+    if (!find_student(data, roll_no)) return false;
+    if (!find_course(data, course_code)) return false;
+    return store_insert_grade(data, Grade{ roll_no, course_code, 0.0, 0.0 }); // false on duplicate
 }
 
 // ==========================
@@ -112,14 +91,12 @@ inline bool enroll_student(DataStore& data, const std::string& roll_no, const st
 // ==========================
 
 // Enter or replace marks for an existing enrollment. Returns true on success.
-inline bool enter_marks(DataStore& data, const std::string& roll_no, const std::string& course_code,
+inline bool enter_marks(DataStore& data, RollId roll_no, CourseId course_code,
     double internal, double final) {
     if (internal < 0 || internal > 100 || final < 0 || final > 100) return false;
-    auto it = std::find_if(data.all_grades.begin(), data.all_grades.end(),
-        [&](const Grade& g) { return g.roll_no == roll_no && g.course_code == course_code; });
-    if (it == data.all_grades.end()) return false;
-    it->internal_mark = internal;
-    it->final_mark = final;
+    std::uint32_t slot = find_grade_slot(data, roll_no, course_code);
+    if (slot == NO_SLOT) return false;
+    store_set_marks(data, slot, internal, final);
     return true;
 }
 
@@ -127,41 +104,58 @@ inline bool enter_marks(DataStore& data, const std::string& roll_no, const std::
 // REPORTING
 // ==========================
 
-// Print a simple per-student report: lists each enrolled course and marks.
-inline void student_report(const DataStore& data, const std::string& roll_no) {
-    auto s = std::find_if(data.all_students.begin(), data.all_students.end(),
-        [&](const Student& x) { return x.roll_no == roll_no; });
-    if (s == data.all_students.end()) { std::cout << "Student not found.\n"; return; }
+// Print a simple per-student report: lists each enrolled course (by course
+// code) and marks. db_student_report (db.hpp) prints the same text straight
+// from SQL; `sms --check-reports` compares the two.
+inline void student_report(const DataStore& data, RollId roll_no, std::ostream& out = std::cout) {
+    const Student* s = find_student(data, roll_no);
+    if (!s) { out << "Student not found.\n"; return; }
+
+    out << "Student: " << s->name << " (" << s->roll_no << ")\n";
 
-    std::cout << "Student: " << s->name << " (" << s->roll_no << ")\n";
+    // Only this student's grades, via the adjacency list (O(k), not O(all grades)).
+    std::vector<std::uint32_t> slots = student_grade_slots(data, roll_no);
+    std::sort(slots.begin(), slots.end(), [&](std::uint32_t a, std::uint32_t b) {
+        return data.all_grades.course_code[a] < data.all_grades.course_code[b];
+    });
     bool any = false;
-    for (const auto& g : data.all_grades) {
-        if (g.roll_no != roll_no) continue;
+    for (std::uint32_t gi : slots) {
+        const Grade g = data.all_grades[gi];
         any = true;
-        auto c = std::find_if(data.all_courses.begin(), data.all_courses.end(),
-            [&](const Course& x) { return x.code == g.course_code; });
-        std::string title = (c == data.all_courses.end()) ? g.course_code : c->title;
-        std::cout << " - " << title
+        const std::uint32_t cs = data.grade_links[gi].course;
+        out << " - ";
+        if (cs == NO_SLOT) out << g.course_code; else out << data.all_courses[cs].title;
+        out
             << " | internal=" << g.internal_mark
             << " final=" << g.final_mark
             << " grade=" << g.weighted() << "\n";
     }
 
-    double total = 0.0;
-    int n = 0, passed = 0;
-    for (const auto& g : data.all_grades) {
-        if (g.roll_no != roll_no) continue;
-        double w = g.weighted();
-        total += w; ++n;
-        if (w >= 50.0) ++passed; // choose your pass threshold
-    }
-    if (n > 0) {
-        std::cout << "Overall average: " << (total / n)
-            << " | Courses: " << n
-            << " | Passed: " << passed << "/" << n << "\n";
+    // Header figures come from the running aggregate; no rescan here.
+    const GradeAgg& st = *student_stats(data, roll_no);
+    if (st.count > 0) {
+        out << "Overall average: " << st.average()
+            << " | Courses: " << st.count
+            << " | Passed: " << st.passed << "/" << st.count << "\n";
     }
 
-    if (!any) std::cout << "No courses enrolled.\n";
+    if (!any) out << "No courses enrolled.\n";
+}
+
+// Print a per-course summary (enrolled, average, pass count, min/max) from
+// the course's running aggregate. O(1): nothing is scanned.
+inline void course_report(const DataStore& data, CourseId code, std::ostream& out = std::cout) {
+    const Course* c = find_course(data, code);
+    if (!c) { out << "Course not found.\n"; return; }
+
+    out << "Course: " << c->title << " (" << c->code << ") - " << c->teacher << "\n";
+    const GradeAgg& st = *course_stats(data, code);
+    if (st.count == 0) { out << "No students enrolled.\n"; return; }
+    out << "Enrolled: " << st.count
+        << " | Average: " << st.average()
+        << " | Passed: " << st.passed << "/" << st.count << "\n"
+        << "Lowest: " << st.min_weighted
+        << " | Highest: " << st.max_weighted << "\n";
 }
 
 // ==========================
@@ -172,7 +166,8 @@ inline void show_enrollments(const DataStore& data) {
         std::cout << "No enrollments.\n";
         return;
     }
-    for (const auto& g : data.all_grades) {
+    for (size_t i = 0; i < data.all_grades.size(); ++i) {
+        const Grade g = data.all_grades[i];
         std::cout << g.roll_no << " -> " << g.course_code
             << " | internal=" << g.internal_mark
             << " final=" << g.final_mark
@@ -180,3 +175,23 @@ inline void show_enrollments(const DataStore& data) {
     }
 }
 
+// ==========================
+// SCHOOL SUMMARY (all grades)
+// ==========================
+
+// Institution-wide average and pass rate. Runs the batch kernel over the
+// contiguous mark columns in one pass instead of assembling each Grade.
+inline void school_summary(const DataStore& data) {
+    if (data.all_grades.empty()) {
+        std::cout << "No enrollments.\n";
+        return;
+    }
+    const GradeColumns& g = data.all_grades;
+    GradeStats st = grade_kernel(g.internal_mark.data(), g.final_mark.data(), g.size(), PASS_MARK);
+    std::cout << "Enrolments: " << st.count
+        << " | Average: " << st.average()
+        << " | Passed: " << st.passed << "/" << st.count
+        << " (" << (100.0 * static_cast<double>(st.passed) / static_cast<double>(st.count)) << "%)\n"
+        << "Lowest: " << st.min_weighted
+        << " | Highest: " << st.max_weighted << "\n";
+}
@@ -0,0 +1,56 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "repository.hpp"
+
+/*
+-------------------------------------------------------------------------------
+ snapshot.hpp - Binary startup snapshot of DataStore
+-------------------------------------------------------------------------------
+A snapshot is the DataStore written out column by column so the next start
+can rebuild it from one memory-mapped file instead of materialising every
+row through SQLite. The layout (all little-endian, sections 8-byte aligned):
+
+  header    magic "PSPSNAP1", format version, byte-order tag,
+            stamp (db_id, user_version, change_seq), row counts,
+            payload size and a 64-bit checksum of the payload
+  students  rowid[n]  roll[n]  text_len[3n]        (name, address, contact)
+  courses   rowid[n]  code[n]  text_len[3n]        (title, description, teacher)
+  grades    rowid[n]  internal[n]  final[n]  roll[n]  course[n]
+  text      every string above, back to back
+
+The stamp says which database state the rows reflect. db.cpp compares it
+with the live database (db_sync_attach) and either uses the snapshot as is,
+replays the few rows changed since (via the sms_changes log), or ignores it.
+The snapshot is a cache: delete it at any time and the next start does a
+full load.
+-------------------------------------------------------------------------------
+*/
+
+/// Which database state a snapshot was taken from.
+struct SnapshotStamp {
+    std::int64_t db_id = 0;         // random id stored in sms_meta when the DB was created
+    std::int64_t user_version = 0;  // PRAGMA user_version (schema version)
+    std::int64_t change_seq = 0;    // last sms_changes.seq the rows include
+};
+
+/// SQLite rowid of every row, parallel to the DataStore vectors. The sync
+/// layer needs them to map later updates/deletes back to keys.
+struct SnapshotRowids {
+    std::vector<std::int64_t> students;
+    std::vector<std::int64_t> courses;
+    std::vector<std::int64_t> grades;
+};
+
+/// Write `store` to `path` (via a temp file + rename, so a crash never leaves
+/// a half-written snapshot). Returns false on I/O error.
+bool snapshot_save(const std::string& path, const DataStore& store,
+    const SnapshotRowids& rowids, const SnapshotStamp& stamp);
+
+/// Map `path`, check magic/version/checksum and that its stamp belongs to the
+/// database described by `db_now` (same db_id and user_version, change_seq not
+/// ahead of it), then fill `store` and `rowids`. `stamp` receives the file's
+/// stamp. On any mismatch returns false and leaves `store` empty.
+bool snapshot_load(const std::string& path, const SnapshotStamp& db_now,
+    DataStore& store, SnapshotRowids& rowids, SnapshotStamp& stamp);
@@ -0,0 +1,35 @@
+#pragma once
+#include "sqlite3.h"
+#include "repository.hpp"
+
+/*
+-------------------------------------------------------------------------------
+ store_vtab.hpp - The in-memory DataStore as read-only SQL tables
+-------------------------------------------------------------------------------
+store_vtab_register() adds three eponymous virtual tables to a connection.
+They read the DataStore in place (nothing is copied into SQLite) and vanish
+with the connection; nothing is written to the database file.
+
+  mem_students  (roll_no, name, address, contact)
+  mem_courses   (code, title, description, teacher)
+  mem_grades    (roll_no, course_code, internal_mark, final_mark, weighted)
+
+The rowid is the row's slot in the DataStore vector. Equality on a key
+column is answered from the store's hash indexes (student_slot, course_slot,
+grade_slot, and the per-student / per-course grade lists), so
+
+  SELECT s.name, g.weighted FROM mem_grades g
+    JOIN mem_students s ON s.roll_no = g.roll_no
+   WHERE g.course_code = 'MTH101';
+
+is one adjacency-list walk plus one hash lookup per row. Anything else is a
+scan of the vectors. Writes fail ("table may not be modified").
+
+The store must outlive the connection's use of these tables and must not be
+modified while a statement over them is running.
+-------------------------------------------------------------------------------
+*/
+
+/// Register mem_students / mem_courses / mem_grades on `db`, reading `store`.
+/// Returns false if SQLite refuses the modules.
+bool store_vtab_register(sqlite3* db, const DataStore& store);
@@ -0,0 +1,246 @@
+#include "load_test.hpp"
+#include "http_server.hpp"   // SMS_HAVE_HTTP
+
+/*
+-------------------------------------------------------------------------------
+ load_test.cpp - Blocking keep-alive HTTP client threads for load_test.hpp
+-------------------------------------------------------------------------------
+Each thread owns one connection and records the latency of every request;
+the per-thread lists are merged and sorted for the percentiles at the end.
+A broken connection counts as an error and is reopened.
+-------------------------------------------------------------------------------
+*/
+
+#if SMS_HAVE_HTTP
+
+#include <algorithm>
+#include <charconv>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <random>
+#include <thread>
+#include <utility>
+#include <vector>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+using Target = std::pair<std::string, std::string>;   // roll_no, course_code
+
+class Client {
+public:
+    Client(const std::string& host, int port) : host_(host), port_(port) {}
+    ~Client() { disconnect(); }
+    Client(const Client&) = delete;
+    Client& operator=(const Client&) = delete;
+
+    // Send one request and read the whole response. Returns the status, or
+    // -1 if the connection failed (it is reopened on the next call).
+    int request(const char* method, const std::string& path, const std::string& body, std::string& resp) {
+        if (fd_ < 0 && !connect_now()) return -1;
+        std::string req;
+        req.reserve(128 + body.size());
+        req += method;
+        req += ' ';
+        req += path;
+        req += " HTTP/1.1\r\nHost: ";
+        req += host_;
+        if (!body.empty()) {
+            req += "\r\nContent-Type: application/json\r\nContent-Length: ";
+            req += std::to_string(body.size());
+        }
+        req += "\r\n\r\n";
+        req += body;
+        if (!send_all(req)) { disconnect(); return -1; }
+        const int status = read_response(resp);
+        if (status < 0) disconnect();
+        return status;
+    }
+
+private:
+    bool connect_now() {
+        sockaddr_in addr = {};
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(static_cast<std::uint16_t>(port_));
+        if (inet_pton(AF_INET, host_.c_str(), &addr.sin_addr) != 1) return false;
+        fd_ = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (fd_ < 0) return false;
+        if (connect(fd_, reinterpret_cast<sockaddr*>(&addr), sizeof addr) != 0) { disconnect(); return false; }
+        const int one = 1;
+        setsockopt(fd_, IPPROTO_TCP, TCP_NODELAY, &one, sizeof one);
+        return true;
+    }
+
+    void disconnect() {
+        if (fd_ >= 0) close(fd_);
+        fd_ = -1;
+        in_.clear();
+    }
+
+    bool send_all(const std::string& s) {
+        std::size_t done = 0;
+        while (done < s.size()) {
+            const ssize_t n = send(fd_, s.data() + done, s.size() - done, MSG_NOSIGNAL);
+            if (n < 0 && errno == EINTR) continue;
+            if (n <= 0) return false;
+            done += static_cast<std::size_t>(n);
+        }
+        return true;
+    }
+
+    bool fill() {
+        char buf[16 * 1024];
+        for (;;) {
+            const ssize_t n = recv(fd_, buf, sizeof buf, 0);
+            if (n < 0 && errno == EINTR) continue;
+            if (n <= 0) return false;
+            in_.append(buf, static_cast<std::size_t>(n));
+            return true;
+        }
+    }
+
+    int read_response(std::string& body) {
+        std::size_t head_end;
+        while ((head_end = in_.find("\r\n\r\n")) == std::string::npos)
+            if (!fill()) return -1;
+        int status = -1;
+        if (in_.compare(0, 9, "HTTP/1.1 ") == 0) std::from_chars(in_.data() + 9, in_.data() + 12, status);
+        std::size_t length = 0;
+        bool close_after = false;
+        for (std::size_t p = in_.find("\r\n") + 2; p < head_end;) {
+            const std::size_t e = std::min(in_.find("\r\n", p), head_end);
+            const std::string line = in_.substr(p, e - p);
+            if (line.compare(0, 16, "Content-Length: ") == 0)
+                std::from_chars(line.data() + 16, line.data() + line.size(), length);
+            else if (line == "Connection: close")
+                close_after = true;
+            p = e + 2;
+        }
+        const std::size_t end = head_end + 4 + length;
+        while (in_.size() < end)
+            if (!fill()) return -1;
+        body.assign(in_, head_end + 4, length);
+        in_.erase(0, end);
+        if (close_after) disconnect();
+        return status;
+    }
+
+    std::string host_;
+    int port_;
+    int fd_ = -1;
+    std::string in_;           // received, not yet consumed
+};
+
+// Pull the (roll_no, course_code) pairs out of a GET /enrollments page.
+std::vector<Target> parse_targets(const std::string& json) {
+    std::vector<Target> out;
+    auto value_after = [&](const char* key, std::size_t& p, std::string& v) {
+        p = json.find(key, p);
+        if (p == std::string::npos) return false;
+        p += std::strlen(key);
+        const std::size_t e = json.find('"', p);
+        if (e == std::string::npos) return false;
+        v.assign(json, p, e - p);
+        p = e;
+        return true;
+    };
+    std::size_t p = 0;
+    Target t;
+    while (value_after("\"roll_no\":\"", p, t.first) && value_after("\"course_code\":\"", p, t.second))
+        out.push_back(t);
+    return out;
+}
+
+struct ThreadResult {
+    std::vector<double> ms;
+    std::size_t writes = 0;
+    std::size_t errors = 0;
+};
+
+void run_connection(const LoadTestOptions& opt, const std::vector<Target>& targets,
+    Clock::time_point until, unsigned seed, ThreadResult& out) {
+    Client client(opt.host, opt.port);
+    std::mt19937 rng(seed);
+    std::uniform_int_distribution<std::size_t> pick(0, targets.size() - 1);
+    std::uniform_int_distribution<int> percent(0, 99);
+    std::uniform_int_distribution<int> mark(0, 100);
+    std::string path, body, resp;
+    while (Clock::now() < until) {
+        const Target& t = targets[pick(rng)];
+        const bool write = percent(rng) < opt.write_percent;
+        const char* method = "GET";
+        body.clear();
+        if (write) {
+            method = "PUT";
+            path = "/marks/" + t.first + "/" + t.second;
+            body = "{\"internal_mark\":" + std::to_string(mark(rng)) + ",\"final_mark\":" + std::to_string(mark(rng)) + "}";
+            ++out.writes;
+        }
+        else {
+            switch (percent(rng) % 3) {
+            case 0: path = "/reports/students/" + t.first; break;
+            case 1: path = "/reports/courses/" + t.second; break;
+            default: path = "/enrollments/" + t.first + "/" + t.second; break;
+            }
+        }
+        const auto t0 = Clock::now();
+        const int status = client.request(method, path, body, resp);
+        out.ms.push_back(std::chrono::duration<double, std::milli>(Clock::now() - t0).count());
+        if (status < 200 || status > 299) ++out.errors;
+    }
+}
+
+} // namespace
+
+bool http_load_test(const LoadTestOptions& options, LoadTestReport& out) {
+    out = LoadTestReport();
+    std::vector<Target> targets;
+    {
+        Client probe(options.host, options.port);
+        std::string body;
+        if (probe.request("GET", "/enrollments?limit=1000", "", body) != 200) return false;
+        targets = parse_targets(body);
+    }
+    if (targets.empty()) return false;
+
+    const int n = std::max(1, options.connections);
+    std::vector<ThreadResult> results(static_cast<std::size_t>(n));
+    std::vector<std::thread> threads;
+    const auto t0 = Clock::now();
+    const auto until = t0 + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(options.seconds));
+    for (int i = 0; i < n; ++i)
+        threads.emplace_back(run_connection, std::cref(options), std::cref(targets), until,
+            static_cast<unsigned>(i + 1), std::ref(results[static_cast<std::size_t>(i)]));
+    for (std::thread& t : threads) t.join();
+    out.seconds = std::chrono::duration<double>(Clock::now() - t0).count();
+
+    std::vector<double> all;
+    for (ThreadResult& r : results) {
+        all.insert(all.end(), r.ms.begin(), r.ms.end());
+        out.writes += r.writes;
+        out.errors += r.errors;
+    }
+    out.requests = all.size();
+    if (!all.empty()) {
+        std::sort(all.begin(), all.end());
+        out.p50_ms = all[all.size() / 2];
+        out.p99_ms = all[std::min(all.size() - 1, all.size() * 99 / 100)];
+        out.max_ms = all.back();
+    }
+    return true;
+}
+
+#else
+
+bool http_load_test(const LoadTestOptions&, LoadTestReport& out) {
+    out = LoadTestReport();
+    return false;   // not supported on this platform
+}
+
+#endif
@@ -0,0 +1,256 @@
+#include "snapshot.hpp"
+#include "mapped_file.hpp"
+#include <cstdio>
+#include <cstring>
+#include <type_traits>
+
+/*
+-------------------------------------------------------------------------------
+ snapshot.cpp - Writer and memory-mapped reader for the DataStore snapshot
+-------------------------------------------------------------------------------
+See snapshot.hpp for the file layout. The reader never trusts the file: every
+section is bounds-checked against the mapping and the payload checksum is
+verified before anything is copied into the store.
+-------------------------------------------------------------------------------
+*/
+
+namespace {
+
+constexpr char MAGIC[8] = { 'P', 'S', 'P', 'S', 'N', 'A', 'P', '1' };
+constexpr std::uint32_t FORMAT_VERSION = 2;   // 2: CourseId holds 2..4 letters
+constexpr std::uint32_t ENDIAN_TAG = 0x01020304u;
+
+struct Header {
+    char magic[8];
+    std::uint32_t version;
+    std::uint32_t byte_order;
+    std::int64_t db_id;
+    std::int64_t user_version;
+    std::int64_t change_seq;
+    std::uint64_t students;
+    std::uint64_t courses;
+    std::uint64_t grades;
+    std::uint64_t payload_bytes;
+    std::uint64_t checksum;
+};
+static_assert(sizeof(Header) == 80, "snapshot header layout");
+static_assert(std::is_trivially_copyable<RollId>::value && sizeof(RollId) == 4, "RollId is written raw");
+static_assert(std::is_trivially_copyable<CourseId>::value && sizeof(CourseId) == 4, "CourseId is written raw");
+
+// 64-bit checksum, four independent lanes of 8 bytes so it runs at memory
+// speed. Detects truncation and corruption; not a cryptographic hash.
+std::uint64_t checksum64(const unsigned char* p, std::size_t n) {
+    const std::uint64_t K = 0x9E3779B97F4A7C15ull;
+    std::uint64_t h[4] = { K, K + 1, K + 2, K + 3 };
+    auto mix = [K](std::uint64_t x, std::uint64_t w) {
+        x ^= w;
+        x *= K;
+        return (x << 31) | (x >> 33);
+    };
+    std::size_t i = 0;
+    for (; i + 32 <= n; i += 32) {
+        for (int l = 0; l < 4; ++l) {
+            std::uint64_t w;
+            std::memcpy(&w, p + i + 8 * l, 8);
+            h[l] = mix(h[l], w);
+        }
+    }
+    for (int l = 0; i < n; i += 8, l = (l + 1) & 3) {
+        std::uint64_t w = 0;
+        std::memcpy(&w, p + i, n - i < 8 ? n - i : 8);
+        h[l] = mix(h[l], w);
+    }
+    std::uint64_t r = n;
+    for (std::uint64_t x : h) { r = (r ^ x) * K; r ^= r >> 29; }
+    return r;
+}
+
+// Append-only payload builder; every section starts 8-byte aligned.
+struct Writer {
+    std::vector<unsigned char> buf;
+
+    void put(const void* p, std::size_t bytes) {
+        const auto* b = static_cast<const unsigned char*>(p);
+        buf.insert(buf.end(), b, b + bytes);
+        buf.resize((buf.size() + 7) & ~std::size_t(7), 0);
+    }
+    template <class T>
+    void put(const std::vector<T>& v) { if (!v.empty()) put(v.data(), v.size() * sizeof(T)); }
+};
+
+// Bounds-checked cursor over the mapped payload.
+struct Reader {
+    const unsigned char* p;
+    std::size_t left;
+
+    const unsigned char* take(std::size_t bytes) {
+        const std::size_t padded = (bytes + 7) & ~std::size_t(7);
+        if (padded < bytes || padded > left) return nullptr;
+        const unsigned char* r = p;
+        p += padded;
+        left -= padded;
+        return r;
+    }
+    // Copy `n` elements into `out` (resized); false if the file is short.
+    template <class T>
+    bool column(std::vector<T>& out, std::uint64_t n) {
+        if (n > left / sizeof(T)) return false;   // also stops absurd counts before allocating
+        out.resize(static_cast<std::size_t>(n));
+        if (n == 0) return true;
+        const unsigned char* src = take(static_cast<std::size_t>(n) * sizeof(T));
+        if (!src) return false;
+        std::memcpy(out.data(), src, static_cast<std::size_t>(n) * sizeof(T));
+        return true;
+    }
+};
+
+void append_text(std::string& text, std::vector<std::uint32_t>& lens, const std::string& s) {
+    text += s;
+    lens.push_back(static_cast<std::uint32_t>(s.size()));
+}
+
+} // namespace
+
+bool snapshot_save(const std::string& path, const DataStore& store,
+    const SnapshotRowids& rowids, const SnapshotStamp& stamp) {
+    const auto& S = store.all_students;
+    const auto& C = store.all_courses;
+    const auto& G = store.all_grades;
+    if (rowids.students.size() != S.size() || rowids.courses.size() != C.size() ||
+        rowids.grades.size() != G.size()) return false;
+
+    Writer w;
+    std::string text;
+    w.buf.reserve(S.size() * 24 + C.size() * 24 + G.size() * 32 + 64);
+
+    std::vector<std::uint32_t> lens;
+    lens.reserve(S.size() * 3);
+    std::vector<RollId> rolls;
+    rolls.reserve(S.size());
+    for (const Student& s : S) {
+        rolls.push_back(s.roll_no);
+        append_text(text, lens, s.name);
+        append_text(text, lens, s.address);
+        append_text(text, lens, s.contact);
+    }
+    w.put(rowids.students);
+    w.put(rolls);
+    w.put(lens);
+
+    lens.clear();
+    std::vector<CourseId> codes;
+    codes.reserve(C.size());
+    for (const Course& c : C) {
+        codes.push_back(c.code);
+        append_text(text, lens, c.title);
+        append_text(text, lens, c.description);
+        append_text(text, lens, c.teacher);
+    }
+    w.put(rowids.courses);
+    w.put(codes);
+    w.put(lens);
+
+    w.put(rowids.grades);
+    w.put(G.internal_mark);
+    w.put(G.final_mark);
+    w.put(G.roll_no);
+    w.put(G.course_code);
+
+    const std::uint64_t text_bytes = text.size();
+    w.put(&text_bytes, sizeof(text_bytes));
+    if (!text.empty()) w.put(text.data(), text.size());
+
+    Header h{};
+    std::memcpy(h.magic, MAGIC, sizeof(MAGIC));
+    h.version = FORMAT_VERSION;
+    h.byte_order = ENDIAN_TAG;
+    h.db_id = stamp.db_id;
+    h.user_version = stamp.user_version;
+    h.change_seq = stamp.change_seq;
+    h.students = S.size();
+    h.courses = C.size();
+    h.grades = G.size();
+    h.payload_bytes = w.buf.size();
+    h.checksum = checksum64(w.buf.data(), w.buf.size());
+
+    const std::string tmp = path + ".tmp";
+    std::FILE* f = std::fopen(tmp.c_str(), "wb");
+    if (!f) return false;
+    bool ok = std::fwrite(&h, sizeof(h), 1, f) == 1 &&
+        std::fwrite(w.buf.data(), 1, w.buf.size(), f) == w.buf.size();
+    ok = (std::fclose(f) == 0) && ok;
+    if (!ok) { std::remove(tmp.c_str()); return false; }
+
+    std::remove(path.c_str());   // rename() does not replace on Windows
+    if (std::rename(tmp.c_str(), path.c_str()) != 0) { std::remove(tmp.c_str()); return false; }
+    return true;
+}
+
+bool snapshot_load(const std::string& path, const SnapshotStamp& db_now,
+    DataStore& store, SnapshotRowids& rowids, SnapshotStamp& stamp) {
+    store_clear(store);
+    MappedFile file;
+    if (!file.open(path) || file.size() < sizeof(Header)) return false;
+
+    Header h;
+    std::memcpy(&h, file.data(), sizeof(h));
+    if (std::memcmp(h.magic, MAGIC, sizeof(MAGIC)) != 0 || h.version != FORMAT_VERSION ||
+        h.byte_order != ENDIAN_TAG) return false;
+    stamp.db_id = h.db_id;
+    stamp.user_version = h.user_version;
+    stamp.change_seq = h.change_seq;
+
+    // Cheap checks first: a snapshot of another DB/schema, or one from the
+    // future (DB restored from an older copy), is useless.
+    if (h.db_id != db_now.db_id || h.user_version != db_now.user_version ||
+        h.change_seq > db_now.change_seq) return false;
+    if (h.payload_bytes != file.size() - sizeof(Header)) return false;
+
+    Reader r{ file.data() + sizeof(Header), static_cast<std::size_t>(h.payload_bytes) };
+    if (checksum64(r.p, r.left) != h.checksum) return false;
+
+    std::vector<RollId> rolls;
+    std::vector<CourseId> codes;
+    std::vector<std::uint32_t> student_lens, course_lens;
+    GradeColumns& G = store.all_grades;
+    const bool columns_ok =
+        r.column(rowids.students, h.students) && r.column(rolls, h.students) &&
+        r.column(student_lens, h.students * 3) &&
+        r.column(rowids.courses, h.courses) && r.column(codes, h.courses) &&
+        r.column(course_lens, h.courses * 3) &&
+        r.column(rowids.grades, h.grades) &&
+        r.column(G.internal_mark, h.grades) && r.column(G.final_mark, h.grades) &&
+        r.column(G.roll_no, h.grades) && r.column(G.course_code, h.grades);
+    const unsigned char* tb = columns_ok ? r.take(sizeof(std::uint64_t)) : nullptr;
+    std::uint64_t text_bytes = 0;
+    if (tb) std::memcpy(&text_bytes, tb, sizeof(text_bytes));
+    const char* text = tb && text_bytes ? reinterpret_cast<const char*>(r.take(static_cast<std::size_t>(text_bytes))) : "";
+    if (!tb || !text) { store_clear(store); return false; }
+
+    // Walk the text with the length arrays; reject if they overrun it.
+    std::size_t off = 0;
+    auto next = [&](const std::vector<std::uint32_t>& lens, std::size_t i, std::string& out) {
+        if (lens[i] > text_bytes - off) return false;
+        out.assign(text + off, lens[i]);
+        off += lens[i];
+        return true;
+    };
+    store.all_students.resize(rolls.size());
+    for (std::size_t i = 0; i < rolls.size(); ++i) {
+        Student& s = store.all_students[i];
+        s.roll_no = rolls[i];
+        if (!next(student_lens, 3 * i, s.name) || !next(student_lens, 3 * i + 1, s.address) ||
+            !next(student_lens, 3 * i + 2, s.contact)) { store_clear(store); return false; }
+    }
+    store.all_courses.resize(codes.size());
+    for (std::size_t i = 0; i < codes.size(); ++i) {
+        Course& c = store.all_courses[i];
+        c.code = codes[i];
+        if (!next(course_lens, 3 * i, c.title) || !next(course_lens, 3 * i + 1, c.description) ||
+            !next(course_lens, 3 * i + 2, c.teacher)) { store_clear(store); return false; }
+    }
+    if (off != text_bytes) { store_clear(store); return false; }
+
+    store_rebuild_indexes(store);
+    return true;
+}
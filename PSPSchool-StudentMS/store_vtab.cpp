@@ -0,0 +1,287 @@
+#include "store_vtab.hpp"
+#include <cstdint>
+#include <new>
+
+/*
+-------------------------------------------------------------------------------
+ store_vtab.cpp - sqlite3_module implementation for store_vtab.hpp
+-------------------------------------------------------------------------------
+One module per table (eponymous-only: xCreate is null, so the module name is
+the table name). xBestIndex looks for usable equality constraints on the key
+columns and encodes which ones it took in idxNum; xFilter turns them into a
+list of slots from the store's indexes. Only BINARY comparisons qualify: a
+key text parses to exactly one id, so a value that does not parse can match
+no row, while under NOCASE (or any other collation) "s001" equals "S001" and
+is left to the scan. The constraints are not marked "omit", so SQLite
+re-checks them, and the result is always exactly what a scan would give.
+-------------------------------------------------------------------------------
+*/
+
+namespace {
+
+enum MemTable { MT_STUDENTS, MT_COURSES, MT_GRADES };
+
+const char* const TABLE_DDL[] = {
+    "CREATE TABLE x(roll_no TEXT, name TEXT, address TEXT, contact TEXT)",
+    "CREATE TABLE x(code TEXT, title TEXT, description TEXT, teacher TEXT)",
+    "CREATE TABLE x(roll_no TEXT, course_code TEXT, internal_mark REAL, final_mark REAL, weighted REAL)",
+};
+
+// idxNum bits: which key equalities xFilter receives, in argv order.
+constexpr int IDX_ROLL = 1;     // students.roll_no / grades.roll_no
+constexpr int IDX_COURSE = 2;   // courses.code / grades.course_code
+
+// Column number of the roll / course key in each table (-1: none).
+constexpr int ROLL_COL[] = { 0, -1, 0 };
+constexpr int COURSE_COL[] = { -1, 0, 1 };
+
+// pAux of each module: the store and which vector the table shows.
+struct MemAux {
+    const DataStore* store;
+    MemTable table;
+};
+
+struct MemVtab {
+    sqlite3_vtab base;   // must come first
+    const MemAux* aux;
+};
+
+// Rows to visit: all slots [0, n), or `n` slots listed at `list`.
+struct MemCursor {
+    sqlite3_vtab_cursor base;   // must come first
+    const MemAux* aux;
+    const std::uint32_t* list;
+    std::uint32_t one;          // storage for a single-slot lookup
+    std::size_t n;
+    std::size_t i;
+
+    std::uint32_t slot() const { return list ? list[i] : static_cast<std::uint32_t>(i); }
+};
+
+std::size_t table_rows(const MemAux& a) {
+    switch (a.table) {
+    case MT_STUDENTS: return a.store->all_students.size();
+    case MT_COURSES: return a.store->all_courses.size();
+    default: return a.store->all_grades.size();
+    }
+}
+
+int mem_connect(sqlite3* db, void* pAux, int, const char* const*, sqlite3_vtab** out, char**) {
+    const MemAux* aux = static_cast<const MemAux*>(pAux);
+    int rc = sqlite3_declare_vtab(db, TABLE_DDL[aux->table]);
+    if (rc != SQLITE_OK) return rc;
+    MemVtab* vt = new (std::nothrow) MemVtab{};
+    if (!vt) return SQLITE_NOMEM;
+    vt->aux = aux;
+    *out = &vt->base;
+    sqlite3_vtab_config(db, SQLITE_VTAB_INNOCUOUS);
+    return SQLITE_OK;
+}
+
+int mem_disconnect(sqlite3_vtab* vt) {
+    delete reinterpret_cast<MemVtab*>(vt);
+    return SQLITE_OK;
+}
+
+int mem_best_index(sqlite3_vtab* vt, sqlite3_index_info* info) {
+    const MemAux& aux = *reinterpret_cast<MemVtab*>(vt)->aux;
+    int roll = -1, course = -1;
+    for (int k = 0; k < info->nConstraint; ++k) {
+        const auto& c = info->aConstraint[k];
+        if (!c.usable || c.op != SQLITE_INDEX_CONSTRAINT_EQ) continue;
+        const char* coll = sqlite3_vtab_collation(info, k);
+        if (coll && sqlite3_stricmp(coll, "BINARY") != 0) continue;   // the index only knows exact keys
+        if (c.iColumn == ROLL_COL[aux.table] && roll < 0) roll = k;
+        if (c.iColumn == COURSE_COL[aux.table] && course < 0) course = k;
+    }
+    int argc = 0;
+    info->idxNum = 0;
+    if (roll >= 0) { info->idxNum |= IDX_ROLL; info->aConstraintUsage[roll].argvIndex = ++argc; }
+    if (course >= 0) { info->idxNum |= IDX_COURSE; info->aConstraintUsage[course].argvIndex = ++argc; }
+    // Shown by EXPLAIN QUERY PLAN ("VIRTUAL TABLE INDEX 1:roll").
+    static const char* const IDX_NAME[] = { "", "roll", "course", "roll,course" };
+    info->idxStr = const_cast<char*>(IDX_NAME[info->idxNum]);
+
+    const double rows = static_cast<double>(table_rows(aux));
+    // One key of a keyed table, or both keys of a grade: a unique hash hit.
+    const bool unique = (aux.table != MT_GRADES && info->idxNum) || info->idxNum == (IDX_ROLL | IDX_COURSE);
+    if (unique) {
+        info->estimatedRows = 1;
+        info->estimatedCost = 1;
+        info->idxFlags = SQLITE_INDEX_SCAN_UNIQUE;
+    }
+    else if (info->idxNum) {
+        // One student's or one course's grade list.
+        info->estimatedRows = 25;
+        info->estimatedCost = 25;
+    }
+    else {
+        info->estimatedRows = static_cast<sqlite3_int64>(rows);
+        info->estimatedCost = rows + 1;
+    }
+    return SQLITE_OK;
+}
+
+int mem_open(sqlite3_vtab* vt, sqlite3_vtab_cursor** out) {
+    MemCursor* cur = new (std::nothrow) MemCursor{};
+    if (!cur) return SQLITE_NOMEM;
+    cur->aux = reinterpret_cast<MemVtab*>(vt)->aux;
+    *out = &cur->base;
+    return SQLITE_OK;
+}
+
+int mem_close(sqlite3_vtab_cursor* c) {
+    delete reinterpret_cast<MemCursor*>(c);
+    return SQLITE_OK;
+}
+
+bool value_roll(sqlite3_value* v, RollId& out) {
+    const char* t = reinterpret_cast<const char*>(sqlite3_value_text(v));
+    return t && parse_roll(t, static_cast<std::size_t>(sqlite3_value_bytes(v)), out);
+}
+
+bool value_course(sqlite3_value* v, CourseId& out) {
+    const char* t = reinterpret_cast<const char*>(sqlite3_value_text(v));
+    return t && parse_course(t, static_cast<std::size_t>(sqlite3_value_bytes(v)), out);
+}
+
+int mem_filter(sqlite3_vtab_cursor* c, int idxNum, const char*, int argc, sqlite3_value** argv) {
+    MemCursor& cur = *reinterpret_cast<MemCursor*>(c);
+    const DataStore& d = *cur.aux->store;
+    cur.i = 0;
+    cur.list = nullptr;
+    cur.n = 0;
+    if (idxNum == 0) { cur.n = table_rows(*cur.aux); return SQLITE_OK; }
+
+    RollId roll;
+    CourseId course;
+    int a = 0;
+    if ((idxNum & IDX_ROLL) && (a >= argc || !value_roll(argv[a++], roll))) return SQLITE_OK;
+    if ((idxNum & IDX_COURSE) && (a >= argc || !value_course(argv[a++], course))) return SQLITE_OK;
+
+    const std::uint32_t* hit = nullptr;
+    switch (cur.aux->table) {
+    case MT_STUDENTS: hit = d.student_slot.find(roll); break;
+    case MT_COURSES: hit = d.course_slot.find(course); break;
+    case MT_GRADES:
+        if (idxNum == (IDX_ROLL | IDX_COURSE)) { hit = d.grade_slot.find(enrollment_key(roll, course)); break; }
+        const std::vector<std::uint32_t>& list =
+            idxNum == IDX_ROLL ? student_grade_slots(d, roll) : course_grade_slots(d, course);
+        cur.list = list.data();
+        cur.n = list.size();
+        return SQLITE_OK;
+    }
+    if (hit) {
+        cur.one = *hit;
+        cur.list = &cur.one;
+        cur.n = 1;
+    }
+    return SQLITE_OK;
+}
+
+int mem_next(sqlite3_vtab_cursor* c) {
+    ++reinterpret_cast<MemCursor*>(c)->i;
+    return SQLITE_OK;
+}
+
+int mem_eof(sqlite3_vtab_cursor* c) {
+    const MemCursor& cur = *reinterpret_cast<MemCursor*>(c);
+    return cur.i >= cur.n;
+}
+
+// Text columns point straight into the store (SQLITE_STATIC): the strings
+// do not change while the statement runs. Keys are formatted on the fly.
+void result_string(sqlite3_context* ctx, const std::string& s) {
+    sqlite3_result_text(ctx, s.data(), static_cast<int>(s.size()), SQLITE_STATIC);
+}
+
+void result_roll(sqlite3_context* ctx, RollId id) {
+    char buf[ROLL_TEXT_MAX];
+    const std::size_t n = format_roll(id, buf);
+    sqlite3_result_text(ctx, buf, static_cast<int>(n), SQLITE_TRANSIENT);
+}
+
+void result_course(sqlite3_context* ctx, CourseId id) {
+    char buf[COURSE_TEXT_MAX];
+    const std::size_t n = format_course(id, buf);
+    sqlite3_result_text(ctx, buf, static_cast<int>(n), SQLITE_TRANSIENT);
+}
+
+int mem_column(sqlite3_vtab_cursor* c, sqlite3_context* ctx, int col) {
+    const MemCursor& cur = *reinterpret_cast<MemCursor*>(c);
+    const DataStore& d = *cur.aux->store;
+    const std::uint32_t slot = cur.slot();
+    switch (cur.aux->table) {
+    case MT_STUDENTS: {
+        const Student& s = d.all_students[slot];
+        switch (col) {
+        case 0: result_roll(ctx, s.roll_no); break;
+        case 1: result_string(ctx, s.name); break;
+        case 2: result_string(ctx, s.address); break;
+        case 3: result_string(ctx, s.contact); break;
+        }
+        break;
+    }
+    case MT_COURSES: {
+        const Course& co = d.all_courses[slot];
+        switch (col) {
+        case 0: result_course(ctx, co.code); break;
+        case 1: result_string(ctx, co.title); break;
+        case 2: result_string(ctx, co.description); break;
+        case 3: result_string(ctx, co.teacher); break;
+        }
+        break;
+    }
+    case MT_GRADES: {
+        const GradeColumns& G = d.all_grades;
+        switch (col) {
+        case 0: result_roll(ctx, G.roll_no[slot]); break;
+        case 1: result_course(ctx, G.course_code[slot]); break;
+        case 2: sqlite3_result_double(ctx, G.internal_mark[slot]); break;
+        case 3: sqlite3_result_double(ctx, G.final_mark[slot]); break;
+        case 4: sqlite3_result_double(ctx, G[slot].weighted()); break;
+        }
+        break;
+    }
+    }
+    return SQLITE_OK;
+}
+
+int mem_rowid(sqlite3_vtab_cursor* c, sqlite3_int64* out) {
+    *out = reinterpret_cast<MemCursor*>(c)->slot();
+    return SQLITE_OK;
+}
+
+sqlite3_module make_module() {
+    sqlite3_module m{};
+    m.iVersion = 0;
+    m.xCreate = nullptr;   // eponymous-only
+    m.xConnect = mem_connect;
+    m.xBestIndex = mem_best_index;
+    m.xDisconnect = mem_disconnect;
+    m.xDestroy = mem_disconnect;
+    m.xOpen = mem_open;
+    m.xClose = mem_close;
+    m.xFilter = mem_filter;
+    m.xNext = mem_next;
+    m.xEof = mem_eof;
+    m.xColumn = mem_column;
+    m.xRowid = mem_rowid;
+    return m;   // no xUpdate: the tables are read-only
+}
+
+const sqlite3_module MEM_MODULE = make_module();
+
+void free_aux(void* p) { delete static_cast<MemAux*>(p); }
+
+} // namespace
+
+bool store_vtab_register(sqlite3* db, const DataStore& store) {
+    static const char* const NAMES[] = { "mem_students", "mem_courses", "mem_grades" };
+    for (int t = MT_STUDENTS; t <= MT_GRADES; ++t) {
+        MemAux* aux = new MemAux{ &store, static_cast<MemTable>(t) };
+        // SQLite owns `aux` from here on, even if registration fails.
+        if (sqlite3_create_module_v2(db, NAMES[t], &MEM_MODULE, aux, free_aux) != SQLITE_OK) return false;
+    }
+    return true;
+}
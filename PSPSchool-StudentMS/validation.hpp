@@ -1,10 +1,12 @@
 #pragma once
 #include <string>
-#include <regex>
 #include <algorithm>
 #include <iostream>
 #include <limits>
 #include <cctype>   // for std::isspace
+#include <charconv> // std::from_chars for marks
+#include "keys.hpp" // RollId / CourseId codec
+#include "models.hpp"
 
 /*
 -------------------------------------------------------------------------------
@@ -13,9 +15,17 @@
 What this file provides:
   - trim: basic whitespace trimming helper.
   - Validators: roll number, name, phone, course code, short non-empty text.
+    Roll numbers and course codes are checked by the keys.hpp codec, so
+    "valid" always means "packs into a RollId / CourseId". The others are
+    hand-written character scans (no std::regex): the CSV importer runs
+    them on every field of every row.
+  - Field checks for the non-interactive front ends (`sms import`,
+    `sms exec`, `sms serve`): parse or validate one field and, on failure,
+    fill `err` with the message all three report.
   - Prompt helpers for interactive console:
       * prompt_until_valid            -> simple loop until validator passes
       * prompt_until_valid_or_back    -> like above, but supports Back/Exit
+      * prompt_roll_or_back / prompt_course_or_back -> same, parsed to an id
       * prompt_number_or_back         -> numeric with range and Back/Exit
       * prompt_edit_string            -> edit in-place with default value
       * confirm_or_back               -> yes/no confirmation (Back on no)
@@ -38,27 +48,41 @@ inline std::string trim(std::string s) {
 
 // e.g. S001, S12345  (S + 3-6 digits)
 inline bool is_valid_roll(const std::string& x) {
-    static const std::regex re("^S\\d{3,6}$");
-    return std::regex_match(x, re);
+    RollId id;
+    return parse_roll(x, id);
 }
 
 // letters, spaces, hyphen, apostrophe; 2..40 chars
 inline bool is_valid_name(const std::string& x) {
     if (x.size() < 2 || x.size() > 40) return false;
-    static const std::regex re("^[A-Za-z '\\-]+$");
-    return std::regex_match(x, re);
+    for (char c : x) {
+        const bool letter = (c >= 'A' && c <= 'Z') || (c >= 'a' && c <= 'z');
+        if (!letter && c != ' ' && c != '\'' && c != '-') return false;
+    }
+    return true;
 }
 
-// optional but simple NZ-style mobile check (021/022/027/029 etc)
+// optional but simple NZ-style mobile check (021/022/027/029 etc):
+// 0, area digit 2-9, digit, [- ]?, 3 digits, [- ]?, 3-4 digits
 inline bool is_valid_phone(const std::string& x) {
-    static const std::regex re("^0(2[0-9]|[3-9][0-9])[- ]?\\d{3}[- ]?\\d{3,4}$|^021[- ]?\\d{3}[- ]?\\d{3,4}$");
-    return std::regex_match(x, re);
+    auto digit = [](char c) { return c >= '0' && c <= '9'; };
+    if (x.size() < 3 || x[0] != '0' || x[1] < '2' || x[1] > '9' || !digit(x[2])) return false;
+    size_t i = 3;
+    auto digits = [&](size_t lo, size_t hi) {
+        size_t n = 0;
+        while (i < x.size() && n < hi && digit(x[i])) { ++i; ++n; }
+        return n >= lo;
+    };
+    if (i < x.size() && (x[i] == '-' || x[i] == ' ')) ++i;
+    if (!digits(3, 3)) return false;
+    if (i < x.size() && (x[i] == '-' || x[i] == ' ')) ++i;
+    return digits(3, 4) && i == x.size();
 }
 
-// 3 letters + 3 digits, e.g. ENG101, MTH101
+// 2-4 letters + 3 digits, e.g. PE101, ENG101, MTH101
 inline bool is_valid_course_code(const std::string& x) {
-    static const std::regex re("^[A-Z]{3}\\d{3}$");
-    return std::regex_match(x, re);
+    CourseId id;
+    return parse_course(x, id);
 }
 
 // non-empty, max 60
@@ -66,6 +90,58 @@ inline bool is_non_empty_short(const std::string& x) {
     return !trim(x).empty() && x.size() <= 60;
 }
 
+// ---- field checks with messages (import / exec / serve) ----
+
+// A mark: the whole text is a number 0..100.
+inline bool parse_mark(const std::string& s, double& out) {
+    const char* e = s.data() + s.size();
+    auto r = std::from_chars(s.data(), e, out);
+    return r.ec == std::errc() && r.ptr == e && out >= 0 && out <= 100;
+}
+
+inline bool check_roll(const std::string& s, RollId& out, std::string& err) {
+    if (parse_roll(s, out)) return true;
+    err = "invalid roll_no '" + s + "' (S + 3-6 digits)";
+    return false;
+}
+
+inline bool check_course_code(const std::string& s, CourseId& out, std::string& err) {
+    if (parse_course(s, out)) return true;
+    err = "invalid course code '" + s + "' (2-4 letters + 3 digits, e.g. MTH101)";
+    return false;
+}
+
+// `field` names the mark in the message (internal_mark / final_mark).
+inline bool check_mark(const std::string& s, const char* field, double& out, std::string& err) {
+    if (parse_mark(s, out)) return true;
+    err = std::string(field) + " must be a number 0-100, got '" + s + "'";
+    return false;
+}
+
+// The text fields of a student (the roll number is checked on its own).
+inline bool check_student_fields(const std::string& name, const std::string& address,
+    const std::string& contact, Student& out, std::string& err) {
+    if (!is_valid_name(name)) { err = "invalid name '" + name + "' (letters/spaces, 2-40)"; return false; }
+    if (!is_non_empty_short(address)) { err = "address required (max 60 chars)"; return false; }
+    if (!is_valid_phone(contact)) { err = "invalid NZ phone '" + contact + "'"; return false; }
+    out.name = name;
+    out.address = address;
+    out.contact = contact;
+    return true;
+}
+
+// The text fields of a course (the code is checked on its own).
+inline bool check_course_fields(const std::string& title, const std::string& description,
+    const std::string& teacher, Course& out, std::string& err) {
+    if (!is_non_empty_short(title)) { err = "title required (max 60 chars)"; return false; }
+    if (!is_non_empty_short(description)) { err = "description required (max 60 chars)"; return false; }
+    if (!is_valid_name(teacher)) { err = "invalid teacher '" + teacher + "' (letters/spaces, 2-40)"; return false; }
+    out.title = title;
+    out.description = description;
+    out.teacher = teacher;
+    return true;
+}
+
 // ---- generic prompt helper ----
 inline std::string prompt_until_valid(
     const std::string& label,
@@ -113,6 +189,22 @@ inline InputCtl prompt_until_valid_or_back(
     }
 }
 
+// Key prompts: validate like prompt_until_valid_or_back, then parse the
+// accepted text into the packed id.
+inline InputCtl prompt_roll_or_back(const std::string& label, RollId& out, const std::string& error_msg) {
+    std::string v;
+    InputCtl r = prompt_until_valid_or_back(label, v, is_valid_roll, error_msg);
+    if (r == InputCtl::Ok) parse_roll(v, out);
+    return r;
+}
+
+inline InputCtl prompt_course_or_back(const std::string& label, CourseId& out, const std::string& error_msg) {
+    std::string v;
+    InputCtl r = prompt_until_valid_or_back(label, v, is_valid_course_code, error_msg);
+    if (r == InputCtl::Ok) parse_course(v, out);
+    return r;
+}
+
 // Number prompt with range + Back/Exit
 inline InputCtl prompt_number_or_back(
     const std::string& label,